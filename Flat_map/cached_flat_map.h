@@ -0,0 +1,547 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "flat_map.h"
+
+    /**
+     * @brief A flat_map with a direct-mapped cache of the positions of recently found keys in front of its binary search,
+     *        for skewed lookups where a few hot keys take most of the calls to find and at. A slot, chosen by the hash of the
+     *        key, holds the position of the last key found through it and the mutation epoch of the map at that time.
+     *        Every insertion or erasure increments the epoch, which invalidates all the slots at once; a slot of the current
+     *        epoch is a hit if the element at its position has the searched key, so a hit reads one slot and one element.
+     *        A slot packs the low 32 bits of the epoch and the position in one 64-bit word, and the slots and the hit and miss
+     *        counters are relaxed atomics, so concurrent const lookups are as safe as on the underlying map. The slots are
+     *        allocated out of line, so moving the map does not copy them.
+     *
+     * @tparam Map the type of the underlying map, such as flat_map, with random access iterators.
+     * @tparam Slots the number of slots of the cache, a power of two.
+     * @tparam Hash the hash function of the keys.
+     */
+    template <typename Map
+        , std::size_t Slots = 1024
+        , typename Hash = std::hash<typename Map::key_type>
+    >
+        struct cached_flat_map
+    {
+        static_assert((Slots > 0) && ((Slots & (Slots - 1)) == 0), "cached_flat_map needs a power of two number of slots");
+
+        using map_type = Map;
+        using key_type = typename Map::key_type;
+        using mapped_type = typename Map::mapped_type;
+        using value_type = typename Map::value_type;
+        using key_compare = typename Map::key_compare;
+        using hasher = Hash;
+        using size_type = typename Map::size_type;
+        using difference_type = typename Map::difference_type;
+        using iterator = typename Map::iterator;
+        using const_iterator = typename Map::const_iterator;
+
+        cached_flat_map() = default;
+        ~cached_flat_map() = default;
+
+        /**
+         * @brief Constructs a copy of the map of @other with an empty cache.
+         *
+         * @param other The map to copy.
+         */
+        cached_flat_map(const cached_flat_map& other)
+            : m_map(other.m_map)
+        {
+        }
+
+        /**
+         * @brief Takes the map and the cache of @other, which is left without a cache: its lookups go straight to its map.
+         *
+         * @param other The map to move from.
+         */
+        cached_flat_map(cached_flat_map&& other) noexcept(std::is_nothrow_move_constructible_v<Map>)
+            : m_map(std::move(other.m_map))
+            , m_slots(std::move(other.m_slots))
+            , m_epoch(other.m_epoch)
+            , m_hits(other.hits())
+            , m_misses(other.misses())
+        {
+            other.invalidate();
+        }
+
+        /**
+         * @brief Replaces the map with a copy of the map of @other and invalidates the cache.
+         *
+         * @param other The map to copy.
+         * @return cached_flat_map& *this.
+         */
+        cached_flat_map& operator=(const cached_flat_map& other)
+        {
+            m_map = other.m_map;
+            invalidate();
+            return *this;
+        }
+
+        /**
+         * @brief Replaces the map and the cache with the ones of @other.
+         *
+         * @param other The map to move from.
+         * @return cached_flat_map& *this.
+         */
+        cached_flat_map& operator=(cached_flat_map&& other) noexcept(std::is_nothrow_move_assignable_v<Map>)
+        {
+            m_map = std::move(other.m_map);
+            m_slots.swap(other.m_slots);
+            m_epoch = other.m_epoch;
+            other.invalidate();
+            return *this;
+        }
+
+        /**
+         * @brief Constructs a cached_flat_map holding the elements of @map.
+         *
+         * @param map The map to cache the lookups of.
+         */
+        explicit cached_flat_map(Map map)
+            : m_map(std::move(map))
+        {
+        }
+
+        /**
+         * @brief Constructs an empty cached_flat_map and inserts elements from the range [begin ,end ).
+         *
+         * @param begin range of elements to insert.
+         * @param end range of elements to insert.
+         */
+        template <typename It>
+        cached_flat_map(It begin, It end)
+            : m_map(begin, end)
+        {
+        }
+
+        /**
+         * @brief Constructs an empty cached_flat_map and inserts elements from the range [il.begin() ,il.end()).
+         *
+         * @param init An initializer_list.
+         */
+        cached_flat_map(std::initializer_list<value_type> init)
+            : m_map(init)
+        {
+        }
+
+        /**
+         * @brief Returns the underlying map, for the read operations cached_flat_map does not forward.
+         *
+         * @return const Map& The underlying map.
+         */
+        [[nodiscard]] const Map& map() const noexcept
+        {
+            return m_map;
+        }
+
+        /**
+         * @brief Calls @fn with the underlying map, for the modifications cached_flat_map does not forward, then invalidates the cache.
+         *
+         * @param fn The function modifying the map.
+         * @return The result of @fn.
+         */
+        template <typename F>
+        decltype(auto) modify(F fn)
+        {
+            struct invalidate_on_exit
+            {
+                cached_flat_map& owner;
+
+                ~invalidate_on_exit()
+                {
+                    owner.invalidate();
+                }
+            } guard{ *this };
+            return fn(m_map);
+        }
+
+        /**
+         * @brief Returns an iterator to the first element contained in the container.
+         *
+         * @return An iterator to the first element.
+         */
+        [[nodiscard]] iterator begin() noexcept
+        {
+            return m_map.begin();
+        }
+
+        /**
+         * @brief Returns an iterator to the end of the container.
+         *
+         * @return An iterator to the end of the container.
+         */
+        [[nodiscard]] iterator end() noexcept
+        {
+            return m_map.end();
+        }
+
+        /**
+         * @brief Returns a const_iterator to the first element contained in the container.
+         *
+         * @return const_iterator to the first element.
+         */
+        [[nodiscard]] const_iterator begin() const noexcept
+        {
+            return m_map.begin();
+        }
+
+        /**
+         * @brief Returns a const_iterator to the end of the container.
+         *
+         * @return const_iterator to the end of the container.
+         */
+        [[nodiscard]] const_iterator end() const noexcept
+        {
+            return m_map.end();
+        }
+
+        /**
+         * @brief Checks the empyiness of the container
+         *
+         * @return true if the container contains no elemets, false otherwise.
+         */
+        [[nodiscard]] bool empty() const noexcept
+        {
+            return m_map.empty();
+        }
+
+        /**
+         * @brief  Returns the number of the elements contained in the container.
+         *
+         * @return The number of the elements of container.
+         */
+        [[nodiscard]] size_type size() const noexcept
+        {
+            return m_map.size();
+        }
+
+        /**
+         * @brief If there is no key equivalent to @key in the map, inserts (@key, V()) into the map.
+         *
+         * @param key The key of the element to find.
+         * @return mapped_type& A reference to the value corresponding to @key in *this.
+         */
+        mapped_type& operator[] (const key_type& key)
+        {
+            auto found = find(key);
+            if (found != end()) {
+                return found->second;
+            }
+            return emplace(key, mapped_type()).first->second;
+        }
+
+        /**
+         * @brief Returns a reference to the value whose key is equivalent to @key.
+         *        Throws an exception object of type out_of_range if no such element is present.
+         *
+         * @param key The key of the element to find.
+         * @return mapped_type& A reference to the value whose key is equivalent to @key.
+         */
+        mapped_type& at(const key_type& key)
+        {
+            auto found = find(key);
+            if (found == end()) {
+                detail::throw_out_of_range("key passed to 'at' doesn't exist in this map");
+            }
+            return found->second;
+        }
+
+        /**
+         * @brief Returns a reference to the value whose key is equivalent to @key.
+         *        Throws an exception object of type out_of_range if no such element is present.
+         *
+         * @param key The key of the element to find.
+         * @return const mapped_type& A const reference to the value whose key is equivalent to @key.
+         */
+        const mapped_type& at(const key_type& key) const
+        {
+            auto found = find(key);
+            if (found == end()) {
+                detail::throw_out_of_range("key passed to 'at' doesn't exist in this map");
+            }
+            return found->second;
+        }
+
+        /**
+         * @brief Inserts a new element into the container constructed in-place with the given args if there is no element with the key in the container.
+         *
+         * @param args Arguments to forward to the constructor of the element.
+         * @return std::pair<iterator, bool> The bool component of the returned pair is true if and only if the insertion took place, and
+                   the iterator component of the pair points to the element with key equivalent to the key of the element.
+         */
+        template <typename ... Args>
+        std::pair<iterator, bool> emplace(Args&& ... args)
+        {
+            auto result = m_map.emplace(std::forward<Args>(args) ...);
+            if (result.second) {
+                invalidate();
+            }
+            return result;
+        }
+
+        /**
+         * @brief Inserts @value if and only if there is no element with key equivalent to the key of @value.
+         *
+         * @param value Element value to insert.
+         * @return std::pair<iterator, bool> The bool component of the returned pair is true if and only if the insertion takes place,
+         *         and the iterator component of the pair points to the element with key equivalent to the key of @value.
+         */
+        std::pair<iterator, bool> insert(const value_type& value)
+        {
+            return emplace(value);
+        }
+
+        /**
+         * @brief Inserts each element from the range [first,last) if and only if there is no element with key equivalent to the key of that element.
+         *
+         * @param begin range of elements to insert.
+         * @param end range of elements to insert.
+         */
+        template <typename It>
+        void insert(It begin, It end)
+        {
+            modify([&](Map& map) { map.insert(begin, end); });
+        }
+
+        /**
+         * @brief Erases the element pointed to by it.
+         *
+         * @param it Iterator pointing to the element to be erased.
+         * @return iterator An iterator pointing to the element immediately following the erased one. If no such element exists, returns end().
+         */
+        iterator erase(const_iterator it)
+        {
+            invalidate();
+            return m_map.erase(it);
+        }
+
+        /**
+         * @brief Erases element in the container with key equivalent to @key.
+         *
+         * @param key Key value of the element to remove.
+         * @return  0 if @key not found in container, 1 otherwise.
+         */
+        size_type erase(const key_type& key)
+        {
+            auto found = find(key);
+            if (found == end()) {
+                return 0;
+            }
+            erase(found);
+            return 1;
+        }
+
+        /**
+         * @brief Swaps the contents of *this and other, and invalidates the caches of both.
+         *
+         * @param other cached_flat_map with which must be swapped.
+         */
+        void swap(cached_flat_map& other) noexcept
+        {
+            m_map.swap(other.m_map);
+            invalidate();
+            other.invalidate();
+        }
+
+        /**
+         * @brief Erases all elements in container.
+         *
+         */
+        void clear()
+        {
+            invalidate();
+            m_map.clear();
+        }
+
+        /**
+         * @brief Attempts to find an element with key equivalent to @key, first at the position cached in the slot of @key.
+         *
+         * @param key Key value of the element to search for.
+         * @return iterator An iterator pointing to an element with the key equivalent to key, or end() if such an element is not found.
+         */
+        [[nodiscard]] iterator find(const key_type& key)
+        {
+            size_type position = find_position(key);
+            return (position == size()) ? end() : begin() + position;
+        }
+
+        /**
+         * @brief Attempts to find an element with key equivalent to @key, first at the position cached in the slot of @key.
+         *
+         * @param key Key value of the element to search for.
+         * @return const_iterator A const_iterator pointing to an element with the key equivalent to @key, or end() if such an element is not found.
+         */
+        [[nodiscard]] const_iterator find(const key_type& key) const
+        {
+            size_type position = find_position(key);
+            return (position == size()) ? end() : begin() + position;
+        }
+
+        /**
+         * @brief Checks if there is an element with key equivalent to @key in the container.
+         *
+         * @param key Key value of the element to search for.
+         * @return true if there is such an element, false otherwise.
+         */
+        [[nodiscard]] bool contains(const key_type& key) const
+        {
+            return find_position(key) != size();
+        }
+
+        /**
+         * @brief Returns the number of elements with key equivalent to @key.
+         *
+         * @param key Key value of the elements to count.
+         * @return size_type 1 if such an element is found, 0 otherwise.
+         */
+        [[nodiscard]] size_type count(const key_type& key) const
+        {
+            return contains(key) ? 1 : 0;
+        }
+
+        /**
+         * @brief Finds the first element with key not less than @key, or end() if such an element is not found.
+         *
+         * @param key Key value to compare the elements to.
+         * @return const_iterator An const iterator pointing to the first element with key not less than k, or end() if such an element is not found.
+         */
+        [[nodiscard]] const_iterator lower_bound(const key_type& key) const
+        {
+            return m_map.lower_bound(key);
+        }
+
+        /**
+         * @brief Finds the first element with key greater than @key, or end() if such an element is not found.
+         *
+         * @param key Key value to compare the elements to.
+         * @return const_iterator An const iterator pointing to the first element with key greater than @key, or end() if such an element is not found.
+         */
+        [[nodiscard]] const_iterator upper_bound(const key_type& key) const
+        {
+            return m_map.upper_bound(key);
+        }
+
+        /**
+         * @brief Returns the number of lookups answered from the cache.
+         *
+         * @return size_type The number of cache hits.
+         */
+        [[nodiscard]] size_type hits() const noexcept
+        {
+            return m_hits.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Returns the number of lookups which needed a binary search.
+         *
+         * @return size_type The number of cache misses.
+         */
+        [[nodiscard]] size_type misses() const noexcept
+        {
+            return m_misses.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Compares two cached_flat_maps.
+         *
+         * @param other A cached_flat_map with which need to compare.
+         * @return true if their maps are equal,false otherwise.
+         */
+        bool operator== (const cached_flat_map& other) const
+        {
+            return m_map == other.m_map;
+        }
+
+        /**
+         * @brief Compares two cached_flat_maps.
+         *
+         * @param other A cached_flat_map with which need to compare.
+         * @return true if their maps are unequal,false otherwise.
+         */
+        bool operator!= (const cached_flat_map& other) const
+        {
+            return !(*this == other);
+        }
+
+    private:
+        /**
+         * @brief A slot holds the position of the last key found through it in its low 32 bits and the low 32 bits of the epoch
+         *        of the map at that time in its high bits. A stale slot whose epoch wrapped around is harmless: a hit is only
+         *        taken when the element at the position has the searched key.
+         */
+        using slot = std::atomic<std::uint64_t>;
+
+        static constexpr std::uint64_t position_mask = std::numeric_limits<std::uint32_t>::max();
+
+        Map m_map;
+        std::unique_ptr<slot[]> m_slots = std::make_unique<slot[]>(Slots);
+        std::uint64_t m_epoch = 1;
+        mutable std::atomic<size_type> m_hits{ 0 };
+        mutable std::atomic<size_type> m_misses{ 0 };
+
+        void invalidate() noexcept
+        {
+            ++m_epoch;
+        }
+
+        /**
+         * @brief Spreads the hash of @key with a Fibonacci multiplication and keeps its high bits, so that hashes differing in
+         *        their high bits only, or identity hashes of consecutive keys, still fall in different slots.
+         */
+        static size_type slot_of(const key_type& key)
+        {
+            std::uint64_t hash = static_cast<std::uint64_t>(Hash()(key)) * 0x9E3779B97F4A7C15ull;
+            return (Slots == 1) ? 0 : static_cast<size_type>(hash >> (64 - slot_bits()));
+        }
+
+        static constexpr unsigned slot_bits()
+        {
+            unsigned bits = 0;
+            while ((std::size_t(1) << bits) < Slots) {
+                ++bits;
+            }
+            return bits;
+        }
+
+        size_type find_position(const key_type& key) const
+        {
+            auto begin = m_map.begin();
+            if (!m_slots) {
+                return static_cast<size_type>(m_map.find(key) - begin);
+            }
+            key_compare comp;
+            slot& cached = m_slots[slot_of(key)];
+            std::uint64_t tag = (m_epoch & position_mask) << 32;
+            std::uint64_t entry = cached.load(std::memory_order_relaxed);
+            size_type position = static_cast<size_type>(entry & position_mask);
+            if (((entry & ~position_mask) == tag) && (position < m_map.size())) {
+                const auto& element = begin[position];
+                if (!comp(key, element.first) && !comp(element.first, key)) {
+                    m_hits.fetch_add(1, std::memory_order_relaxed);
+                    return position;
+                }
+            }
+            m_misses.fetch_add(1, std::memory_order_relaxed);
+            auto found = m_map.find(key);
+            position = static_cast<size_type>(found - begin);
+            if ((found != m_map.end()) && (position < position_mask)) {
+                cached.store(tag | position, std::memory_order_relaxed);
+            }
+            return position;
+        }
+    };
+
+    template <typename M, std::size_t S, typename H>
+    void swap(cached_flat_map<M, S, H>& lhs, cached_flat_map<M, S, H>& rhs) noexcept
+    {
+        lhs.swap(rhs);
+    }
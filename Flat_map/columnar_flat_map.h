@@ -0,0 +1,743 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "flat_map.h"
+
+    template <typename Key, typename V, typename Allocator = std::allocator<V>>
+    struct columnar_flat_map;
+
+    /**
+     * @brief A map from tuple keys (k0, k1, ..., kn) to V which stores every key component in its own sorted column, the elements
+     *        being ordered lexicographically by the columns compared with operator<. Lookups narrow an index range column by column,
+     *        so a search compares only the component of the current column, and prefix_range(k0, ...) finds all the elements whose
+     *        leading components are given without building sentinel keys. The leading column is a contiguous array of its type,
+     *        which suits scans such as the ones of flat_map_scan.h.
+     *        Elements are exposed as (tuple of key references, value reference) pairs; iterators are invalidated by any insertion.
+     *
+     * @tparam Ks are the types of the key components.
+     * @tparam V is the value_type of the map.
+     * @tparam std::allocator<V> the allocator to allocate the columns and the values.
+     */
+    template <typename ... Ks, typename V, typename Allocator>
+    struct columnar_flat_map<std::tuple<Ks ...>, V, Allocator>
+    {
+        using key_type = std::tuple<Ks ...>;
+        using mapped_type = V;
+        using allocator_type = Allocator;
+        using values_type = std::vector<V, Allocator>;
+        using columns_type = std::tuple<std::vector<Ks, typename std::allocator_traits<Allocator>::template rebind_alloc<Ks>> ...>;
+        using difference_type = typename values_type::difference_type;
+        using size_type = typename values_type::size_type;
+
+        static_assert(sizeof...(Ks) > 0, "columnar_flat_map needs at least one key column");
+
+    private:
+        template <bool Const>
+        struct basic_iterator
+        {
+            using owner_type = std::conditional_t<Const, const columnar_flat_map, columnar_flat_map>;
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = std::pair<std::tuple<const Ks& ...>, std::conditional_t<Const, const V&, V&>>;
+            using difference_type = typename columnar_flat_map::difference_type;
+            using reference = value_type;
+
+            struct pointer
+            {
+                value_type value;
+
+                const value_type* operator-> () const
+                {
+                    return &value;
+                }
+            };
+
+            basic_iterator() = default;
+
+            basic_iterator(owner_type* owner, size_type index)
+                : m_owner(owner)
+                , m_index(index)
+            {
+            }
+
+            template <bool C = Const, typename = std::enable_if_t<C>>
+            basic_iterator(const basic_iterator<false>& other)
+                : m_owner(other.m_owner)
+                , m_index(other.m_index)
+            {
+            }
+
+            [[nodiscard]] reference operator* () const
+            {
+                return { m_owner->key_at(m_index, std::index_sequence_for<Ks ...>()), m_owner->m_values[m_index] };
+            }
+
+            [[nodiscard]] pointer operator-> () const
+            {
+                return { **this };
+            }
+
+            [[nodiscard]] reference operator[] (difference_type n) const
+            {
+                return *(*this + n);
+            }
+
+            basic_iterator& operator++ ()
+            {
+                ++m_index;
+                return *this;
+            }
+
+            basic_iterator operator++ (int)
+            {
+                basic_iterator result = *this;
+                ++m_index;
+                return result;
+            }
+
+            basic_iterator& operator-- ()
+            {
+                --m_index;
+                return *this;
+            }
+
+            basic_iterator operator-- (int)
+            {
+                basic_iterator result = *this;
+                --m_index;
+                return result;
+            }
+
+            basic_iterator& operator+= (difference_type n)
+            {
+                m_index += n;
+                return *this;
+            }
+
+            basic_iterator& operator-= (difference_type n)
+            {
+                m_index -= n;
+                return *this;
+            }
+
+            [[nodiscard]] basic_iterator operator+ (difference_type n) const
+            {
+                return { m_owner, m_index + n };
+            }
+
+            [[nodiscard]] basic_iterator operator- (difference_type n) const
+            {
+                return { m_owner, m_index - n };
+            }
+
+            [[nodiscard]] difference_type operator- (const basic_iterator& other) const
+            {
+                return static_cast<difference_type>(m_index) - static_cast<difference_type>(other.m_index);
+            }
+
+            bool operator== (const basic_iterator& other) const
+            {
+                return m_index == other.m_index;
+            }
+
+            bool operator!= (const basic_iterator& other) const
+            {
+                return m_index != other.m_index;
+            }
+
+            bool operator< (const basic_iterator& other) const
+            {
+                return m_index < other.m_index;
+            }
+
+            /**
+             * @brief Returns the position of the element in the columns.
+             */
+            [[nodiscard]] size_type index() const
+            {
+                return m_index;
+            }
+
+        private:
+            friend struct columnar_flat_map;
+            friend struct basic_iterator<true>;
+
+            owner_type* m_owner = nullptr;
+            size_type m_index = 0;
+        };
+
+    public:
+        using iterator = basic_iterator<false>;
+        using const_iterator = basic_iterator<true>;
+
+        columnar_flat_map() = default;
+        ~columnar_flat_map() = default;
+        columnar_flat_map(columnar_flat_map&&) = default;
+        columnar_flat_map(const columnar_flat_map&) = default;
+        columnar_flat_map& operator=(columnar_flat_map&&) = default;
+        columnar_flat_map& operator=(const columnar_flat_map&) = default;
+
+        /**
+         * @brief Constructs an empty columnar_flat_map and inserts elements from the range [begin ,end ).
+         *
+         * @param begin range of (key tuple, value) pairs to insert.
+         * @param end range of (key tuple, value) pairs to insert.
+         */
+        template <typename It>
+        columnar_flat_map(It begin, It end)
+        {
+            insert(begin, end);
+        }
+
+        /**
+         * @brief Constructs an empty columnar_flat_map and inserts elements from the range [il.begin() ,il.end()).
+         *
+         * @param init An initializer_list.
+         */
+        columnar_flat_map(std::initializer_list<std::pair<key_type, V>> init)
+            : columnar_flat_map(std::begin(init), std::end(init))
+        {
+        }
+
+        /**
+         * @brief Returns an iterator to the first element contained in the container.
+         *
+         * @return An iterator to the first element.
+         */
+        [[nodiscard]] iterator begin() noexcept
+        {
+            return { this, 0 };
+        }
+
+        /**
+         * @brief Returns an iterator to the end of the container.
+         *
+         * @return An iterator to the end of the container.
+         */
+        [[nodiscard]] iterator end() noexcept
+        {
+            return { this, m_values.size() };
+        }
+
+        /**
+         * @brief Returns a const_iterator to the first element contained in the container.
+         *
+         * @return const_iterator to the first element.
+         */
+        [[nodiscard]] const_iterator begin() const noexcept
+        {
+            return { this, 0 };
+        }
+
+        /**
+         * @brief Returns a const_iterator to the end of the container.
+         *
+         * @return const_iterator to the end of the container.
+         */
+        [[nodiscard]] const_iterator end() const noexcept
+        {
+            return { this, m_values.size() };
+        }
+
+        /**
+         * @brief Checks the empyiness of the container
+         *
+         * @return true if the container contains no elemets, false otherwise.
+         */
+        [[nodiscard]] bool empty() const noexcept
+        {
+            return m_values.empty();
+        }
+
+        /**
+         * @brief  Returns the number of the elements contained in the container.
+         *
+         * @return The number of the elements of container.
+         */
+        [[nodiscard]] size_type size() const noexcept
+        {
+            return m_values.size();
+        }
+
+        /**
+         * @brief Returns the sorted column of the key components of index @I, whose element i belongs to the element i of the map.
+         *
+         * @return const auto& The column of the key components.
+         */
+        template <std::size_t I>
+        [[nodiscard]] const auto& column() const noexcept
+        {
+            return std::get<I>(m_columns);
+        }
+
+        /**
+         * @brief Returns the values, whose element i belongs to the element i of the map.
+         *
+         * @return const values_type& The values.
+         */
+        [[nodiscard]] const values_type& values() const noexcept
+        {
+            return m_values;
+        }
+
+        /**
+         * @brief Requests allocation of memory for @size elements in every column.
+         *
+         * @param size Requested number of elements.
+         */
+        void reserve(size_type size)
+        {
+            std::apply([size](auto& ... columns) { (columns.reserve(size), ...); }, m_columns);
+            m_values.reserve(size);
+        }
+
+        /**
+         * @brief If there is no key equal to @key in the map, inserts (@key, V()) into the map.
+         *
+         * @param key The key of the element to find.
+         * @return mapped_type& A reference to the value corresponding to @key in *this.
+         */
+        mapped_type& operator[] (const key_type& key)
+        {
+            return emplace(key).first->second;
+        }
+
+        /**
+         * @brief Returns a reference to the value whose key is equal to @key.
+         *        Throws an exception object of type out_of_range if no such element is present.
+         *
+         * @param key The key of the element to find.
+         * @return mapped_type& A reference to the value whose key is equal to @key.
+         */
+        mapped_type& at(const key_type& key)
+        {
+            auto found = find(key);
+            if (found == end()) {
+                detail::throw_out_of_range("key passed to 'at' doesn't exist in this map");
+            }
+            return found->second;
+        }
+
+        /**
+         * @brief Returns a reference to the value whose key is equal to @key.
+         *        Throws an exception object of type out_of_range if no such element is present.
+         *
+         * @param key The key of the element to find.
+         * @return const mapped_type& A const reference to the value whose key is equal to @key.
+         */
+        const mapped_type& at(const key_type& key) const
+        {
+            auto found = find(key);
+            if (found == end()) {
+                detail::throw_out_of_range("key passed to 'at' doesn't exist in this map");
+            }
+            return found->second;
+        }
+
+        /**
+         * @brief Inserts a value constructed from @args with the key @key if and only if there is no element with key equal to @key.
+         *
+         * @param key The key of the element to insert.
+         * @param args Arguments to construct the value from.
+         * @return std::pair<iterator, bool> The bool component of the returned pair is true if and only if the insertion took place, and
+                   the iterator component of the pair points to the element with key equal to @key.
+         */
+        template <typename ... Args>
+        std::pair<iterator, bool> emplace(const key_type& key, Args&& ... args)
+        {
+            auto range = narrow(key);
+            if (range.first != range.second) {
+                return { iterator(this, range.first), false };
+            }
+            size_type index = range.first;
+            m_values.emplace(std::begin(m_values) + index, std::forward<Args>(args) ...);
+            std::size_t inserted = 0;
+            try
+            {
+                for_each_column(key, [index, &inserted](auto& column, const auto& component) {
+                    column.insert(std::begin(column) + index, component);
+                    ++inserted;
+                });
+            }
+            catch (...)
+            {
+                std::size_t erased = 0;
+                for_each_column(key, [index, inserted, &erased](auto& column, const auto&) {
+                    if (erased++ < inserted) {
+                        column.erase(std::begin(column) + index);
+                    }
+                });
+                m_values.erase(std::begin(m_values) + index);
+                throw;
+            }
+            return { iterator(this, index), true };
+        }
+
+        /**
+         * @brief Inserts (@value.first, @value.second) if and only if there is no element with key equal to @value.first.
+         *
+         * @param value A pair of a key tuple and a value.
+         * @return std::pair<iterator, bool> The bool component of the returned pair is true if and only if the insertion takes place,
+         *         and the iterator component of the pair points to the element with key equal to the key of @value.
+         */
+        std::pair<iterator, bool> insert(const std::pair<key_type, V>& value)
+        {
+            return emplace(value.first, value.second);
+        }
+
+        /**
+         * @brief Inserts each element from the range [first,last) if and only if there is no element with key equal to the key of that element.
+         *        The new elements are appended to the columns, then all the columns are permuted in key order in one pass.
+         *
+         * @param begin range of (key tuple, value) pairs to insert.
+         * @param end range of (key tuple, value) pairs to insert.
+         */
+        template <typename It>
+        void insert(It begin, It end)
+        {
+            size_type size_before = size();
+            try
+            {
+                for (; begin != end; ++begin) {
+                    m_values.push_back(begin->second);
+                    for_each_column(begin->first, [](auto& column, const auto& component) {
+                        column.push_back(component);
+                    });
+                }
+            }
+            catch (...)
+            {
+                truncate(size_before);
+                throw;
+            }
+            if (size() == size_before) {
+                return;
+            }
+            std::vector<size_type> order(size());
+            std::iota(std::begin(order), std::end(order), size_type(0));
+            auto less = [this](size_type lhs, size_type rhs) { return index_less(lhs, rhs); };
+            std::stable_sort(std::begin(order) + size_before, std::end(order), less);
+            std::inplace_merge(std::begin(order), std::begin(order) + size_before, std::end(order), less);
+            order.erase(std::unique(std::begin(order), std::end(order)
+                , [&less](size_type lhs, size_type rhs) { return !less(lhs, rhs); }), std::end(order));
+            columns_type columns;
+            values_type values(m_values.get_allocator());
+            values.reserve(order.size());
+            std::apply([&order](auto& ... columns) { (columns.reserve(order.size()), ...); }, columns);
+            gather(columns, order, std::index_sequence_for<Ks ...>());
+            for (size_type index : order) {
+                values.push_back(std::move_if_noexcept(m_values[index]));
+            }
+            m_columns.swap(columns);
+            m_values.swap(values);
+        }
+
+        /**
+         * @brief Inserts each element from the range [il.begin(), il.end()) if and only if there is no element with key equal to the key of that element.
+         *
+         * @param il An initializer_list.
+         */
+        void insert(std::initializer_list<std::pair<key_type, V>> il)
+        {
+            insert(std::begin(il), std::end(il));
+        }
+
+        /**
+         * @brief Erases the element pointed to by it.
+         *
+         * @param it Iterator pointing to the element to be erased.
+         * @return iterator An iterator pointing to the element immediately following the erased one. If no such element exists, returns end().
+         */
+        iterator erase(const_iterator it)
+        {
+            std::apply([&it](auto& ... columns) { (columns.erase(std::begin(columns) + it.m_index), ...); }, m_columns);
+            m_values.erase(std::begin(m_values) + it.m_index);
+            return { this, it.m_index };
+        }
+
+        /**
+         * @brief Erases the elements in the range [begin, end).
+         *
+         * @param begin Range of elements to remove.
+         * @param end Range of elements to remove.
+         * @return iterator Iterator following the last removed element.
+         */
+        iterator erase(const_iterator begin, const_iterator end)
+        {
+            std::apply([&begin, &end](auto& ... columns) {
+                (columns.erase(std::begin(columns) + begin.m_index, std::begin(columns) + end.m_index), ...);
+            }, m_columns);
+            m_values.erase(std::begin(m_values) + begin.m_index, std::begin(m_values) + end.m_index);
+            return { this, begin.m_index };
+        }
+
+        /**
+         * @brief Erases element in the container with key equal to @key.
+         *
+         * @param key Key value of the element to remove.
+         * @return  0 if @key not found in container, 1 otherwise.
+         */
+        size_type erase(const key_type& key)
+        {
+            auto found = find(key);
+            if (found == end()) {
+                return 0;
+            }
+            erase(found);
+            return 1;
+        }
+
+        /**
+         * @brief Swaps the contents of *this and other.
+         *
+         * @param other columnar_flat_map with which must be swapped.
+         */
+        void swap(columnar_flat_map& other) noexcept
+        {
+            m_columns.swap(other.m_columns);
+            m_values.swap(other.m_values);
+        }
+
+        /**
+         * @brief Erases all elements in container.
+         *
+         */
+        void clear()
+        {
+            truncate(0);
+        }
+
+        /**
+         * @brief Attempts to find an element with key equal to @key.
+         *
+         * @param key Key value of the element to search for.
+         * @return iterator An iterator pointing to an element with the key equal to key, or end() if such an element is not found.
+         */
+        [[nodiscard]] iterator find(const key_type& key)
+        {
+            return { this, find_index(key) };
+        }
+
+        /**
+         * @brief Attempts to find an element with key equal to @key.
+         *
+         * @param key Key value of the element to search for.
+         * @return const_iterator A const_iterator pointing to an element with the key equal to @key, or end() if such an element is not found.
+         */
+        [[nodiscard]] const_iterator find(const key_type& key) const
+        {
+            return { this, find_index(key) };
+        }
+
+        /**
+         * @brief Checks if there is an element with key equal to @key in the container.
+         *
+         * @param key Key value of the element to search for.
+         * @return true if there is such an element, false otherwise.
+         */
+        [[nodiscard]] bool contains(const key_type& key) const
+        {
+            return find_index(key) != size();
+        }
+
+        /**
+         * @brief Returns the number of elements with key equal to @key.
+         *
+         * @param key Key value of the element to count.
+         * @return 1 if the element is found, 0 otherwise.
+         */
+        [[nodiscard]] size_type count(const key_type& key) const
+        {
+            return contains(key) ? 1 : 0;
+        }
+
+        /**
+         * @brief Finds the first element with key not less than @key, or end() if such an element is not found.
+         *
+         * @param key Key value to compare the elements to.
+         * @return const_iterator An const iterator pointing to the first element with key not less than k, or end() if such an element is not found.
+         */
+        [[nodiscard]] const_iterator lower_bound(const key_type& key) const
+        {
+            return { this, narrow(key).first };
+        }
+
+        /**
+         * @brief Finds the first element with key greater than @key, or end() if such an element is not found.
+         *
+         * @param key Key value to compare the elements to.
+         * @return const_iterator An const iterator pointing to the first element with key greater than @key, or end() if such an element is not found.
+         */
+        [[nodiscard]] const_iterator upper_bound(const key_type& key) const
+        {
+            return { this, narrow(key).second };
+        }
+
+        /**
+         * @brief Returns the range of the elements whose leading key components are equal to @prefix, searching one column per
+         *        component of @prefix within the range found for the previous ones.
+         *
+         * @param prefix The values of the first key components, at most one per column.
+         * @return std::pair<iterator, iterator> The range of the matching elements, empty if there is none.
+         */
+        template <typename ... Ps>
+        [[nodiscard]] std::pair<iterator, iterator> prefix_range(const Ps& ... prefix)
+        {
+            static_assert(sizeof...(Ps) <= sizeof...(Ks), "prefix_range takes at most one value per key column");
+            auto range = narrow(std::forward_as_tuple(prefix ...));
+            return { iterator(this, range.first), iterator(this, range.second) };
+        }
+
+        /**
+         * @brief Returns the range of the elements whose leading key components are equal to @prefix, searching one column per
+         *        component of @prefix within the range found for the previous ones.
+         *
+         * @param prefix The values of the first key components, at most one per column.
+         * @return std::pair<const_iterator, const_iterator> The range of the matching elements, empty if there is none.
+         */
+        template <typename ... Ps>
+        [[nodiscard]] std::pair<const_iterator, const_iterator> prefix_range(const Ps& ... prefix) const
+        {
+            static_assert(sizeof...(Ps) <= sizeof...(Ks), "prefix_range takes at most one value per key column");
+            auto range = narrow(std::forward_as_tuple(prefix ...));
+            return { const_iterator(this, range.first), const_iterator(this, range.second) };
+        }
+
+        /**
+         * @brief Compares two columnar_flat_maps.
+         *
+         * @param other A columnar_flat_map with which need to compare.
+         * @return true if they are equal,false otherwise.
+         */
+        bool operator== (const columnar_flat_map& other) const
+        {
+            return (m_columns == other.m_columns) && (m_values == other.m_values);
+        }
+
+        /**
+         * @brief Compares two columnar_flat_maps.
+         *
+         * @param other A columnar_flat_map with which need to compare.
+         * @return true if they are unequal,false otherwise.
+         */
+        bool operator!= (const columnar_flat_map& other) const
+        {
+            return !(*this == other);
+        }
+
+    private:
+        columns_type m_columns;
+        values_type m_values;
+
+        template <std::size_t ... I>
+        std::tuple<const Ks& ...> key_at(size_type index, std::index_sequence<I ...>) const
+        {
+            return std::tuple<const Ks& ...>(std::get<I>(m_columns)[index] ...);
+        }
+
+        /**
+         * @brief Calls @fn(column, component) for every column and the matching component of @key, in column order.
+         */
+        template <typename F>
+        void for_each_column(const key_type& key, F fn)
+        {
+            for_each_column(key, fn, std::index_sequence_for<Ks ...>());
+        }
+
+        template <typename F, std::size_t ... I>
+        void for_each_column(const key_type& key, F& fn, std::index_sequence<I ...>)
+        {
+            (fn(std::get<I>(m_columns), std::get<I>(key)), ...);
+        }
+
+        template <std::size_t ... I>
+        void gather(columns_type& columns, const std::vector<size_type>& order, std::index_sequence<I ...>)
+        {
+            (gather_column(std::get<I>(columns), std::get<I>(m_columns), order), ...);
+        }
+
+        template <typename Column>
+        static void gather_column(Column& to, Column& from, const std::vector<size_type>& order)
+        {
+            for (size_type index : order) {
+                to.push_back(std::move_if_noexcept(from[index]));
+            }
+        }
+
+        void truncate(size_type size)
+        {
+            std::apply([size](auto& ... columns) { (columns.erase(std::begin(columns) + size, std::end(columns)), ...); }, m_columns);
+            m_values.erase(std::begin(m_values) + size, std::end(m_values));
+        }
+
+        /**
+         * @brief Compares the keys of the elements at @lhs and @rhs lexicographically, column by column.
+         */
+        template <std::size_t I = 0>
+        bool index_less(size_type lhs, size_type rhs) const
+        {
+            if constexpr (I == sizeof...(Ks)) {
+                return false;
+            }
+            else {
+                const auto& column = std::get<I>(m_columns);
+                if (column[lhs] < column[rhs]) {
+                    return true;
+                }
+                if (column[rhs] < column[lhs]) {
+                    return false;
+                }
+                return index_less<I + 1>(lhs, rhs);
+            }
+        }
+
+        /**
+         * @brief Returns the index range of the elements whose first key components are equal to the components of @prefix:
+         *        the range of equal components in column I is searched within the range found for column I - 1. An empty
+         *        result starts where the elements with the prefix would be inserted.
+         */
+        template <typename Prefix>
+        std::pair<size_type, size_type> narrow(const Prefix& prefix) const
+        {
+            return narrow<0>(prefix, 0, size());
+        }
+
+        template <std::size_t I, typename Prefix>
+        std::pair<size_type, size_type> narrow(const Prefix& prefix, size_type lo, size_type hi) const
+        {
+            if constexpr (I == std::tuple_size_v<Prefix>) {
+                return { lo, hi };
+            }
+            else {
+                const auto& column = std::get<I>(m_columns);
+                auto range = std::equal_range(std::begin(column) + lo, std::begin(column) + hi, std::get<I>(prefix));
+                lo = static_cast<size_type>(range.first - std::begin(column));
+                hi = static_cast<size_type>(range.second - std::begin(column));
+                if (lo == hi) {
+                    return { lo, hi };
+                }
+                return narrow<I + 1>(prefix, lo, hi);
+            }
+        }
+
+        size_type find_index(const key_type& key) const
+        {
+            auto range = narrow(key);
+            return (range.first != range.second) ? range.first : size();
+        }
+    };
+
+    template <typename K, typename V, typename A>
+    void swap(columnar_flat_map<K, V, A>& lhs, columnar_flat_map<K, V, A>& rhs) noexcept
+    {
+        lhs.swap(rhs);
+    }
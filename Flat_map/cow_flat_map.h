@@ -0,0 +1,636 @@
+#pragma once
+
+#include <memory>
+#include <utility>
+
+#include "flat_map.h"
+
+    /**
+     * @brief A flat_map whose copies share one reference-counted storage. Copying is O(1), and the first mutating call
+     *        on a copy whose storage is shared (emplace, insert, erase, non-const operator[], at, find, begin, ...)
+     *        detaches it by deep-copying the elements.
+     *        Once a non-const member has handed out a reference or an iterator to the elements, the storage is marked as leaked
+     *        and the copies of the map deep-copy it, so writes through that reference never reach a copy.
+     *
+     * @tparam K is the key_type of the map.
+     * @tparam V is the value_type of the map.
+     * @tparam std::less<K> the ordering function for Keys.
+     * @tparam std::allocator<std::pair<K, V>> the allocator to allocate the value_types.
+     */
+    template <typename K
+        , typename V
+        , typename Comp = std::less<K>
+        , typename Allocator = std::allocator<std::pair<K, V>>
+    >
+        struct cow_flat_map
+    {
+        using map_type = flat_map<K, V, Comp, Allocator>;
+        using key_type = typename map_type::key_type;
+        using mapped_type = typename map_type::mapped_type;
+        using value_type = typename map_type::value_type;
+        using key_compare = typename map_type::key_compare;
+        using value_compare = typename map_type::value_compare;
+        using allocator_type = typename map_type::allocator_type;
+        using reference = typename map_type::reference;
+        using const_reference = typename map_type::const_reference;
+        using iterator = typename map_type::iterator;
+        using const_iterator = typename map_type::const_iterator;
+        using reverse_iterator = typename map_type::reverse_iterator;
+        using const_reverse_iterator = typename map_type::const_reverse_iterator;
+        using difference_type = typename map_type::difference_type;
+        using size_type = typename map_type::size_type;
+
+        cow_flat_map() = default;
+        ~cow_flat_map() = default;
+        cow_flat_map(cow_flat_map&&) = default;
+        cow_flat_map& operator=(cow_flat_map&&) = default;
+
+        /**
+         * @brief Constructs a copy of @other, sharing its storage unless a mutable reference to it was handed out.
+         *
+         * @param other The map to copy.
+         */
+        cow_flat_map(const cow_flat_map& other)
+            : m_map(other.shareable_storage())
+        {
+        }
+
+        /**
+         * @brief Replaces the contents with a copy of @other, sharing its storage unless a mutable reference to it was handed out.
+         *
+         * @param other The map to copy.
+         * @return cow_flat_map& *this.
+         */
+        cow_flat_map& operator=(const cow_flat_map& other)
+        {
+            if (this != &other) {
+                m_map = other.shareable_storage();
+                m_leaked = false;
+            }
+            return *this;
+        }
+
+        /**
+         * @brief Constructs a cow_flat_map which owns the elements of @map.
+         *
+         * @param map The flat_map to take the elements from.
+         */
+        explicit cow_flat_map(map_type map)
+            : m_map(std::make_shared<map_type>(std::move(map)))
+        {
+        }
+
+        /**
+         * @brief Constructs an empty cow_flat_map and inserts elements from the range [begin ,end ).
+         *
+         * @param begin range of elements to insert.
+         * @param end range of elements to insert.
+         */
+        template <typename It>
+        cow_flat_map(It begin, It end)
+            : cow_flat_map(map_type(begin, end))
+        {
+        }
+
+        /**
+         * @brief Constructs an empty cow_flat_map and inserts elements from the range [il.begin() ,il.end()).
+         *
+         * @param init An initializer_list.
+         */
+        cow_flat_map(std::initializer_list<value_type> init)
+            : cow_flat_map(map_type(init))
+        {
+        }
+
+        /**
+         * @brief Returns a read only view of the shared elements.
+         *
+         * @return const map_type& The underlying flat_map.
+         */
+        [[nodiscard]] const map_type& get() const noexcept
+        {
+            return m_map ? *m_map : empty_map();
+        }
+
+        /**
+         * @brief Checks if the storage is shared with another copy.
+         *
+         * @return true if a mutating call would copy the elements, false otherwise.
+         */
+        [[nodiscard]] bool shared() const noexcept
+        {
+            return m_map && (m_map.use_count() > 1);
+        }
+
+        /**
+         * @brief Makes the storage of this map unique, copying the elements if they are shared.
+         *
+         * @return map_type& The underlying flat_map, owned by this map only.
+         */
+        map_type& detach()
+        {
+            if (!m_map) {
+                m_map = std::make_shared<map_type>();
+            }
+            else if (m_map.use_count() > 1) {
+                m_map = std::make_shared<map_type>(*m_map);
+            }
+            return *m_map;
+        }
+
+        /**
+         * @brief Checks if a mutable reference or iterator to the storage was handed out, in which case copies deep-copy it.
+         *
+         * @return true if the storage is not shared by the next copy, false otherwise.
+         */
+        [[nodiscard]] bool leaked() const noexcept
+        {
+            return m_leaked;
+        }
+
+        /**
+         * @brief Returns an iterator to the first element contained in the container. Detaches shared storage.
+         *
+         * @return An iterator to the first element.
+         */
+        [[nodiscard]] iterator begin()
+        {
+            return leak().begin();
+        }
+
+        /**
+         * @brief Returns an iterator to the end of the container. Detaches shared storage.
+         *
+         * @return An iterator to the end of the container.
+         */
+        [[nodiscard]] iterator end()
+        {
+            return leak().end();
+        }
+
+        /**
+         * @brief Returns a const_iterator to the first element contained in the container.
+         *
+         * @return const_iterator to the first element.
+         */
+        [[nodiscard]] const_iterator begin() const noexcept
+        {
+            return get().begin();
+        }
+
+        /**
+         * @brief Returns a const_iterator to the end of the container.
+         *
+         * @return const_iterator to the end of the container.
+         */
+        [[nodiscard]] const_iterator end() const noexcept
+        {
+            return get().end();
+        }
+
+        /**
+         * @brief Returns a const_iterator to the first element contained in the container.
+         *
+         * @return const_iterator to the first element.
+         */
+        [[nodiscard]] const_iterator cbegin() const noexcept
+        {
+            return get().cbegin();
+        }
+
+        /**
+         * @brief Returns a const_iterator to the end of the container.
+         *
+         * @return const_iterator to the end of the container.
+         */
+        [[nodiscard]] const_iterator cend() const noexcept
+        {
+            return get().cend();
+        }
+
+        /**
+         * @brief Returns a reverse_iterator pointing to the beginning of the reversed container. Detaches shared storage.
+         *
+         * @return reverse_iterator to the beginning of the reversed container.
+         */
+        [[nodiscard]] reverse_iterator rbegin()
+        {
+            return leak().rbegin();
+        }
+
+        /**
+         * @brief  Returns a reverse_iterator pointing to the end of the reversed container. Detaches shared storage.
+         *
+         * @return reverse_iterator to the end of the reversed container.
+         */
+        [[nodiscard]] reverse_iterator rend()
+        {
+            return leak().rend();
+        }
+
+        /**
+         * @brief Returns a const_reverse_iterator pointing to the beginning of the reversed container.
+         *
+         * @return const_reverse_iterator to the beginning of the reversed container.
+         */
+        [[nodiscard]] const_reverse_iterator crbegin() const noexcept
+        {
+            return get().crbegin();
+        }
+
+        /**
+         * @brief Returns a const_reverse_iterator pointing to the end of the reversed container.
+         *
+         * @return const_reverse_iterator to the end of the reversed container.
+         */
+        [[nodiscard]] const_reverse_iterator crend() const noexcept
+        {
+            return get().crend();
+        }
+
+        /**
+         * @brief Checks the empyiness of the container
+         *
+         * @return true if the container contains no elemets, false otherwise.
+         */
+        [[nodiscard]] bool empty() const noexcept
+        {
+            return get().empty();
+        }
+
+        /**
+         * @brief  Returns the number of the elements contained in the container.
+         *
+         * @return The number of the elements of container.
+         */
+        [[nodiscard]] size_type size() const noexcept
+        {
+            return get().size();
+        }
+
+        /**
+         * @brief Returns the largest possible size of the container.
+         *
+         * @return The largest possible size.
+         */
+        [[nodiscard]] size_type max_size() const noexcept
+        {
+            return get().max_size();
+        }
+
+        /**
+         * @brief Number of elements for which memory has been allocated in the storage.
+         *
+         * @return Number of elements for which memory has been allocated.
+         */
+        [[nodiscard]] size_type capacity() const noexcept
+        {
+            return get().capacity();
+        }
+
+        /**
+         * @brief Requests allocation of memory for at least @size elements. Detaches shared storage.
+         *
+         * @param size Requested size for allocation of additional memory.
+         */
+        void reserve(size_type size)
+        {
+            detach().reserve(size);
+        }
+
+        /**
+         * @brief If there is no key equivalent to @key in the map, inserts value_type(@key, T()). Detaches shared storage.
+         *
+         * @param key The key of the element to find.
+         * @return mapped_type& A reference to the mapped_type corresponding to @key in *this.
+         */
+        mapped_type& operator[] (const key_type& key)
+        {
+            return leak()[key];
+        }
+
+        /**
+         * @brief If there is no key equivalent to @key in the map, inserts value_type(move(@key), T()). Detaches shared storage.
+         *
+         * @param key The key of the element to find.
+         * @return mapped_type& A reference to the mapped_type corresponding to @key in *this.
+         */
+        mapped_type& operator[] (key_type&& key)
+        {
+            return leak()[std::move(key)];
+        }
+
+        /**
+         * @brief Returns a reference to the element whose key is equivalent to @key. Detaches shared storage.
+         *        Throws an exception object of type out_of_range if no such element is present.
+         *
+         * @param key The key of the element to find.
+         * @return mapped_type& A reference to the element whose key is equivalent to @key.
+         */
+        mapped_type& at(const key_type& key)
+        {
+            get().at(key);
+            return leak().at(key);
+        }
+
+        /**
+         * @brief Returns a reference to the element whose key is equivalent to @key.
+         *        Throws an exception object of type out_of_range if no such element is present.
+         *
+         * @param key The key of the element to find.
+         * @return const mapped_type& A const reference to the element whose key is equivalent to @key.
+         */
+        const mapped_type& at(const key_type& key) const
+        {
+            return get().at(key);
+        }
+
+        /**
+         * @brief  Inserts value if and only if there is no element in the container with key equivalent to the key of value.
+         *         Detaches shared storage.
+         *
+         * @param value std::pair<Key,T> for insertion.
+         * @return std::pair<iterator, bool> The bool component of the returned pair is true if and only if the insertion takes place,
+         *         and the iterator component of the pair points to the element with key equivalent to the key of @key.
+         */
+        std::pair<iterator, bool> insert(const value_type& value)
+        {
+            return emplace(value);
+        }
+
+        /**
+         * @brief Inserts a new value_type move constructed from the pair if and only if there is no element in the container with key equivalent to the key of value.
+         *        Detaches shared storage.
+         *
+         * @param value std::pair<Key,T> for insertion.
+         * @return std::pair<iterator, bool> The bool component of the returned pair is true if and only if the insertion takes place,
+         *               and the iterator component of the pair points to the element with key equivalent to the key of @key.
+         */
+        std::pair<iterator, bool> insert(value_type&& value)
+        {
+            return emplace(std::move(value));
+        }
+
+        /**
+         * @brief Inserts each element from the range [first,last) if and only if there is no element with key equivalent to the key of that element.
+         *        Detaches shared storage.
+         *
+         * @param begin range of elements to insert.
+         * @param end range of elements to insert.
+         */
+        template <typename It>
+        void insert(It begin, It end)
+        {
+            detach().insert(begin, end);
+        }
+
+        /**
+         * @brief Inserts each element from the range [il.begin(), il.end()) if and only if there is no element with key equivalent to the key of that element.
+         *        Detaches shared storage.
+         *
+         * @param il An initializer_list.
+         */
+        void insert(std::initializer_list<value_type> il)
+        {
+            detach().insert(il);
+        }
+
+        /**
+         * @brief Constructs a value_type from @first and @args and inserts it if there is no element with an equivalent key.
+         *        Detaches shared storage.
+         *
+         * @param first
+         * @param args
+         * @return std::pair<iterator, bool> The bool component of the returned pair is true if and only if the insertion took place, and
+                   the iterator component of the pair points to the element with key equivalent to the key of t
+         */
+        template <typename First, typename ... Args>
+        std::pair<iterator, bool> emplace(First&& first, Args&& ... args)
+        {
+            return leak().emplace(std::forward<First>(first), std::forward<Args>(args) ...);
+        }
+
+        /**
+         * @brief Erases the element pointed to by it. Detaches shared storage.
+         *
+         * @param it Iterator pointing to the element to be erased, obtained from this map or from get().
+         * @return iterator An iterator pointing to the element immediately following the erased one. If no such element exists, returns end().
+         */
+        iterator erase(const_iterator it)
+        {
+            difference_type index = it - get().cbegin();
+            map_type& map = leak();
+            return map.erase(map.cbegin() + index);
+        }
+
+        /**
+         * @brief Erases element in the container with key equivalent to @key.
+         *        Shared storage is detached only if such an element exists.
+         *
+         * @param key Key value of the element to remove.
+         * @return  0 if @key not found in container, 1 otherwise.
+         */
+        size_type erase(const key_type& key)
+        {
+            if (get().find(key) == get().end()) {
+                return 0;
+            }
+            return detach().erase(key);
+        }
+
+        /**
+         * @brief Erases all the elements in the range [first, last). Detaches shared storage.
+         *
+         * @param first range of elements to remove.
+         * @param last range of elements to remove.
+         * @return iterator to the next of the last deleted element.
+         */
+        iterator erase(const_iterator first, const_iterator last)
+        {
+            difference_type from = first - get().cbegin();
+            difference_type to = last - get().cbegin();
+            map_type& map = leak();
+            return map.erase(map.cbegin() + from, map.cbegin() + to);
+        }
+
+        /**
+         * @brief Swaps the contents of *this and other.
+         *
+         * @param other cow_flat_map with which must be swapped.
+         */
+        void swap(cow_flat_map& other) noexcept
+        {
+            m_map.swap(other.m_map);
+            std::swap(m_leaked, other.m_leaked);
+        }
+
+        /**
+         * @brief Erases all elements in container. Releases shared storage without copying it.
+         *
+         */
+        void clear()
+        {
+            m_map.reset();
+            m_leaked = false;
+        }
+
+        /**
+         * @brief Returns the comparison object out of which a was constructed.
+         *
+         * @return key_compare The comparison object
+         */
+        key_compare key_comp() const
+        {
+            return get().key_comp();
+        }
+
+        /**
+         * @brief Returns an object of value_compare constructed out of the comparison object.
+         *
+         * @return value_compare An object of value_compare.
+         */
+        value_compare value_comp() const
+        {
+            return get().value_comp();
+        }
+
+        /**
+         * @brief Attempts to find an element with key equivalent to @key. Detaches shared storage.
+         *
+         * @param key Key value of the element to search for.
+         * @return iterator An iterator pointing to an element with the key equivalent to key, or end() if such an element is not found.
+         */
+        template <typename T>
+        iterator find(const T& key)
+        {
+            return leak().find(key);
+        }
+
+        /**
+         * @brief Attempts to find an element with key equivalent to @key.
+         *
+         * @param key Key value of the element to search for.
+         * @return const_iterator A const_iterator pointing to an element with the key equivalent to @key, or end() if such an element is not found.
+         */
+        template <typename T>
+        const_iterator find(const T& key) const
+        {
+            return get().find(key);
+        }
+
+        /**
+         * @brief Finds the first element with key not less than @key, or end() if such an element is not found.
+         *
+         * @param key Key value to compare the elements to.
+         * @return const_iterator An const iterator pointing to the first element with key not less than k, or end() if such an element is not found.
+         */
+        template <typename T>
+        const_iterator lower_bound(const T& key) const
+        {
+            return get().lower_bound(key);
+        }
+
+        /**
+         * @brief Finds the first element with key greater than @key, or end() if such an element is not found.
+         *
+         * @param key Key value to compare the elements to.
+         * @return const_iterator An const iterator pointing to the first element with key greater than @key, or end() if such an element is not found.
+         */
+        template <typename T>
+        const_iterator upper_bound(const T& key) const
+        {
+            return get().upper_bound(key);
+        }
+
+        /**
+         * @brief  Returns a range containing all elements equivalent to value in the range [first, last).
+         *
+         * @param key Key value to compare the elements to.
+         * @return std::pair<const_iterator, const_iterator> std::pair containing a pair of iterators defining the wanted range.
+         */
+        template <typename T>
+        std::pair<const_iterator, const_iterator> equal_range(const T& key) const
+        {
+            return get().equal_range(key);
+        }
+
+        /**
+         * @brief Returns a copy of the allocator of the storage.
+         *
+         * @return allocator_type Copy of the allocator.
+         */
+        allocator_type get_allocator() const
+        {
+            return get().get_allocator();
+        }
+
+        /**
+         * @brief Compares two cow_flat_maps, maps sharing their storage are equal without comparing the elements.
+         *
+         * @param other A cow_flat_map with which need to compare.
+         * @return true if they are equal,false otherwise.
+         */
+        bool operator== (const cow_flat_map& other) const
+        {
+            return (m_map == other.m_map) || (get() == other.get());
+        }
+
+        /**
+         * @brief Compares two cow_flat_maps.
+         *
+         * @param other A cow_flat_map with which need to compare.
+         * @return true if they are unequal,false otherwise.
+         */
+        bool operator!= (const cow_flat_map& other) const
+        {
+            return !(*this == other);
+        }
+
+        /**
+         * @brief Compares two cow_flat_maps.
+         *
+         * @param other A cow_flat_map with which need to compare.
+         * @return true if current cow_flat_map is less than other.
+         */
+        bool operator< (const cow_flat_map& other) const
+        {
+            return get() < other.get();
+        }
+
+    private:
+        std::shared_ptr<map_type> m_map;
+        bool m_leaked = false;
+
+        /**
+         * @brief Detaches the storage and marks it as leaked, before handing out a mutable reference or iterator to it.
+         */
+        map_type& leak()
+        {
+            map_type& map = detach();
+            m_leaked = true;
+            return map;
+        }
+
+        /**
+         * @brief Returns the storage a copy of this map starts with: the shared storage, or a deep copy of it if it leaked.
+         */
+        std::shared_ptr<map_type> shareable_storage() const
+        {
+            if (m_leaked && m_map) {
+                return std::make_shared<map_type>(*m_map);
+            }
+            return m_map;
+        }
+
+        static const map_type& empty_map()
+        {
+            static const map_type empty;
+            return empty;
+        }
+    };
+
+    template <typename K, typename V, typename C, typename A>
+    void swap(cow_flat_map<K, V, C, A>& lhs, cow_flat_map<K, V, C, A>& rhs) noexcept
+    {
+        lhs.swap(rhs);
+    }
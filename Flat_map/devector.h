@@ -0,0 +1,685 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "flat_map.h"
+#include "relocatable_vector.h"
+
+    /**
+     * @brief A double-ended vector: the elements are contiguous in the middle of a buffer with free space at both ends.
+     *        Insertion and erasure shift whichever side of the position is shorter, so they move at most half of the elements,
+     *        and insertion and erasure at the front are O(1) amortized. Shifts use memmove when is_trivially_relocatable holds.
+     *        It can be used as the Container of flat_map, see devector_flat_map.
+     *
+     * @tparam T is the element type.
+     * @tparam std::allocator<T> the allocator to allocate the buffer.
+     */
+    template <typename T, typename Allocator = std::allocator<T>>
+    struct devector
+    {
+        using value_type = T;
+        using allocator_type = Allocator;
+        using size_type = std::size_t;
+        using difference_type = std::ptrdiff_t;
+        using reference = T&;
+        using const_reference = const T&;
+        using pointer = T*;
+        using const_pointer = const T*;
+        using iterator = T*;
+        using const_iterator = const T*;
+        using reverse_iterator = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+        static constexpr bool relocatable = is_trivially_relocatable_v<T>;
+
+        devector() = default;
+
+        devector(const devector& other)
+            : m_alloc(alloc_traits::select_on_container_copy_construction(other.m_alloc))
+        {
+            if (!other.empty()) {
+                allocate(other.size(), 0);
+                try
+                {
+                    m_end = std::uninitialized_copy(other.begin(), other.end(), m_begin);
+                }
+                catch (...)
+                {
+                    alloc_traits::deallocate(m_alloc, m_buffer, m_capacity);
+                    m_buffer = m_begin = m_end = nullptr;
+                    m_capacity = 0;
+                    throw;
+                }
+            }
+        }
+
+        devector(devector&& other) noexcept
+            : m_alloc(std::move(other.m_alloc))
+            , m_buffer(std::exchange(other.m_buffer, nullptr))
+            , m_begin(std::exchange(other.m_begin, nullptr))
+            , m_end(std::exchange(other.m_end, nullptr))
+            , m_capacity(std::exchange(other.m_capacity, 0))
+        {
+        }
+
+        devector& operator=(const devector& other)
+        {
+            if (this != &other) {
+                devector copy(other);
+                swap(copy);
+            }
+            return *this;
+        }
+
+        devector& operator=(devector&& other) noexcept
+        {
+            devector moved(std::move(other));
+            swap(moved);
+            return *this;
+        }
+
+        ~devector()
+        {
+            std::destroy(m_begin, m_end);
+            if (m_buffer != nullptr) {
+                alloc_traits::deallocate(m_alloc, m_buffer, m_capacity);
+            }
+        }
+
+        /**
+         * @brief Returns an iterator to the first element.
+         */
+        [[nodiscard]] iterator begin() noexcept
+        {
+            return m_begin;
+        }
+
+        /**
+         * @brief Returns an iterator past the last element.
+         */
+        [[nodiscard]] iterator end() noexcept
+        {
+            return m_end;
+        }
+
+        /**
+         * @brief Returns an iterator to the first element.
+         */
+        [[nodiscard]] const_iterator begin() const noexcept
+        {
+            return m_begin;
+        }
+
+        /**
+         * @brief Returns an iterator past the last element.
+         */
+        [[nodiscard]] const_iterator end() const noexcept
+        {
+            return m_end;
+        }
+
+        /**
+         * @brief Returns a const_iterator to the first element.
+         */
+        [[nodiscard]] const_iterator cbegin() const noexcept
+        {
+            return m_begin;
+        }
+
+        /**
+         * @brief Returns a const_iterator past the last element.
+         */
+        [[nodiscard]] const_iterator cend() const noexcept
+        {
+            return m_end;
+        }
+
+        /**
+         * @brief Returns a reverse iterator to the last element.
+         */
+        [[nodiscard]] reverse_iterator rbegin() noexcept
+        {
+            return reverse_iterator(end());
+        }
+
+        /**
+         * @brief Returns a reverse iterator before the first element.
+         */
+        [[nodiscard]] reverse_iterator rend() noexcept
+        {
+            return reverse_iterator(begin());
+        }
+
+        /**
+         * @brief Returns a reverse iterator to the last element.
+         */
+        [[nodiscard]] const_reverse_iterator rbegin() const noexcept
+        {
+            return const_reverse_iterator(end());
+        }
+
+        /**
+         * @brief Returns a reverse iterator before the first element.
+         */
+        [[nodiscard]] const_reverse_iterator rend() const noexcept
+        {
+            return const_reverse_iterator(begin());
+        }
+
+        /**
+         * @brief Returns a const reverse iterator to the last element.
+         */
+        [[nodiscard]] const_reverse_iterator crbegin() const noexcept
+        {
+            return rbegin();
+        }
+
+        /**
+         * @brief Returns a const reverse iterator before the first element.
+         */
+        [[nodiscard]] const_reverse_iterator crend() const noexcept
+        {
+            return rend();
+        }
+
+        /**
+         * @brief Returns a pointer to the first element.
+         */
+        [[nodiscard]] T* data() noexcept
+        {
+            return m_begin;
+        }
+
+        /**
+         * @brief Returns a pointer to the first element.
+         */
+        [[nodiscard]] const T* data() const noexcept
+        {
+            return m_begin;
+        }
+
+        /**
+         * @brief Returns the element at @index.
+         */
+        [[nodiscard]] T& operator[] (size_type index) noexcept
+        {
+            return m_begin[index];
+        }
+
+        /**
+         * @brief Returns the element at @index.
+         */
+        [[nodiscard]] const T& operator[] (size_type index) const noexcept
+        {
+            return m_begin[index];
+        }
+
+        /**
+         * @brief Returns the first element.
+         */
+        [[nodiscard]] T& front() noexcept
+        {
+            return *m_begin;
+        }
+
+        /**
+         * @brief Returns the first element.
+         */
+        [[nodiscard]] const T& front() const noexcept
+        {
+            return *m_begin;
+        }
+
+        /**
+         * @brief Returns the last element.
+         */
+        [[nodiscard]] T& back() noexcept
+        {
+            return *(m_end - 1);
+        }
+
+        /**
+         * @brief Returns the last element.
+         */
+        [[nodiscard]] const T& back() const noexcept
+        {
+            return *(m_end - 1);
+        }
+
+        /**
+         * @brief Checks whether the container has no elements.
+         */
+        [[nodiscard]] bool empty() const noexcept
+        {
+            return m_begin == m_end;
+        }
+
+        /**
+         * @brief Returns the number of elements.
+         */
+        [[nodiscard]] size_type size() const noexcept
+        {
+            return m_end - m_begin;
+        }
+
+        /**
+         * @brief Returns the number of elements the container can hold without growing at the back.
+         */
+        [[nodiscard]] size_type capacity() const noexcept
+        {
+            return m_capacity - front_slack();
+        }
+
+        /**
+         * @brief Returns the largest possible size of the container.
+         */
+        [[nodiscard]] size_type max_size() const noexcept
+        {
+            return alloc_traits::max_size(m_alloc);
+        }
+
+        /**
+         * @brief Returns a copy of the allocator of the container.
+         */
+        [[nodiscard]] allocator_type get_allocator() const
+        {
+            return m_alloc;
+        }
+
+        /**
+         * @brief Grows the space available from the first element to the end of the buffer to at least @capacity elements.
+         *
+         * @param capacity Requested capacity.
+         */
+        void reserve(size_type capacity)
+        {
+            if (capacity > this->capacity()) {
+                reallocate(front_slack() + capacity, front_slack());
+            }
+        }
+
+        /**
+         * @brief Releases the free space at both ends.
+         *
+         */
+        void shrink_to_fit()
+        {
+            if (size() < m_capacity) {
+                reallocate(size(), 0);
+            }
+        }
+
+        /**
+         * @brief Constructs an element from @args before @pos, shifting the elements before @pos towards the front
+         *        if they are fewer than the elements after it, and the elements after @pos towards the back otherwise.
+         *
+         * @param pos Iterator before which the element is constructed.
+         * @param args Arguments to construct the element from.
+         * @return iterator An iterator pointing to the new element.
+         */
+        template <typename ... Args>
+        iterator emplace(const_iterator pos, Args&& ... args)
+        {
+            size_type index = pos - m_begin;
+            bool towards_front = index < size() - index;
+            if constexpr (relocatable) {
+                alignas(T) unsigned char buffer[sizeof(T)];
+                T* element = ::new (static_cast<void*>(buffer)) T(std::forward<Args>(args) ...);
+                try
+                {
+                    if (towards_front ? (front_slack() == 0) : (back_slack() == 0)) {
+                        grow();
+                    }
+                }
+                catch (...)
+                {
+                    element->~T();
+                    throw;
+                }
+                if (towards_front) {
+                    std::memmove(static_cast<void*>(m_begin - 1), m_begin, index * sizeof(T));
+                    --m_begin;
+                }
+                else {
+                    std::memmove(static_cast<void*>(m_begin + index + 1), m_begin + index, (size() - index) * sizeof(T));
+                    ++m_end;
+                }
+                std::memcpy(static_cast<void*>(m_begin + index), buffer, sizeof(T));
+            }
+            else if (towards_front) {
+                emplace_front(std::forward<Args>(args) ...);
+                std::rotate(m_begin, m_begin + 1, m_begin + index + 1);
+            }
+            else {
+                emplace_back(std::forward<Args>(args) ...);
+                std::rotate(m_begin + index, m_end - 1, m_end);
+            }
+            return m_begin + index;
+        }
+
+        /**
+         * @brief Inserts a copy of @value before @pos.
+         *
+         * @param pos Iterator before which the element is inserted.
+         * @param value The element to insert.
+         * @return iterator An iterator pointing to the new element.
+         */
+        iterator insert(const_iterator pos, const T& value)
+        {
+            return emplace(pos, value);
+        }
+
+        /**
+         * @brief Inserts @value before @pos.
+         *
+         * @param pos Iterator before which the element is inserted.
+         * @param value The element to insert.
+         * @return iterator An iterator pointing to the new element.
+         */
+        iterator insert(const_iterator pos, T&& value)
+        {
+            return emplace(pos, std::move(value));
+        }
+
+        /**
+         * @brief Constructs an element from @args at the end.
+         *
+         * @param args Arguments to construct the element from.
+         * @return T& The new element.
+         */
+        template <typename ... Args>
+        T& emplace_back(Args&& ... args)
+        {
+            if (back_slack() == 0) {
+                T element(std::forward<Args>(args) ...);
+                grow();
+                alloc_traits::construct(m_alloc, m_end, std::move(element));
+            }
+            else {
+                alloc_traits::construct(m_alloc, m_end, std::forward<Args>(args) ...);
+            }
+            return *m_end++;
+        }
+
+        /**
+         * @brief Constructs an element from @args at the front.
+         *
+         * @param args Arguments to construct the element from.
+         * @return T& The new element.
+         */
+        template <typename ... Args>
+        T& emplace_front(Args&& ... args)
+        {
+            if (front_slack() == 0) {
+                T element(std::forward<Args>(args) ...);
+                grow();
+                alloc_traits::construct(m_alloc, m_begin - 1, std::move(element));
+            }
+            else {
+                alloc_traits::construct(m_alloc, m_begin - 1, std::forward<Args>(args) ...);
+            }
+            return *--m_begin;
+        }
+
+        /**
+         * @brief Appends up to @count elements constructed by @op directly in uninitialized storage.
+         *        @op is called as op(T* first, size_type count) and returns the number of elements it constructed.
+         *
+         * @param count The maximal number of elements to append.
+         * @param op The function constructing the elements.
+         */
+        template <typename Op>
+        void append_and_overwrite(size_type count, Op op)
+        {
+            reserve(size() + count);
+            size_type written = op(m_end, count);
+            m_end += std::min(written, count);
+        }
+
+        /**
+         * @brief Appends a copy of @value.
+         */
+        void push_back(const T& value)
+        {
+            emplace_back(value);
+        }
+
+        /**
+         * @brief Appends @value.
+         */
+        void push_back(T&& value)
+        {
+            emplace_back(std::move(value));
+        }
+
+        /**
+         * @brief Prepends a copy of @value.
+         */
+        void push_front(const T& value)
+        {
+            emplace_front(value);
+        }
+
+        /**
+         * @brief Prepends @value.
+         */
+        void push_front(T&& value)
+        {
+            emplace_front(std::move(value));
+        }
+
+        /**
+         * @brief Destroys the last element.
+         */
+        void pop_back() noexcept
+        {
+            alloc_traits::destroy(m_alloc, --m_end);
+        }
+
+        /**
+         * @brief Destroys the first element.
+         */
+        void pop_front() noexcept
+        {
+            alloc_traits::destroy(m_alloc, m_begin++);
+        }
+
+        /**
+         * @brief Erases the element at @pos.
+         *
+         * @param pos Iterator pointing to the element to erase.
+         * @return iterator An iterator pointing to the element following the erased one.
+         */
+        iterator erase(const_iterator pos)
+        {
+            return erase(pos, pos + 1);
+        }
+
+        /**
+         * @brief Erases the elements in [first, last), closing the gap from whichever side has fewer elements.
+         *
+         * @param first range of elements to erase.
+         * @param last range of elements to erase.
+         * @return iterator An iterator pointing to the element following the erased ones.
+         */
+        iterator erase(const_iterator first, const_iterator last)
+        {
+            T* begin = m_begin + (first - m_begin);
+            T* end = m_begin + (last - m_begin);
+            size_type count = end - begin;
+            if (count == 0) {
+                return begin;
+            }
+            if (begin - m_begin < m_end - end) {
+                if constexpr (relocatable) {
+                    std::destroy(begin, end);
+                    std::memmove(static_cast<void*>(m_begin + count), m_begin, (begin - m_begin) * sizeof(T));
+                }
+                else {
+                    std::move_backward(m_begin, begin, end);
+                    std::destroy(m_begin, m_begin + count);
+                }
+                m_begin += count;
+                return end;
+            }
+            if constexpr (relocatable) {
+                std::destroy(begin, end);
+                std::memmove(static_cast<void*>(begin), end, (m_end - end) * sizeof(T));
+            }
+            else {
+                std::destroy(std::move(end, m_end, begin), m_end);
+            }
+            m_end -= count;
+            return begin;
+        }
+
+        /**
+         * @brief Resizes the container to @size elements, value-initializing the new ones at the back.
+         *
+         * @param size The new size.
+         */
+        void resize(size_type size)
+        {
+            if (size < this->size()) {
+                erase(m_begin + size, m_end);
+                return;
+            }
+            reserve(size);
+            std::uninitialized_value_construct(m_end, m_begin + size);
+            m_end = m_begin + size;
+        }
+
+        /**
+         * @brief Destroys all elements and keeps the buffer, with the free space split evenly between the ends.
+         */
+        void clear() noexcept
+        {
+            std::destroy(m_begin, m_end);
+            m_begin = m_end = m_buffer + m_capacity / 2;
+        }
+
+        /**
+         * @brief Swaps the contents of *this and @other.
+         */
+        void swap(devector& other) noexcept
+        {
+            using std::swap;
+            swap(m_alloc, other.m_alloc);
+            swap(m_buffer, other.m_buffer);
+            swap(m_begin, other.m_begin);
+            swap(m_end, other.m_end);
+            swap(m_capacity, other.m_capacity);
+        }
+
+        /**
+         * @brief Compares the elements of two containers for equality.
+         */
+        bool operator== (const devector& other) const
+        {
+            return std::equal(begin(), end(), other.begin(), other.end());
+        }
+
+        /**
+         * @brief Compares the elements of two containers for inequality.
+         */
+        bool operator!= (const devector& other) const
+        {
+            return !(*this == other);
+        }
+
+        /**
+         * @brief Compares the elements of two containers lexicographically.
+         */
+        bool operator< (const devector& other) const
+        {
+            return std::lexicographical_compare(begin(), end(), other.begin(), other.end());
+        }
+
+    private:
+        using alloc_traits = std::allocator_traits<Allocator>;
+
+        Allocator m_alloc;
+        T* m_buffer = nullptr;
+        T* m_begin = nullptr;
+        T* m_end = nullptr;
+        size_type m_capacity = 0;
+
+        size_type front_slack() const noexcept
+        {
+            return m_begin - m_buffer;
+        }
+
+        size_type back_slack() const noexcept
+        {
+            return m_buffer + m_capacity - m_end;
+        }
+
+        void allocate(size_type capacity, size_type offset)
+        {
+            m_buffer = alloc_traits::allocate(m_alloc, capacity);
+            m_capacity = capacity;
+            m_begin = m_end = m_buffer + offset;
+        }
+
+        /**
+         * @brief Doubles the buffer and centers the elements in it, leaving free space at both ends.
+         */
+        void grow()
+        {
+            size_type size = this->size();
+            size_type capacity = std::max<size_type>(2 * size + 2, 8);
+            reallocate(capacity, (capacity - size) / 2);
+        }
+
+        /**
+         * @brief Moves the elements to a new buffer of @capacity elements, starting @offset elements after its beginning.
+         */
+        void reallocate(size_type capacity, size_type offset)
+        {
+            size_type size = this->size();
+            T* buffer = alloc_traits::allocate(m_alloc, capacity);
+            T* begin = buffer + offset;
+            if constexpr (relocatable) {
+                if (size != 0) {
+                    std::memcpy(static_cast<void*>(begin), m_begin, size * sizeof(T));
+                }
+            }
+            else {
+                try
+                {
+                    std::uninitialized_move(m_begin, m_end, begin);
+                }
+                catch (...)
+                {
+                    alloc_traits::deallocate(m_alloc, buffer, capacity);
+                    throw;
+                }
+                std::destroy(m_begin, m_end);
+            }
+            if (m_buffer != nullptr) {
+                alloc_traits::deallocate(m_alloc, m_buffer, m_capacity);
+            }
+            m_buffer = buffer;
+            m_begin = begin;
+            m_end = begin + size;
+            m_capacity = capacity;
+        }
+    };
+
+    template <typename T, typename A>
+    void swap(devector<T, A>& lhs, devector<T, A>& rhs) noexcept
+    {
+        lhs.swap(rhs);
+    }
+
+    /**
+     * @brief A flat_map stored in a devector, whose insertions and erasures shift the shorter side of the position.
+     */
+    template <typename K, typename V, typename Comp = std::less<K>>
+    using devector_flat_map = flat_map<K, V, Comp, std::allocator<std::pair<K, V>>, devector<std::pair<K, V>>>;
@@ -0,0 +1,654 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "flat_map.h"
+
+    /**
+     * @brief A blocked Bloom filter: every key sets and tests bits inside a single 64-byte block, so a query touches
+     *        one cache line. It has no false negatives; with the default 10 bits per key the false positive rate is about 1%.
+     *
+     * @tparam K is the type of the keys.
+     * @tparam std::hash<K> the hash function for keys.
+     */
+    template <typename K, typename Hash = std::hash<K>>
+    struct blocked_bloom_filter
+    {
+        using key_type = K;
+        using hasher = Hash;
+        using size_type = std::size_t;
+
+        static constexpr size_type bits_per_key = 10;
+        static constexpr size_type bits_per_block = 512;
+        static constexpr size_type probes = 6;
+
+        blocked_bloom_filter() = default;
+
+        /**
+         * @brief Constructs an empty filter sized for @capacity keys.
+         *
+         * @param capacity The number of keys the filter is sized for.
+         */
+        explicit blocked_bloom_filter(size_type capacity)
+            : m_blocks(std::max<size_type>((capacity * bits_per_key + bits_per_block - 1) / bits_per_block, 1))
+            , m_capacity(capacity)
+        {
+        }
+
+        /**
+         * @brief Returns the number of keys the filter is sized for.
+         *
+         * @return size_type The capacity of the filter.
+         */
+        [[nodiscard]] size_type capacity() const noexcept
+        {
+            return m_capacity;
+        }
+
+        /**
+         * @brief Adds @key to the filter.
+         *
+         * @param key The key to add.
+         */
+        void insert(const key_type& key)
+        {
+            std::uint64_t hash = mix(hasher()(key));
+            std::uint64_t bits = mix(hash);
+            block_type& block = m_blocks[block_of(hash)];
+            for (size_type i = 0; i < probes; ++i) {
+                size_type bit = (bits >> (i * 9)) & (bits_per_block - 1);
+                block.words[bit / 64] |= std::uint64_t(1) << (bit % 64);
+            }
+        }
+
+        /**
+         * @brief Checks if @key may have been added to the filter.
+         *
+         * @param key The key to test.
+         * @return false if @key was certainly not added, true otherwise.
+         */
+        [[nodiscard]] bool may_contain(const key_type& key) const
+        {
+            if (m_blocks.empty()) {
+                return false;
+            }
+            std::uint64_t hash = mix(hasher()(key));
+            std::uint64_t bits = mix(hash);
+            const block_type& block = m_blocks[block_of(hash)];
+            bool result = true;
+            for (size_type i = 0; i < probes; ++i) {
+                size_type bit = (bits >> (i * 9)) & (bits_per_block - 1);
+                result &= ((block.words[bit / 64] >> (bit % 64)) & 1) != 0;
+            }
+            return result;
+        }
+
+        /**
+         * @brief Removes all keys from the filter.
+         *
+         */
+        void clear()
+        {
+            std::fill(std::begin(m_blocks), std::end(m_blocks), block_type{});
+        }
+
+    private:
+        /**
+         * @brief A block of the filter, aligned on a cache line so that a probe never straddles two lines.
+         */
+        struct alignas(64) block_type
+        {
+            std::uint64_t words[bits_per_block / 64];
+        };
+
+        std::vector<block_type> m_blocks;
+        size_type m_capacity = 0;
+
+        /**
+         * @brief Spreads the bits of a hash, std::hash of integers is usually the identity.
+         *        The block is selected by the mixed user hash and the bits inside it by the hash mixed once more.
+         */
+        static std::uint64_t mix(std::uint64_t hash) noexcept
+        {
+            hash ^= hash >> 33;
+            hash *= 0xff51afd7ed558ccdULL;
+            hash ^= hash >> 33;
+            hash *= 0xc4ceb9fe1a85ec53ULL;
+            hash ^= hash >> 33;
+            return hash;
+        }
+
+        size_type block_of(std::uint64_t hash) const noexcept
+        {
+            return static_cast<size_type>(((hash >> 32) * m_blocks.size()) >> 32);
+        }
+    };
+
+    /**
+     * @brief A flat_map with a lazily built blocked Bloom filter in front of its lookups, so that most lookups of
+     *        missing keys (find, contains, count, at) cost one cache line instead of a binary search.
+     *        The filter is built by the first lookup after a bulk operation, updated on single insertions,
+     *        and rebuilt when erasures have left too many stale keys in it.
+     *        The filter is built inside const lookups: call build_filter() before sharing the map between reader threads.
+     *
+     * @tparam K is the key_type of the map.
+     * @tparam V is the value_type of the map.
+     * @tparam std::hash<K> the hash function for Keys used by the filter.
+     * @tparam std::less<K> the ordering function for Keys.
+     * @tparam std::allocator<std::pair<K, V>> the allocator to allocate the value_types.
+     */
+    template <typename K
+        , typename V
+        , typename Hash = std::hash<K>
+        , typename Comp = std::less<K>
+        , typename Allocator = std::allocator<std::pair<K, V>>
+    >
+        struct filtered_flat_map
+    {
+        using map_type = flat_map<K, V, Comp, Allocator>;
+        using filter_type = blocked_bloom_filter<K, Hash>;
+        using key_type = typename map_type::key_type;
+        using mapped_type = typename map_type::mapped_type;
+        using value_type = typename map_type::value_type;
+        using hasher = Hash;
+        using key_compare = typename map_type::key_compare;
+        using value_compare = typename map_type::value_compare;
+        using allocator_type = typename map_type::allocator_type;
+        using iterator = typename map_type::iterator;
+        using const_iterator = typename map_type::const_iterator;
+        using reverse_iterator = typename map_type::reverse_iterator;
+        using const_reverse_iterator = typename map_type::const_reverse_iterator;
+        using difference_type = typename map_type::difference_type;
+        using size_type = typename map_type::size_type;
+
+        filtered_flat_map() = default;
+        ~filtered_flat_map() = default;
+        filtered_flat_map(filtered_flat_map&&) = default;
+        filtered_flat_map(const filtered_flat_map&) = default;
+        filtered_flat_map& operator=(filtered_flat_map&&) = default;
+        filtered_flat_map& operator=(const filtered_flat_map&) = default;
+
+        /**
+         * @brief Constructs a filtered_flat_map holding the elements of @map.
+         *
+         * @param map The flat_map to take the elements from.
+         */
+        explicit filtered_flat_map(map_type map)
+            : m_map(std::move(map))
+        {
+        }
+
+        /**
+         * @brief Constructs an empty filtered_flat_map and inserts elements from the range [begin ,end ).
+         *
+         * @param begin range of elements to insert.
+         * @param end range of elements to insert.
+         */
+        template <typename It>
+        filtered_flat_map(It begin, It end)
+            : filtered_flat_map(map_type(begin, end))
+        {
+        }
+
+        /**
+         * @brief Constructs an empty filtered_flat_map and inserts elements from the range [il.begin() ,il.end()).
+         *
+         * @param init An initializer_list.
+         */
+        filtered_flat_map(std::initializer_list<value_type> init)
+            : filtered_flat_map(map_type(init))
+        {
+        }
+
+        /**
+         * @brief Returns the sorted storage.
+         *
+         * @return const map_type& The underlying flat_map.
+         */
+        [[nodiscard]] const map_type& get() const noexcept
+        {
+            return m_map;
+        }
+
+        /**
+         * @brief Builds the filter now if it is missing or stale.
+         *
+         */
+        void build_filter() const
+        {
+            if (!m_stale) {
+                return;
+            }
+            m_filter = filter_type(std::max<size_type>(m_map.size() + m_map.size() / 2, 64));
+            for (const auto& value : m_map) {
+                m_filter.insert(value.first);
+            }
+            m_erased = 0;
+            m_stale = false;
+        }
+
+        /**
+         * @brief Returns an iterator to the first element contained in the container.
+         *
+         * @return An iterator to the first element.
+         */
+        [[nodiscard]] iterator begin() noexcept
+        {
+            return m_map.begin();
+        }
+
+        /**
+         * @brief Returns an iterator to the end of the container.
+         *
+         * @return An iterator to the end of the container.
+         */
+        [[nodiscard]] iterator end() noexcept
+        {
+            return m_map.end();
+        }
+
+        /**
+         * @brief Returns a const_iterator to the first element contained in the container.
+         *
+         * @return const_iterator to the first element.
+         */
+        [[nodiscard]] const_iterator begin() const noexcept
+        {
+            return m_map.begin();
+        }
+
+        /**
+         * @brief Returns a const_iterator to the end of the container.
+         *
+         * @return const_iterator to the end of the container.
+         */
+        [[nodiscard]] const_iterator end() const noexcept
+        {
+            return m_map.end();
+        }
+
+        /**
+         * @brief Returns a const_iterator to the first element contained in the container.
+         *
+         * @return const_iterator to the first element.
+         */
+        [[nodiscard]] const_iterator cbegin() const noexcept
+        {
+            return m_map.cbegin();
+        }
+
+        /**
+         * @brief Returns a const_iterator to the end of the container.
+         *
+         * @return const_iterator to the end of the container.
+         */
+        [[nodiscard]] const_iterator cend() const noexcept
+        {
+            return m_map.cend();
+        }
+
+        /**
+         * @brief Returns a reverse_iterator pointing to the beginning of the reversed container.
+         *
+         * @return reverse_iterator to the beginning of the reversed container.
+         */
+        [[nodiscard]] reverse_iterator rbegin() noexcept
+        {
+            return m_map.rbegin();
+        }
+
+        /**
+         * @brief  Returns a reverse_iterator pointing to the end of the reversed container.
+         *
+         * @return reverse_iterator to the end of the reversed container.
+         */
+        [[nodiscard]] reverse_iterator rend() noexcept
+        {
+            return m_map.rend();
+        }
+
+        /**
+         * @brief Checks the empyiness of the container
+         *
+         * @return true if the container contains no elemets, false otherwise.
+         */
+        [[nodiscard]] bool empty() const noexcept
+        {
+            return m_map.empty();
+        }
+
+        /**
+         * @brief  Returns the number of the elements contained in the container.
+         *
+         * @return The number of the elements of container.
+         */
+        [[nodiscard]] size_type size() const noexcept
+        {
+            return m_map.size();
+        }
+
+        /**
+         * @brief Requests allocation of memory for at least @size elements.
+         *
+         * @param size Requested size for allocation of additional memory.
+         */
+        void reserve(size_type size)
+        {
+            m_map.reserve(size);
+        }
+
+        /**
+         * @brief If there is no key equivalent to @key in the map, inserts value_type(@key, T()) into the map.
+         *
+         * @param key The key of the element to find.
+         * @return mapped_type& A reference to the mapped_type corresponding to @key in *this.
+         */
+        mapped_type& operator[] (const key_type& key)
+        {
+            return emplace(key, mapped_type()).first->second;
+        }
+
+        /**
+         * @brief Returns a reference to the element whose key is equivalent to @key.
+         *        Throws an exception object of type out_of_range if no such element is present.
+         *
+         * @param key The key of the element to find.
+         * @return mapped_type& A reference to the element whose key is equivalent to @key.
+         */
+        mapped_type& at(const key_type& key)
+        {
+            auto found = find(key);
+            if (found == end()) {
+                detail::throw_out_of_range("key passed to 'at' doesn't exist in this map");
+            }
+            return found->second;
+        }
+
+        /**
+         * @brief Returns a reference to the element whose key is equivalent to @key.
+         *        Throws an exception object of type out_of_range if no such element is present.
+         *
+         * @param key The key of the element to find.
+         * @return const mapped_type& A const reference to the element whose key is equivalent to @key.
+         */
+        const mapped_type& at(const key_type& key) const
+        {
+            auto found = find(key);
+            if (found == end()) {
+                detail::throw_out_of_range("key passed to 'at' doesn't exist in this map");
+            }
+            return found->second;
+        }
+
+        /**
+         * @brief  Inserts value if and only if there is no element in the container with key equivalent to the key of value.
+         *
+         * @param value std::pair<Key,T> for insertion.
+         * @return std::pair<iterator, bool> The bool component of the returned pair is true if and only if the insertion takes place,
+         *         and the iterator component of the pair points to the element with key equivalent to the key of @key.
+         */
+        std::pair<iterator, bool> insert(const value_type& value)
+        {
+            return emplace(value);
+        }
+
+        /**
+         * @brief Inserts a new value_type move constructed from the pair if and only if there is no element in the container with key equivalent to the key of value.
+         *
+         * @param value std::pair<Key,T> for insertion.
+         * @return std::pair<iterator, bool> The bool component of the returned pair is true if and only if the insertion takes place,
+         *               and the iterator component of the pair points to the element with key equivalent to the key of @key.
+         */
+        std::pair<iterator, bool> insert(value_type&& value)
+        {
+            return emplace(std::move(value));
+        }
+
+        /**
+         * @brief Inserts each element from the range [first,last) if and only if there is no element with key equivalent to the key of that element.
+         *        The filter is marked stale and rebuilt by the next lookup.
+         *
+         * @param begin range of elements to insert.
+         * @param end range of elements to insert.
+         */
+        template <typename It>
+        void insert(It begin, It end)
+        {
+            m_stale = true;
+            m_map.insert(begin, end);
+        }
+
+        /**
+         * @brief Inserts each element from the range [il.begin(), il.end()) if and only if there is no element with key equivalent to the key of that element.
+         *
+         * @param il An initializer_list.
+         */
+        void insert(std::initializer_list<value_type> il)
+        {
+            insert(std::begin(il), std::end(il));
+        }
+
+        /**
+         * @brief Constructs a value_type from @first and @args and inserts it if there is no element with an equivalent key.
+         *        The key is added to the filter, which is marked stale when it grows past the size it was built for.
+         *
+         * @param first
+         * @param args
+         * @return std::pair<iterator, bool> The bool component of the returned pair is true if and only if the insertion took place, and
+                   the iterator component of the pair points to the element with key equivalent to the key of t
+         */
+        template <typename First, typename ... Args>
+        std::pair<iterator, bool> emplace(First&& first, Args&& ... args)
+        {
+            auto inserted = m_map.emplace(std::forward<First>(first), std::forward<Args>(args) ...);
+            if (inserted.second && !m_stale) {
+                if (m_map.size() > m_filter.capacity()) {
+                    m_stale = true;
+                }
+                else {
+                    m_filter.insert(inserted.first->first);
+                }
+            }
+            return inserted;
+        }
+
+        /**
+         * @brief Erases the element pointed to by it. The key stays in the filter until it is rebuilt.
+         *
+         * @param it Iterator pointing to the element to be erased.
+         * @return iterator An iterator pointing to the element immediately following the erased one. If no such element exists, returns end().
+         */
+        iterator erase(const_iterator it)
+        {
+            note_erased(1);
+            return m_map.erase(it);
+        }
+
+        /**
+         * @brief Erases element in the container with key equivalent to @key.
+         *
+         * @param key Key value of the element to remove.
+         * @return  0 if @key not found in container, 1 otherwise.
+         */
+        size_type erase(const key_type& key)
+        {
+            auto found = find(key);
+            if (found == end()) {
+                return 0;
+            }
+            erase(found);
+            return 1;
+        }
+
+        /**
+         * @brief Erases all the elements in the range [first, last).
+         *
+         * @param first range of elements to remove.
+         * @param last range of elements to remove.
+         * @return iterator to the next of the last deleted element.
+         */
+        iterator erase(const_iterator first, const_iterator last)
+        {
+            note_erased(last - first);
+            return m_map.erase(first, last);
+        }
+
+        /**
+         * @brief Swaps the contents of *this and other.
+         *
+         * @param other filtered_flat_map with which must be swapped.
+         */
+        void swap(filtered_flat_map& other) noexcept
+        {
+            m_map.swap(other.m_map);
+            std::swap(m_filter, other.m_filter);
+            std::swap(m_erased, other.m_erased);
+            std::swap(m_stale, other.m_stale);
+        }
+
+        /**
+         * @brief Erases all elements in container.
+         *
+         */
+        void clear()
+        {
+            m_map.clear();
+            m_filter.clear();
+            m_erased = 0;
+        }
+
+        /**
+         * @brief Returns the comparison object out of which a was constructed.
+         *
+         * @return key_compare The comparison object
+         */
+        key_compare key_comp() const
+        {
+            return m_map.key_comp();
+        }
+
+        /**
+         * @brief Attempts to find an element with key equivalent to @key, consulting the filter first.
+         *
+         * @param key Key value of the element to search for.
+         * @return iterator An iterator pointing to an element with the key equivalent to key, or end() if such an element is not found.
+         */
+        [[nodiscard]] iterator find(const key_type& key)
+        {
+            return may_contain(key) ? m_map.find(key) : m_map.end();
+        }
+
+        /**
+         * @brief Attempts to find an element with key equivalent to @key, consulting the filter first.
+         *
+         * @param key Key value of the element to search for.
+         * @return const_iterator A const_iterator pointing to an element with the key equivalent to @key, or end() if such an element is not found.
+         */
+        [[nodiscard]] const_iterator find(const key_type& key) const
+        {
+            return may_contain(key) ? m_map.find(key) : m_map.end();
+        }
+
+        /**
+         * @brief Checks if there is an element with key equivalent to @key in the container, consulting the filter first.
+         *
+         * @param key Key value of the element to search for.
+         * @return true if there is such an element, false otherwise.
+         */
+        [[nodiscard]] bool contains(const key_type& key) const
+        {
+            return may_contain(key) && m_map.contains(key);
+        }
+
+        /**
+         * @brief Returns the number of elements with key equivalent to @key, consulting the filter first.
+         *
+         * @param key Key value of the element to count.
+         * @return 1 if the element is found, 0 otherwise.
+         */
+        [[nodiscard]] size_type count(const key_type& key) const
+        {
+            return contains(key) ? 1 : 0;
+        }
+
+        /**
+         * @brief Finds the first element with key not less than @key, or end() if such an element is not found.
+         *
+         * @param key Key value to compare the elements to.
+         * @return const_iterator An const iterator pointing to the first element with key not less than k, or end() if such an element is not found.
+         */
+        template <typename T>
+        [[nodiscard]] const_iterator lower_bound(const T& key) const
+        {
+            return m_map.lower_bound(key);
+        }
+
+        /**
+         * @brief Finds the first element with key greater than @key, or end() if such an element is not found.
+         *
+         * @param key Key value to compare the elements to.
+         * @return const_iterator An const iterator pointing to the first element with key greater than @key, or end() if such an element is not found.
+         */
+        template <typename T>
+        [[nodiscard]] const_iterator upper_bound(const T& key) const
+        {
+            return m_map.upper_bound(key);
+        }
+
+        /**
+         * @brief Compares two filtered_flat_maps.
+         *
+         * @param other A filtered_flat_map with which need to compare.
+         * @return true if they are equal,false otherwise.
+         */
+        bool operator== (const filtered_flat_map& other) const
+        {
+            return m_map == other.m_map;
+        }
+
+        /**
+         * @brief Compares two filtered_flat_maps.
+         *
+         * @param other A filtered_flat_map with which need to compare.
+         * @return true if they are unequal,false otherwise.
+         */
+        bool operator!= (const filtered_flat_map& other) const
+        {
+            return m_map != other.m_map;
+        }
+
+    private:
+        map_type m_map;
+        mutable filter_type m_filter;
+        mutable size_type m_erased = 0;
+        mutable bool m_stale = true;
+
+        bool may_contain(const key_type& key) const
+        {
+            if (m_map.empty()) {
+                return false;
+            }
+            build_filter();
+            return m_filter.may_contain(key);
+        }
+
+        /**
+         * @brief Erased keys stay in the filter as false positives, rebuild it once they are half of the keys it holds.
+         */
+        void note_erased(size_type count)
+        {
+            m_erased += count;
+            if (m_erased * 2 > m_map.size()) {
+                m_stale = true;
+            }
+        }
+    };
+
+    template <typename K, typename V, typename H, typename C, typename A>
+    void swap(filtered_flat_map<K, V, H, C, A>& lhs, filtered_flat_map<K, V, H, C, A>& rhs) noexcept
+    {
+        lhs.swap(rhs);
+    }
@@ -0,0 +1,324 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "flat_map.h"
+#include "relocatable_vector.h"
+
+namespace detail
+{
+    /**
+     * @brief Loads the 8 bytes at @bytes as a big-endian integer, with one load and one byte swap on little-endian targets.
+     */
+    inline std::uint64_t load_big_endian(const unsigned char* bytes) noexcept
+    {
+        std::uint64_t word;
+        std::memcpy(&word, bytes, sizeof(word));
+#if defined(_MSC_VER)
+        return _byteswap_uint64(word);
+#elif defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+        return __builtin_bswap64(word);
+#elif defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+        return word;
+#else
+        word = 0;
+        for (std::size_t i = 0; i < 8; ++i) {
+            word = (word << 8) | bytes[i];
+        }
+        return word;
+#endif
+    }
+}
+
+    /**
+     * @brief A bump allocator holding the bytes of the fixed_strings too long to be stored inline. The bytes are never moved
+     *        nor freed before the arena is destroyed, which must happen after the destruction of the strings pointing into it.
+     */
+    struct fixed_string_arena
+    {
+        using size_type = std::size_t;
+
+        /**
+         * @brief Constructs an empty arena which allocates its memory in chunks of @chunk_size bytes.
+         *
+         * @param chunk_size The size of the chunks, strings longer than it get their own chunk.
+         */
+        explicit fixed_string_arena(size_type chunk_size = 64 * 1024)
+            : m_chunk_size(std::max<size_type>(chunk_size, 64))
+        {
+        }
+
+        fixed_string_arena(const fixed_string_arena&) = delete;
+        fixed_string_arena& operator=(const fixed_string_arena&) = delete;
+
+        /**
+         * @brief Copies @bytes into the arena after their length.
+         *
+         * @param bytes The bytes to store.
+         * @return const char* The address of the record: the length as a std::uint32_t, then the bytes.
+         */
+        const char* store(std::string_view bytes)
+        {
+            if (bytes.size() > std::numeric_limits<std::uint32_t>::max()) {
+                throw std::length_error("fixed_string_arena record exceeds 4GB");
+            }
+            size_type needed = sizeof(std::uint32_t) + bytes.size();
+            if (m_used + needed > m_capacity) {
+                size_type capacity = std::max(needed, m_chunk_size);
+                m_chunks.push_back(std::make_unique<char[]>(capacity));
+                m_used = 0;
+                m_capacity = capacity;
+            }
+            char* record = m_chunks.back().get() + m_used;
+            auto length = static_cast<std::uint32_t>(bytes.size());
+            std::memcpy(record, &length, sizeof(length));
+            std::memcpy(record + sizeof(length), bytes.data(), bytes.size());
+            m_used += needed;
+            m_stored += needed;
+            return record;
+        }
+
+        /**
+         * @brief Returns the number of bytes stored in the arena, including the lengths of the records.
+         */
+        [[nodiscard]] size_type size() const noexcept
+        {
+            return m_stored;
+        }
+
+    private:
+        std::vector<std::unique_ptr<char[]>> m_chunks;
+        size_type m_chunk_size;
+        size_type m_used = 0;
+        size_type m_capacity = 0;
+        size_type m_stored = 0;
+    };
+
+    /**
+     * @brief A string key of fixed size which stores up to N - 1 bytes inline, zero padded, and its length in the last byte.
+     *        Comparing the bytes as N / 8 big-endian 64-bit words orders the strings byte-wise, like std::string, so two keys
+     *        compare with N / 8 integer comparisons. Longer strings keep their first N - 1 bytes inline, 0xFF as length and
+     *        their remaining bytes in a fixed_string_arena; they are only compared byte by byte when their inline bytes are equal.
+     *        fixed_string is trivially copyable, so maps of fixed_strings sort, merge and shift their elements with memmove.
+     *
+     * @tparam N the number of inline bytes, a multiple of 8 below 256.
+     */
+    template <std::size_t N>
+    struct fixed_string
+    {
+        static_assert((N % 8 == 0) && (N > 0) && (N < 256), "fixed_string size must be a multiple of 8 below 256");
+
+        using size_type = std::size_t;
+
+        /**
+         * @brief The length of the longest string stored without arena.
+         */
+        static constexpr size_type inline_capacity = N - 1;
+
+        /**
+         * @brief Constructs an empty string.
+         */
+        fixed_string() noexcept = default;
+
+        /**
+         * @brief Constructs a string from @value, which must fit inline.
+         *        Throws an exception object of type length_error if @value is longer than inline_capacity.
+         *
+         * @param value The bytes of the string.
+         */
+        explicit fixed_string(std::string_view value)
+        {
+            if (value.size() > inline_capacity) {
+                throw std::length_error("fixed_string needs an arena for strings longer than its inline capacity");
+            }
+            assign_inline(value);
+        }
+
+        /**
+         * @brief Constructs a string from @value, storing the bytes which do not fit inline in @arena.
+         *
+         * @param value The bytes of the string.
+         * @param arena The arena holding the bytes after the first inline_capacity ones.
+         */
+        fixed_string(std::string_view value, fixed_string_arena& arena)
+        {
+            if (value.size() <= inline_capacity) {
+                assign_inline(value);
+                return;
+            }
+            std::memcpy(m_bytes, value.data(), inline_capacity);
+            m_bytes[inline_capacity] = overflow_marker;
+            m_tail = arena.store(value.substr(inline_capacity));
+        }
+
+        /**
+         * @brief Checks whether all the bytes of the string are stored inline.
+         */
+        [[nodiscard]] bool is_inline() const noexcept
+        {
+            return m_bytes[inline_capacity] != overflow_marker;
+        }
+
+        /**
+         * @brief Returns the length of the string.
+         */
+        [[nodiscard]] size_type size() const noexcept
+        {
+            return is_inline() ? m_bytes[inline_capacity] : inline_capacity + tail().size();
+        }
+
+        /**
+         * @brief Checks whether the string is empty.
+         */
+        [[nodiscard]] bool empty() const noexcept
+        {
+            return size() == 0;
+        }
+
+        /**
+         * @brief Returns the bytes stored inline: the whole string if it is inline, its first inline_capacity bytes otherwise.
+         */
+        [[nodiscard]] std::string_view inline_view() const noexcept
+        {
+            return { reinterpret_cast<const char*>(m_bytes), is_inline() ? m_bytes[inline_capacity] : inline_capacity };
+        }
+
+        /**
+         * @brief Returns the bytes stored in the arena, empty if the string is inline.
+         */
+        [[nodiscard]] std::string_view tail() const noexcept
+        {
+            if (is_inline()) {
+                return {};
+            }
+            std::uint32_t length;
+            std::memcpy(&length, m_tail, sizeof(length));
+            return { m_tail + sizeof(length), length };
+        }
+
+        /**
+         * @brief Returns a copy of the string.
+         */
+        [[nodiscard]] std::string str() const
+        {
+            std::string result(inline_view());
+            result.append(tail());
+            return result;
+        }
+
+        /**
+         * @brief Compares the string with @other byte-wise.
+         *
+         * @return int A negative value, 0 or a positive value if *this is less than, equal to or greater than @other.
+         */
+        [[nodiscard]] int compare(const fixed_string& other) const noexcept
+        {
+            for (size_type i = 0; i < N; i += 8) {
+                std::uint64_t lhs = detail::load_big_endian(m_bytes + i);
+                std::uint64_t rhs = detail::load_big_endian(other.m_bytes + i);
+                if (lhs != rhs) {
+                    return (lhs < rhs) ? -1 : 1;
+                }
+            }
+            return is_inline() ? 0 : tail().compare(other.tail());
+        }
+
+        /**
+         * @brief Compares the string with @other byte-wise.
+         *
+         * @return int A negative value, 0 or a positive value if *this is less than, equal to or greater than @other.
+         */
+        [[nodiscard]] int compare(std::string_view other) const noexcept
+        {
+            std::string_view head = inline_view();
+            if (int result = head.compare(other.substr(0, head.size())); result != 0) {
+                return result;
+            }
+            if (is_inline()) {
+                return (head.size() < other.size()) ? -1 : 0;
+            }
+            return tail().compare(other.substr(head.size()));
+        }
+
+        friend bool operator== (const fixed_string& lhs, const fixed_string& rhs) noexcept
+        {
+            return lhs.compare(rhs) == 0;
+        }
+
+        friend bool operator!= (const fixed_string& lhs, const fixed_string& rhs) noexcept
+        {
+            return lhs.compare(rhs) != 0;
+        }
+
+        friend bool operator< (const fixed_string& lhs, const fixed_string& rhs) noexcept
+        {
+            return lhs.compare(rhs) < 0;
+        }
+
+        friend bool operator<= (const fixed_string& lhs, const fixed_string& rhs) noexcept
+        {
+            return lhs.compare(rhs) <= 0;
+        }
+
+        friend bool operator> (const fixed_string& lhs, const fixed_string& rhs) noexcept
+        {
+            return lhs.compare(rhs) > 0;
+        }
+
+        friend bool operator>= (const fixed_string& lhs, const fixed_string& rhs) noexcept
+        {
+            return lhs.compare(rhs) >= 0;
+        }
+
+        friend bool operator== (const fixed_string& lhs, std::string_view rhs) noexcept
+        {
+            return lhs.compare(rhs) == 0;
+        }
+
+        friend bool operator!= (const fixed_string& lhs, std::string_view rhs) noexcept
+        {
+            return lhs.compare(rhs) != 0;
+        }
+
+        friend bool operator< (const fixed_string& lhs, std::string_view rhs) noexcept
+        {
+            return lhs.compare(rhs) < 0;
+        }
+
+        friend bool operator< (std::string_view lhs, const fixed_string& rhs) noexcept
+        {
+            return rhs.compare(lhs) > 0;
+        }
+
+    private:
+        static constexpr unsigned char overflow_marker = 0xFF;
+
+        alignas(8) unsigned char m_bytes[N] = {};
+        const char* m_tail = nullptr;
+
+        void assign_inline(std::string_view value) noexcept
+        {
+            std::memcpy(m_bytes, value.data(), value.size());
+            m_bytes[inline_capacity] = static_cast<unsigned char>(value.size());
+        }
+    };
+
+    /**
+     * @brief A flat_map with fixed_string<N> keys stored in a relocatable_vector, so that key comparisons are integer comparisons
+     *        and insertions shift the elements with memmove. std::less<> lets find and lower_bound take std::string_view keys too,
+     *        which are compared byte by byte; fixed_string keys take the integer path.
+     */
+    template <typename V, std::size_t N = 16>
+    using fixed_string_flat_map = flat_map<fixed_string<N>, V, std::less<>, std::allocator<std::pair<fixed_string<N>, V>>
+        , relocatable_vector<std::pair<fixed_string<N>, V>>>;
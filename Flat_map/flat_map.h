@@ -1,14 +1,71 @@
 ﻿#pragma once
 
 #include <algorithm>
+#include <cstddef>
 #include <functional>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace detail
 {
     void throw_out_of_range(const char* message);
+
+    template <typename Container, typename Op, typename = void>
+    struct has_append_and_overwrite : std::false_type
+    {
+    };
+
+    template <typename Container, typename Op>
+    struct has_append_and_overwrite<Container, Op, std::void_t<decltype(std::declval<Container&>().append_and_overwrite(
+        std::declval<typename Container::size_type>(), std::declval<Op>()))>> : std::true_type
+    {
+    };
 }
 
+    /**
+     * @brief Tag type used to indicate that a range of elements is already sorted and contains unique keys.
+     */
+    struct sorted_unique_t
+    {
+        explicit sorted_unique_t() = default;
+    };
+
+    inline constexpr sorted_unique_t sorted_unique{};
+
+    /**
+     * @brief The sizes up to which lookups in a flat_map<K, V, Comp> use a kernel suited to small ranges instead of std::lower_bound.
+     *        The kernels are tried in order: a branch-free count of the elements less than the key, which the compiler vectorizes into
+     *        compares and adds; a linear scan stopping at the first element not less than the key; a binary search whose halving
+     *        step is a conditional move instead of a branch. The defaults enable them for arithmetic keys with std::less or
+     *        std::greater only, where comparisons are cheap; specialize this class to tune or enable them for other keys.
+     *
+     * @tparam K is the key_type of the map.
+     * @tparam Comp is the key_compare of the map.
+     */
+    template <typename K, typename Comp>
+    struct flat_map_search_traits
+    {
+        static constexpr bool cheap_compare = std::is_arithmetic_v<K>
+            && (std::is_same_v<Comp, std::less<K>> || std::is_same_v<Comp, std::less<>>
+                || std::is_same_v<Comp, std::greater<K>> || std::is_same_v<Comp, std::greater<>>);
+
+        /**
+         * @brief The largest size searched by counting the elements less than the key.
+         */
+        static constexpr std::size_t counting_threshold = cheap_compare ? 32 : 0;
+
+        /**
+         * @brief The largest size searched with a linear scan.
+         */
+        static constexpr std::size_t linear_threshold = cheap_compare ? 96 : 0;
+
+        /**
+         * @brief The largest size searched with a branchless binary search.
+         */
+        static constexpr std::size_t branchless_threshold = cheap_compare ? 1024 : 0;
+    };
+
     /**
      * @brief A flat_map is a kind of associative container that supports unique keys and provides for fast retrieval of values of another type T based on the keys.
      * The flat_map class supports random-access iterators.
@@ -17,11 +74,13 @@ namespace detail
      * @tparam V is the value_type of the map.
      * @tparam std::less<K> the ordering function for Keys.
      * @tparam std::allocator<std::pair<K, V>> the allocator to allocate the value_types.
+     * @tparam std::vector<std::pair<K, V>, Allocator> the sequence container storing the sorted elements.
      */
     template <typename K
         , typename V
         , typename Comp = std::less<K>
         , typename Allocator = std::allocator<std::pair<K, V>>
+        , typename Container = std::vector<std::pair<K, V>, Allocator>
     >
         struct flat_map
     {
@@ -43,7 +102,7 @@ namespace detail
         using const_reference = const V&;
         using pointer = typename std::allocator_traits<allocator_type>::pointer;
         using const_pointer = typename std::allocator_traits<allocator_type>::const_pointer;
-        using container_type = std::vector<value_type, allocator_type>;
+        using container_type = Container;
         using iterator = typename container_type::iterator;
         using const_iterator = typename container_type::const_iterator;
         using reverse_iterator = typename container_type::reverse_iterator;
@@ -79,6 +138,19 @@ namespace detail
             : flat_map(std::begin(init), std::end(init))
         {
         }
+
+        /**
+         * @brief Constructs an empty flat_map and inserts elements from the sorted range [begin ,end ) without sorting it.
+         *
+         * @param begin range of elements to insert, sorted by key and without equivalent keys.
+         * @param end range of elements to insert.
+         */
+        template <typename It>
+        flat_map(sorted_unique_t, It begin, It end)
+        {
+            insert(sorted_unique, begin, end);
+        }
+
         /**
          * @brief Returns an iterator to the first element contained in the container.
          *
@@ -402,12 +474,7 @@ namespace detail
                 }
                 throw;
             }
-            value_compare comp;
-            auto mid = std::begin(m_data) + size_before;
-            std::stable_sort(mid, std::end(m_data), comp);
-            std::inplace_merge(std::begin(m_data), mid, std::end(m_data), comp);
-            m_data.erase(std::unique(std::begin(m_data), std::end(m_data)
-                , std::not2(comp)), std::end(m_data));
+            merge_tail(size_before, false);
             if (m_data.size() == size_before) {
                 for (; begin != end; ++begin) {
                     if (emplace(*begin).second) {
@@ -419,6 +486,70 @@ namespace detail
             return insert(begin, end);
         }
 
+        /**
+         * @brief Inserts each element from the sorted range [first,last) if and only if there is no element with key equivalent to the key of that element.
+         *        The range is appended and merged in linear time instead of being sorted.
+         *
+         * @param begin range of elements to insert, sorted by key and without equivalent keys.
+         * @param end range of elements to insert.
+         */
+        template <typename It>
+        void insert(sorted_unique_t, It begin, It end)
+        {
+            size_type size_before = m_data.size();
+            try
+            {
+                for (; begin != end; ++begin) {
+                    m_data.emplace_back(*begin);
+                }
+            }
+            catch (...)
+            {
+                for (size_t i = m_data.size(); i > size_before; --i) {
+                    m_data.pop_back();
+                }
+                throw;
+            }
+            merge_tail(size_before, true);
+        }
+
+        /**
+         * @brief Appends up to @count elements written by @writer directly into the storage of the map, then sorts and merges them
+         *        like insert(begin, end): elements whose key is equivalent to the key of an existing or earlier element are dropped.
+         *        @writer is called once as writer(value_type* first, size_type count) and returns the number of elements it wrote,
+         *        which must not exceed count. When the container provides append_and_overwrite (relocatable_vector, devector),
+         *        the storage is uninitialized and @writer must construct the elements, which for trivially copyable value_types
+         *        can be a read() or a memcpy; otherwise the storage holds value-initialized elements which @writer assigns.
+         *
+         * @param count The maximal number of elements to load.
+         * @param writer The function writing the elements.
+         * @return size_type The number of inserted elements.
+         */
+        template <typename Writer>
+        size_type bulk_load(size_type count, Writer writer)
+        {
+            size_type size_before = m_data.size();
+            if constexpr (detail::has_append_and_overwrite<container_type, Writer&>::value) {
+                m_data.append_and_overwrite(count, writer);
+            }
+            else {
+                m_data.resize(size_before + count);
+                size_type written = 0;
+                try
+                {
+                    written = writer(m_data.data() + size_before, count);
+                }
+                catch (...)
+                {
+                    m_data.resize(size_before);
+                    throw;
+                }
+                m_data.resize(size_before + std::min(written, count));
+            }
+            merge_tail(size_before, false);
+            return m_data.size() - size_before;
+        }
+
         /**
          * @brief Inserts each element from the range [il.begin(), il.end()) if and only if there is no element with key equivalent to the key of that element.
          *
@@ -607,6 +738,30 @@ namespace detail
             return binary_find(begin(), end(), key, KeyOrValueCompare());
         }
 
+        /**
+         * @brief Checks if there is an element with key equivalent to @key in the container.
+         *
+         * @param key Key value of the element to search for.
+         * @return true if there is such an element, false otherwise.
+         */
+        template <typename T>
+        bool contains(const T& key) const
+        {
+            return find(key) != end();
+        }
+
+        /**
+         * @brief Returns the number of elements with key equivalent to @key.
+         *
+         * @param key Key value of the elements to count.
+         * @return size_type 1 if such an element is found, 0 otherwise.
+         */
+        template <typename T>
+        size_type count(const T& key) const
+        {
+            return contains(key) ? 1 : 0;
+        }
+
         /**
          * @brief Finds the first element with key not less than @key, or end() if such an element is not found.
          *
@@ -616,7 +771,7 @@ namespace detail
         template <typename T>
         iterator lower_bound(const T& key)
         {
-            return std::lower_bound(begin(), end(), key, KeyOrValueCompare());
+            return search_lower_bound(begin(), end(), key, KeyOrValueCompare());
         }
 
         /**
@@ -628,7 +783,7 @@ namespace detail
         template <typename T>
         const_iterator lower_bound(const T& key) const
         {
-            return std::lower_bound(begin(), end(), key, KeyOrValueCompare());
+            return search_lower_bound(begin(), end(), key, KeyOrValueCompare());
         }
 
         /**
@@ -681,6 +836,49 @@ namespace detail
             return std::equal_range(begin(), end(), key, KeyOrValueCompare());
         }
 
+        /**
+         * @brief Looks up every key of the sorted range [@first, @last) with a merge join: the search for a key gallops forward from
+         *        the position of the previous one, so M keys cost O(M log(N/M)) comparisons instead of O(M log N) for M calls to find.
+         *
+         * @param first range of keys sorted by key_compare, possibly with repetitions.
+         * @param last range of keys sorted by key_compare, possibly with repetitions.
+         * @param callback The function called in order with every key and an iterator to its element, or end() if it is not found.
+         */
+        template <typename It, typename F>
+        void join(It first, It last, F callback)
+        {
+            join_impl(begin(), end(), first, last, callback);
+        }
+
+        /**
+         * @brief Looks up every key of the sorted range [@first, @last) with a merge join: the search for a key gallops forward from
+         *        the position of the previous one, so M keys cost O(M log(N/M)) comparisons instead of O(M log N) for M calls to find.
+         *
+         * @param first range of keys sorted by key_compare, possibly with repetitions.
+         * @param last range of keys sorted by key_compare, possibly with repetitions.
+         * @param callback The function called in order with every key and a const_iterator to its element, or end() if it is not found.
+         */
+        template <typename It, typename F>
+        void join(It first, It last, F callback) const
+        {
+            join_impl(begin(), end(), first, last, callback);
+        }
+
+        /**
+         * @brief Looks up every key of the sorted range [@first, @last) with a merge join, like join().
+         *
+         * @param first range of keys sorted by key_compare, possibly with repetitions.
+         * @param last range of keys sorted by key_compare, possibly with repetitions.
+         * @param out The output iterator receiving, for every key, a const_iterator to its element, or end() if it is not found.
+         * @return Out The output iterator past the last written result.
+         */
+        template <typename It, typename Out>
+        Out lookup_sorted(It first, It last, Out out) const
+        {
+            join(first, last, [&out](const auto&, const_iterator found) { *out++ = found; });
+            return out;
+        }
+
         /**
          * @brief Returns a copy of the allocator that was passed to the object's constructor.
          *
@@ -760,6 +958,30 @@ namespace detail
     private:
         container_type m_data;
 
+        /**
+         * @brief Merges the elements appended after the first @size_before ones into the sorted elements, sorting them first
+         *        unless @sorted is true, and erases the appended elements whose key is equivalent to the key of an earlier element.
+         */
+        void merge_tail(size_type size_before, bool sorted)
+        {
+            value_compare comp;
+            auto mid = std::begin(m_data) + size_before;
+            if (mid == std::end(m_data)) {
+                return;
+            }
+            if (!sorted && !std::is_sorted(mid, std::end(m_data), comp)) {
+                std::stable_sort(mid, std::end(m_data), comp);
+            }
+            if ((mid != std::begin(m_data)) && !comp(*(mid - 1), *mid)) {
+                std::inplace_merge(std::begin(m_data), mid, std::end(m_data), comp);
+            }
+            else if (sorted) {
+                return;
+            }
+            m_data.erase(std::unique(std::begin(m_data), std::end(m_data)
+                , [&comp](const value_type& lhs, const value_type& rhs) { return !comp(lhs, rhs); }), std::end(m_data));
+        }
+
         iterator iterator_const_cast(const_iterator it)
         {
             return begin() + (it - cbegin());
@@ -824,16 +1046,89 @@ namespace detail
         template <typename It, typename T, typename Compare>
         static It binary_find(It begin, It end, const T& value, const Compare& cmp)
         {
-            auto lower_bound = std::lower_bound(begin, end, value, cmp);
+            auto lower_bound = search_lower_bound(begin, end, value, cmp);
             if ((lower_bound == end) || cmp(value, *lower_bound)) {
                 return end;
             }
             return lower_bound;
         }
+
+        /**
+         * @brief Finds the first element of [begin, end) not less than @value with the kernel flat_map_search_traits selects
+         *        for the size of the range.
+         *
+         * @param begin the range of elements to examine.
+         * @param end the range of elements to examine.
+         * @param value value to compare the elements to.
+         * @param cmp binary predicate which returns true if the first argument is less than (i.e. is ordered before) the second.
+         * @return It An iterator pointing to the first element not less than @value, or end.
+         */
+        template <typename It, typename T, typename Compare>
+        static It search_lower_bound(It begin, It end, const T& value, const Compare& cmp)
+        {
+            using traits = flat_map_search_traits<key_type, key_compare>;
+            auto size = static_cast<std::size_t>(end - begin);
+            if (size <= traits::counting_threshold) {
+                std::size_t less = 0;
+                for (auto it = begin; it != end; ++it) {
+                    less += cmp(*it, value) ? 1 : 0;
+                }
+                return begin + less;
+            }
+            if (size <= traits::linear_threshold) {
+                while ((begin != end) && cmp(*begin, value)) {
+                    ++begin;
+                }
+                return begin;
+            }
+            if (size <= traits::branchless_threshold) {
+                while (size > 1) {
+                    std::size_t half = size / 2;
+                    begin = cmp(begin[half - 1], value) ? begin + half : begin;
+                    size -= half;
+                }
+                return cmp(*begin, value) ? begin + 1 : begin;
+            }
+            return std::lower_bound(begin, end, value, cmp);
+        }
+
+        /**
+         * @brief Finds the first element of [begin, end) not less than @value with an exponential search from @begin: the probed
+         *        distance doubles until an element not less than @value is found, then the last gap is searched with binary search.
+         *
+         * @param begin the range of elements to examine.
+         * @param end the range of elements to examine.
+         * @param value value to compare the elements to.
+         * @param cmp binary predicate which returns true if the first argument is less than (i.e. is ordered before) the second.
+         * @return It An iterator pointing to the first element not less than @value, or end.
+         */
+        template <typename It, typename T, typename Compare>
+        static It gallop_lower_bound(It begin, It end, const T& value, const Compare& cmp)
+        {
+            if ((begin == end) || !cmp(*begin, value)) {
+                return begin;
+            }
+            auto size = end - begin;
+            decltype(size) bound = 1;
+            while ((bound < size) && cmp(begin[bound], value)) {
+                bound *= 2;
+            }
+            return std::lower_bound(begin + bound / 2 + 1, begin + std::min(bound, size), value, cmp);
+        }
+
+        template <typename MapIt, typename It, typename F>
+        static void join_impl(MapIt begin, MapIt end, It first, It last, F& callback)
+        {
+            KeyOrValueCompare comp;
+            for (auto cursor = begin; first != last; ++first) {
+                cursor = gallop_lower_bound(cursor, end, *first, comp);
+                callback(*first, ((cursor == end) || comp(*first, *cursor)) ? end : cursor);
+            }
+        }
     };
 
-    template <typename K, typename V, typename C, typename A>
-    void swap(flat_map<K, V, C, A>& lhs, flat_map<K, V, C, A>& rhs) noexcept
+    template <typename K, typename V, typename C, typename A, typename Cont>
+    void swap(flat_map<K, V, C, A, Cont>& lhs, flat_map<K, V, C, A, Cont>& rhs) noexcept
     {
         lhs.swap(rhs);
     }
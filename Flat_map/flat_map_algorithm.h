@@ -0,0 +1,511 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <numeric>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "flat_map.h"
+
+    /**
+     * @brief A range of contiguous map elements which can be split in halves, in the shape expected by TBB-like schedulers:
+     *        a range is divisible while it holds more than grain elements, and split() leaves the first half in *this and
+     *        returns the second half. When the size of the elements divides the cache line size, split points are moved to
+     *        the nearest cache line boundary by the address of the elements, so neighbouring halves share no cache line.
+     *
+     * @tparam It a random access iterator of the map.
+     */
+    template <typename It>
+    struct splittable_range
+    {
+        using iterator = It;
+        using size_type = std::size_t;
+
+        /**
+         * @brief The size of the cache lines chunks are aligned to.
+         */
+        static constexpr size_type cache_line = 64;
+
+        /**
+         * @brief Constructs the range [@begin, @end), which is split while it holds more than @grain elements.
+         */
+        splittable_range(It begin, It end, size_type grain = 1024)
+            : m_begin(begin)
+            , m_end(end)
+            , m_grain(std::max<size_type>(grain, 1))
+        {
+        }
+
+        /**
+         * @brief Returns an iterator to the first element of the range.
+         */
+        [[nodiscard]] It begin() const
+        {
+            return m_begin;
+        }
+
+        /**
+         * @brief Returns an iterator past the last element of the range.
+         */
+        [[nodiscard]] It end() const
+        {
+            return m_end;
+        }
+
+        /**
+         * @brief Returns the number of elements of the range.
+         */
+        [[nodiscard]] size_type size() const
+        {
+            return static_cast<size_type>(m_end - m_begin);
+        }
+
+        /**
+         * @brief Checks whether the range has no elements.
+         */
+        [[nodiscard]] bool empty() const
+        {
+            return m_begin == m_end;
+        }
+
+        /**
+         * @brief Returns the number of elements below which the range is not split.
+         */
+        [[nodiscard]] size_type grain() const
+        {
+            return m_grain;
+        }
+
+        /**
+         * @brief Checks whether the range holds enough elements to be split.
+         *
+         * @return true if the range holds more than grain() elements.
+         */
+        [[nodiscard]] bool is_divisible() const
+        {
+            return size() > m_grain;
+        }
+
+        /**
+         * @brief Splits the range in two halves whose boundary is the start of a cache line, if the halves stay non-empty.
+         *
+         * @return splittable_range The second half; *this keeps the first one.
+         */
+        splittable_range split()
+        {
+            size_type middle = size() / 2;
+            size_type offset = line_offset(m_begin + middle);
+            if (offset != 0) {
+                size_type up = elements_per_line() - offset;
+                if ((offset < middle) && contiguous(m_begin + (middle - offset), m_begin + middle)) {
+                    middle -= offset;
+                }
+                else if ((middle + up < size()) && contiguous(m_begin + middle, m_begin + (middle + up))) {
+                    middle += up;
+                }
+            }
+            It mid = m_begin + middle;
+            splittable_range second(mid, m_end, m_grain);
+            m_end = mid;
+            return second;
+        }
+
+    private:
+        using value_type = typename std::iterator_traits<It>::value_type;
+
+        static constexpr bool packs_lines()
+        {
+            return (sizeof(value_type) <= cache_line) && (cache_line % sizeof(value_type) == 0);
+        }
+
+        static constexpr size_type elements_per_line()
+        {
+            return packs_lines() ? cache_line / sizeof(value_type) : 1;
+        }
+
+        static std::uintptr_t address_of(It it)
+        {
+            return reinterpret_cast<std::uintptr_t>(std::addressof(*it));
+        }
+
+        /**
+         * @brief Returns the number of elements between the start of the cache line of *@it and *@it, or 0 if the elements
+         *        do not pack cache lines exactly.
+         */
+        static size_type line_offset(It it)
+        {
+            if constexpr (!packs_lines()) {
+                return 0;
+            }
+            std::uintptr_t bytes = address_of(it) % cache_line;
+            return (bytes % sizeof(value_type) == 0) ? static_cast<size_type>(bytes / sizeof(value_type)) : 0;
+        }
+
+        /**
+         * @brief Checks whether the elements of [@first, @last] are laid out contiguously, so that moving the split point
+         *        between them by address is meaningful.
+         */
+        static bool contiguous(It first, It last)
+        {
+            return address_of(last) - address_of(first) == static_cast<std::uintptr_t>(last - first) * sizeof(value_type);
+        }
+
+        It m_begin;
+        It m_end;
+        size_type m_grain;
+    };
+
+namespace detail
+{
+    /**
+     * @brief Calls @body(index) for every index in [0, @tasks), each on its own thread except index 0, which runs on the calling thread.
+     *        The first exception thrown by @body is rethrown after all threads have joined.
+     */
+    template <typename Body>
+    void run_parallel(std::size_t tasks, Body body)
+    {
+        if (tasks == 0) {
+            return;
+        }
+        std::exception_ptr error;
+        std::mutex error_mutex;
+        auto run = [&](std::size_t index) {
+            try
+            {
+                body(index);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        };
+        std::vector<std::thread> workers;
+        workers.reserve(tasks - 1);
+        try
+        {
+            for (std::size_t i = 1; i < tasks; ++i) {
+                workers.emplace_back(run, i);
+            }
+        }
+        catch (...)
+        {
+            for (auto& worker : workers) {
+                worker.join();
+            }
+            throw;
+        }
+        run(0);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    /**
+     * @brief Splits [begin, end) in one chunk per thread with splittable_range::split and calls @body(chunk, index) for each chunk in parallel.
+     */
+    template <typename It, typename Body>
+    void for_each_chunk(It begin, It end, std::size_t threads, std::size_t grain, Body body)
+    {
+        std::vector<splittable_range<It>> chunks{ splittable_range<It>(begin, end, grain) };
+        while (chunks.size() < threads) {
+            auto largest = std::max_element(std::begin(chunks), std::end(chunks)
+                , [](const auto& lhs, const auto& rhs) { return lhs.size() < rhs.size(); });
+            if (!largest->is_divisible()) {
+                break;
+            }
+            auto second = largest->split();
+            chunks.insert(largest + 1, second);
+        }
+        run_parallel(chunks.size(), [&](std::size_t index) {
+            body(chunks[index], index);
+        });
+    }
+
+    inline std::size_t default_thread_count()
+    {
+        return std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    /**
+     * @brief A sorted range of one of the maps merged by merge_all, with the index of its map.
+     */
+    template <typename It>
+    struct merge_cursor
+    {
+        It current;
+        It end;
+        std::size_t source;
+    };
+
+    /**
+     * @brief Merges the sorted ranges of @cursors in key order with a binary heap and calls @emit(element, first) for each element,
+     *        where first tells whether its key differs from the key of the previous element. Equivalent keys come by map index.
+     */
+    template <typename Comp, typename It, typename Emit>
+    void merge_ranges(std::vector<merge_cursor<It>> cursors, Emit emit)
+    {
+        Comp comp;
+        auto later = [&comp](const merge_cursor<It>& lhs, const merge_cursor<It>& rhs) {
+            if (comp(rhs.current->first, lhs.current->first)) {
+                return true;
+            }
+            if (comp(lhs.current->first, rhs.current->first)) {
+                return false;
+            }
+            return rhs.source < lhs.source;
+        };
+        cursors.erase(std::remove_if(std::begin(cursors), std::end(cursors)
+            , [](const merge_cursor<It>& cursor) { return cursor.current == cursor.end; }), std::end(cursors));
+        std::make_heap(std::begin(cursors), std::end(cursors), later);
+        It previous{};
+        bool has_previous = false;
+        while (!cursors.empty()) {
+            std::pop_heap(std::begin(cursors), std::end(cursors), later);
+            auto& top = cursors.back();
+            bool first = !has_previous || comp(previous->first, top.current->first);
+            previous = top.current;
+            has_previous = true;
+            emit(*top.current, first);
+            if (++top.current == top.end) {
+                cursors.pop_back();
+            }
+            else {
+                std::push_heap(std::begin(cursors), std::end(cursors), later);
+            }
+        }
+    }
+}
+
+    /**
+     * @brief Calls @fn on every element of [@begin, @end) of a map's contiguous storage, splitting the range in chunks as
+     *        splittable_range does, processed in parallel. @fn must be safe to call concurrently on different elements.
+     *
+     * @param begin range of elements to process.
+     * @param end range of elements to process.
+     * @param fn The function called with a reference to each element.
+     * @param threads The number of threads to use, including the calling one.
+     * @param grain The minimal number of elements of a chunk.
+     */
+    template <typename It, typename F>
+    void parallel_for_each(It begin, It end, F fn
+        , std::size_t threads = detail::default_thread_count(), std::size_t grain = 4096)
+    {
+        detail::for_each_chunk(begin, end, threads, grain, [&fn](const splittable_range<It>& chunk, std::size_t) {
+            std::for_each(chunk.begin(), chunk.end(), fn);
+        });
+    }
+
+    /**
+     * @brief Calls @fn in parallel on every element of @map whose key is in [@lo_key, @hi_key).
+     *
+     * @param map The map whose elements to process.
+     * @param lo_key The smallest key to process.
+     * @param hi_key The key to stop before.
+     * @param fn The function called with a reference to each element.
+     * @param threads The number of threads to use, including the calling one.
+     */
+    template <typename Map, typename Key, typename F>
+    void parallel_for_each(Map& map, const Key& lo_key, const Key& hi_key, F fn
+        , std::size_t threads = detail::default_thread_count())
+    {
+        auto begin = map.lower_bound(lo_key);
+        auto end = std::max(begin, map.lower_bound(hi_key));
+        parallel_for_each(begin, end, fn, threads);
+    }
+
+    /**
+     * @brief Reduces the elements of [@begin, @end) in parallel: every chunk is folded from @identity with @reduce(accumulator, element),
+     *        then the results of the chunks are combined in order with @combine(lhs, rhs).
+     *
+     * @param begin range of elements to reduce.
+     * @param end range of elements to reduce.
+     * @param identity The identity of @combine, and the result for an empty range.
+     * @param reduce The function folding an element into an accumulator.
+     * @param combine The associative function combining two accumulators.
+     * @param threads The number of threads to use, including the calling one.
+     * @param grain The minimal number of elements of a chunk.
+     * @return T The reduction of the range.
+     */
+    template <typename It, typename T, typename Reduce, typename Combine>
+    T parallel_reduce(It begin, It end, T identity, Reduce reduce, Combine combine
+        , std::size_t threads = detail::default_thread_count(), std::size_t grain = 4096)
+    {
+        std::vector<T> partials(std::max<std::size_t>(threads, 1), identity);
+        detail::for_each_chunk(begin, end, threads, grain, [&](const splittable_range<It>& chunk, std::size_t index) {
+            T accumulator = identity;
+            for (auto it = chunk.begin(); it != chunk.end(); ++it) {
+                accumulator = reduce(std::move(accumulator), *it);
+            }
+            partials[index] = std::move(accumulator);
+        });
+        T result = std::move(identity);
+        for (auto& partial : partials) {
+            result = combine(std::move(result), std::move(partial));
+        }
+        return result;
+    }
+
+    /**
+     * @brief Reduces in parallel the elements of @map whose key is in [@lo_key, @hi_key).
+     *
+     * @param map The map whose elements to reduce.
+     * @param lo_key The smallest key to reduce.
+     * @param hi_key The key to stop before.
+     * @param identity The identity of @combine, and the result for an empty range.
+     * @param reduce The function folding an element into an accumulator.
+     * @param combine The associative function combining two accumulators.
+     * @param threads The number of threads to use, including the calling one.
+     * @return T The reduction of the elements.
+     */
+    template <typename Map, typename Key, typename T, typename Reduce, typename Combine>
+    T parallel_reduce(const Map& map, const Key& lo_key, const Key& hi_key, T identity, Reduce reduce, Combine combine
+        , std::size_t threads = detail::default_thread_count())
+    {
+        auto begin = map.lower_bound(lo_key);
+        auto end = std::max(begin, map.lower_bound(hi_key));
+        return parallel_reduce(begin, end, std::move(identity), reduce, combine, threads);
+    }
+
+    /**
+     * @brief Merges @maps into a new map in parallel. Splitter keys sampled evenly from every map cut the key space in one partition
+     *        per thread, so that equivalent keys always fall in the same partition. A first parallel pass counts the distinct keys of
+     *        every partition, which gives each partition its exact offset in the result; a second pass merges the partitions straight
+     *        into the storage of the result through bulk_load, without intermediate buffer. The values of equivalent keys are folded
+     *        into the one of the lowest map index with @combiner(accumulated, value), in map order.
+     *
+     * @param maps A range of flat_maps of the same type.
+     * @param combiner The function folding a value into the value of an equivalent key already in the result.
+     * @param threads The number of threads to use, including the calling one.
+     * @return The map holding every key of @maps.
+     */
+    template <typename Range, typename Combiner>
+    auto merge_all(const Range& maps, Combiner combiner, std::size_t threads = detail::default_thread_count())
+    {
+        using map_type = std::decay_t<decltype(*std::begin(maps))>;
+        using key_type = typename map_type::key_type;
+        using value_type = typename map_type::value_type;
+        using key_compare = typename map_type::key_compare;
+        using cursor = detail::merge_cursor<typename map_type::const_iterator>;
+
+        std::vector<const map_type*> sources;
+        std::size_t total = 0;
+        for (const auto& map : maps) {
+            sources.push_back(&map);
+            total += map.size();
+        }
+
+        key_compare comp;
+        std::size_t partitions = std::clamp<std::size_t>(total / 4096, 1, std::max<std::size_t>(threads, 1));
+        std::vector<key_type> splitters;
+        if (partitions > 1) {
+            std::vector<key_type> samples;
+            for (const map_type* map : sources) {
+                for (std::size_t i = 1; i < partitions && !map->empty(); ++i) {
+                    samples.push_back((map->begin() + map->size() * i / partitions)->first);
+                }
+            }
+            std::sort(std::begin(samples), std::end(samples), comp);
+            for (std::size_t i = 1; i < partitions; ++i) {
+                const key_type& sample = samples[samples.size() * i / partitions];
+                if (splitters.empty() || comp(splitters.back(), sample)) {
+                    splitters.push_back(sample);
+                }
+            }
+        }
+        partitions = splitters.size() + 1;
+
+        std::vector<std::vector<cursor>> ranges(partitions);
+        for (std::size_t source = 0; source < sources.size(); ++source) {
+            auto begin = sources[source]->begin();
+            for (std::size_t partition = 0; partition < partitions; ++partition) {
+                auto end = (partition < splitters.size()) ? sources[source]->lower_bound(splitters[partition]) : sources[source]->end();
+                ranges[partition].push_back({ begin, end, source });
+                begin = end;
+            }
+        }
+
+        std::vector<std::size_t> offsets(partitions + 1, 0);
+        detail::run_parallel(partitions, [&](std::size_t partition) {
+            std::size_t count = 0;
+            detail::merge_ranges<key_compare>(ranges[partition], [&count](const value_type&, bool first) {
+                count += first;
+            });
+            offsets[partition + 1] = count;
+        });
+        std::partial_sum(std::begin(offsets), std::end(offsets), std::begin(offsets));
+
+        // Containers with append_and_overwrite hand bulk_load uninitialized storage, the others value-initialized elements.
+        constexpr bool uninitialized = detail::has_append_and_overwrite<typename map_type::container_type
+            , std::size_t (*)(value_type*, std::size_t)>::value;
+        map_type result;
+        result.bulk_load(offsets.back(), [&](value_type* out, std::size_t) {
+            std::vector<char> written(partitions, 0);
+            try
+            {
+                detail::run_parallel(partitions, [&](std::size_t partition) {
+                    value_type* position = out + offsets[partition];
+                    try
+                    {
+                        detail::merge_ranges<key_compare>(ranges[partition], [&](const value_type& element, bool first) {
+                            if (!first) {
+                                combiner((position - 1)->second, element.second);
+                            }
+                            else if constexpr (uninitialized) {
+                                ::new (static_cast<void*>(position++)) value_type(element);
+                            }
+                            else {
+                                *position++ = element;
+                            }
+                        });
+                    }
+                    catch (...)
+                    {
+                        if constexpr (uninitialized) {
+                            std::destroy(out + offsets[partition], position);
+                        }
+                        throw;
+                    }
+                    written[partition] = 1;
+                });
+            }
+            catch (...)
+            {
+                if constexpr (uninitialized) {
+                    for (std::size_t partition = 0; partition < partitions; ++partition) {
+                        if (written[partition]) {
+                            std::destroy(out + offsets[partition], out + offsets[partition + 1]);
+                        }
+                    }
+                }
+                throw;
+            }
+            return offsets.back();
+        });
+        return result;
+    }
+
+    /**
+     * @brief Merges @maps into a new map in parallel, keeping for equivalent keys the value of the lowest map index.
+     *
+     * @param maps A range of flat_maps of the same type.
+     * @return The map holding every key of @maps.
+     */
+    template <typename Range>
+    auto merge_all(const Range& maps)
+    {
+        return merge_all(maps, [](auto&, const auto&) {});
+    }
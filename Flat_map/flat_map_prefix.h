@@ -0,0 +1,311 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "flat_map.h"
+
+namespace detail
+{
+    /**
+     * @brief Returns the smallest string greater than every string starting with @prefix: @prefix without its trailing 0xFF bytes,
+     *        with its last byte incremented. Returns false if there is no such string, when @prefix has only 0xFF bytes.
+     */
+    inline bool prefix_successor(std::string_view prefix, std::string& successor)
+    {
+        successor.assign(prefix.data(), prefix.size());
+        while (!successor.empty() && (static_cast<unsigned char>(successor.back()) == 0xFF)) {
+            successor.pop_back();
+        }
+        if (successor.empty()) {
+            return false;
+        }
+        successor.back() = static_cast<char>(static_cast<unsigned char>(successor.back()) + 1);
+        return true;
+    }
+
+    /**
+     * @brief The k best elements seen so far, kept in a heap whose top is the worst of them. An element is better than another
+     *        if its score is greater, or if the scores are equivalent and it comes first in the map.
+     */
+    template <typename S, typename It>
+    struct top_k_heap
+    {
+        struct candidate
+        {
+            S score;
+            std::size_t position;
+            It it;
+        };
+
+        explicit top_k_heap(std::size_t k)
+            : m_k(k)
+        {
+            m_candidates.reserve(k);
+        }
+
+        static bool better(const candidate& lhs, const candidate& rhs)
+        {
+            if (rhs.score < lhs.score) {
+                return true;
+            }
+            return !(lhs.score < rhs.score) && (lhs.position < rhs.position);
+        }
+
+        bool full() const
+        {
+            return m_candidates.size() == m_k;
+        }
+
+        const candidate& worst() const
+        {
+            return m_candidates.front();
+        }
+
+        void push(S score, std::size_t position, It it)
+        {
+            candidate next{ std::move(score), position, it };
+            if (!full()) {
+                m_candidates.push_back(std::move(next));
+                std::push_heap(std::begin(m_candidates), std::end(m_candidates), &better);
+            }
+            else if (better(next, worst())) {
+                std::pop_heap(std::begin(m_candidates), std::end(m_candidates), &better);
+                m_candidates.back() = std::move(next);
+                std::push_heap(std::begin(m_candidates), std::end(m_candidates), &better);
+            }
+        }
+
+        std::vector<It> take()
+        {
+            std::sort_heap(std::begin(m_candidates), std::end(m_candidates), &better);
+            std::vector<It> result;
+            result.reserve(m_candidates.size());
+            for (auto& candidate : m_candidates) {
+                result.push_back(candidate.it);
+            }
+            return result;
+        }
+
+    private:
+        std::size_t m_k;
+        std::vector<candidate> m_candidates;
+    };
+}
+
+    /**
+     * @brief Returns the range of the elements of @map whose string key starts with @prefix, as [lower_bound(prefix),
+     *        lower_bound(successor)) where successor is the smallest string greater than all the strings starting with @prefix.
+     *        The keys must be ordered byte-wise, as std::string and std::string_view are with std::less.
+     *
+     * @param map A map with string keys, such as flat_map<std::string, V>, string_flat_map or frozen_string_map.
+     * @param prefix The prefix of the keys to find.
+     * @return The range of the elements whose key starts with @prefix, empty if there is none.
+     */
+    template <typename Map>
+    auto prefix_range(Map& map, std::string_view prefix)
+    {
+        using key_type = typename Map::key_type;
+        auto first = map.lower_bound(key_type(prefix));
+        decltype(first) last = map.end();
+        std::string successor;
+        if (detail::prefix_successor(prefix, successor)) {
+            last = map.lower_bound(key_type(successor));
+        }
+        return std::make_pair(first, last);
+    }
+
+    /**
+     * @brief The maximal score of every block of consecutive elements of a map, which lets top_k_by_prefix skip the blocks whose
+     *        best element cannot enter the result. The index describes the map at the time it was built, and has to be rebuilt
+     *        when the map is modified.
+     *
+     * @tparam Map the type of the indexed map, whose iterators are random access.
+     * @tparam Score the type of the function giving the score of an element, whose results are compared with operator<.
+     */
+    template <typename Map, typename Score>
+    struct prefix_score_index
+    {
+        using map_type = Map;
+        using score_function = Score;
+        using score_type = std::decay_t<decltype(std::declval<const Score&>()(*std::declval<const Map&>().begin()))>;
+        using size_type = std::size_t;
+
+        /**
+         * @brief Constructs the index of @map.
+         *
+         * @param map The map to index.
+         * @param score The function giving the score of an element of @map.
+         * @param block_size The number of elements of a block.
+         */
+        prefix_score_index(const Map& map, Score score, size_type block_size = 64)
+            : m_score(std::move(score))
+            , m_block_size(std::max<size_type>(block_size, 1))
+        {
+            rebuild(map);
+        }
+
+        /**
+         * @brief Recomputes the maximal scores of the blocks of @map.
+         *
+         * @param map The map to index.
+         */
+        void rebuild(const Map& map)
+        {
+            m_size = static_cast<size_type>(std::distance(map.begin(), map.end()));
+            m_block_max.clear();
+            m_block_max.reserve((m_size + m_block_size - 1) / m_block_size);
+            auto it = map.begin();
+            for (size_type begin = 0; begin < m_size; begin += m_block_size) {
+                auto end = std::min(begin + m_block_size, m_size);
+                score_type best = m_score(*it++);
+                for (size_type i = begin + 1; i < end; ++i, ++it) {
+                    score_type next = m_score(*it);
+                    if (best < next) {
+                        best = std::move(next);
+                    }
+                }
+                m_block_max.push_back(std::move(best));
+            }
+        }
+
+        /**
+         * @brief Returns the function giving the score of an element.
+         */
+        [[nodiscard]] const Score& score() const noexcept
+        {
+            return m_score;
+        }
+
+        /**
+         * @brief Returns the number of elements of a block.
+         */
+        [[nodiscard]] size_type block_size() const noexcept
+        {
+            return m_block_size;
+        }
+
+        /**
+         * @brief Returns the number of elements of the map when the index was built.
+         */
+        [[nodiscard]] size_type size() const noexcept
+        {
+            return m_size;
+        }
+
+        /**
+         * @brief Returns the maximal score of every block.
+         */
+        [[nodiscard]] const std::vector<score_type>& block_max() const noexcept
+        {
+            return m_block_max;
+        }
+
+    private:
+        Score m_score;
+        size_type m_block_size;
+        size_type m_size = 0;
+        std::vector<score_type> m_block_max;
+    };
+
+    /**
+     * @brief Returns the @k elements of @map with the greatest scores among the ones whose key starts with @prefix, by scanning
+     *        the prefix range with a heap of the k best elements.
+     *
+     * @param map A map with string keys.
+     * @param prefix The prefix of the keys of the completions.
+     * @param k The maximal number of completions.
+     * @param score The function giving the score of an element, whose results are compared with operator<.
+     * @return Iterators to the best completions, by descending score and then in key order for equivalent scores.
+     */
+    template <typename Map, typename Score>
+    auto top_k_by_prefix(Map& map, std::string_view prefix, std::size_t k, Score score)
+    {
+        auto range = prefix_range(map, prefix);
+        using iterator = decltype(range.first);
+        using score_type = std::decay_t<decltype(score(*range.first))>;
+        detail::top_k_heap<score_type, iterator> best(k);
+        if (k == 0) {
+            return best.take();
+        }
+        std::size_t position = 0;
+        for (auto it = range.first; it != range.second; ++it, ++position) {
+            best.push(score(*it), position, it);
+        }
+        return best.take();
+    }
+
+    /**
+     * @brief Returns the @k elements of @map with the greatest scores among the ones whose key starts with @prefix. The blocks
+     *        entirely in the prefix range are visited by decreasing maximal score from @index, and the search stops at the
+     *        first block whose maximal score cannot beat the k-th best element found, so large prefix ranges are not scanned.
+     *
+     * @param map A map with string keys and random access iterators, unmodified since @index was built.
+     * @param prefix The prefix of the keys of the completions.
+     * @param k The maximal number of completions.
+     * @param index The block index of @map, which also gives the scores.
+     * @return Iterators to the best completions, by descending score and then in key order for equivalent scores.
+     */
+    template <typename Map, typename IndexedMap, typename Score>
+    auto top_k_by_prefix(Map& map, std::string_view prefix, std::size_t k, const prefix_score_index<IndexedMap, Score>& index)
+    {
+        auto range = prefix_range(map, prefix);
+        using iterator = decltype(range.first);
+        using score_type = typename prefix_score_index<IndexedMap, Score>::score_type;
+        detail::top_k_heap<score_type, iterator> best(k);
+        if (k == 0) {
+            return best.take();
+        }
+        iterator begin = map.begin();
+        std::size_t first = static_cast<std::size_t>(range.first - begin);
+        std::size_t last = static_cast<std::size_t>(range.second - begin);
+        std::size_t block_size = index.block_size();
+        auto scan = [&](std::size_t from, std::size_t to) {
+            for (std::size_t i = from; i < to; ++i) {
+                best.push(index.score()(begin[i]), i, begin + i);
+            }
+        };
+        std::size_t first_block = (first + block_size - 1) / block_size;
+        std::size_t last_block = last / block_size;
+        if (first_block >= last_block) {
+            scan(first, last);
+            return best.take();
+        }
+        scan(first, first_block * block_size);
+        scan(last_block * block_size, last);
+
+        const auto& block_max = index.block_max();
+        auto lower = [&block_max](std::size_t lhs, std::size_t rhs) {
+            if (block_max[lhs] < block_max[rhs]) {
+                return true;
+            }
+            return !(block_max[rhs] < block_max[lhs]) && (rhs < lhs);
+        };
+        std::vector<std::size_t> blocks(last_block - first_block);
+        for (std::size_t i = 0; i < blocks.size(); ++i) {
+            blocks[i] = first_block + i;
+        }
+        std::make_heap(std::begin(blocks), std::end(blocks), lower);
+        while (!blocks.empty()) {
+            std::size_t block = blocks.front();
+            if (best.full()) {
+                const auto& worst = best.worst();
+                if (block_max[block] < worst.score) {
+                    break;
+                }
+                if (!(worst.score < block_max[block]) && (worst.position < block * block_size)) {
+                    break;
+                }
+            }
+            std::pop_heap(std::begin(blocks), std::end(blocks), lower);
+            blocks.pop_back();
+            scan(block * block_size, (block + 1) * block_size);
+        }
+        return best.take();
+    }
@@ -0,0 +1,647 @@
+#pragma once
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "flat_map.h"
+
+namespace detail
+{
+    /**
+     * @brief Whether a column of type T is scanned 4 values at a time with AVX2: 64-bit integers and doubles.
+     */
+    template <typename T>
+    inline constexpr bool is_wide_scan_type = (std::is_integral_v<T> && (sizeof(T) == 8)) || std::is_same_v<T, double>;
+
+#if defined(__AVX2__)
+    template <typename T>
+    __m256i wide_broadcast(T value)
+    {
+        if constexpr (std::is_same_v<T, double>) {
+            return _mm256_castpd_si256(_mm256_set1_pd(value));
+        }
+        else {
+            return _mm256_set1_epi64x(static_cast<long long>(value));
+        }
+    }
+
+    /**
+     * @brief Compares 4 values of type T: the lanes where @lhs is greater than @rhs are all ones, like bound < value in the
+     *        scalar loops, so no lane of a NaN is set. Unsigned values are compared as signed ones with their sign bit flipped.
+     */
+    template <typename T>
+    __m256i wide_greater(__m256i lhs, __m256i rhs)
+    {
+        if constexpr (std::is_same_v<T, double>) {
+            return _mm256_castpd_si256(_mm256_cmp_pd(_mm256_castsi256_pd(lhs), _mm256_castsi256_pd(rhs), _CMP_GT_OQ));
+        }
+        else if constexpr (std::is_signed_v<T>) {
+            return _mm256_cmpgt_epi64(lhs, rhs);
+        }
+        else {
+            __m256i sign = _mm256_set1_epi64x(std::numeric_limits<long long>::min());
+            return _mm256_cmpgt_epi64(_mm256_xor_si256(lhs, sign), _mm256_xor_si256(rhs, sign));
+        }
+    }
+
+    template <typename T>
+    __m256i wide_equal(__m256i lhs, __m256i rhs)
+    {
+        if constexpr (std::is_same_v<T, double>) {
+            return _mm256_castpd_si256(_mm256_cmp_pd(_mm256_castsi256_pd(lhs), _mm256_castsi256_pd(rhs), _CMP_EQ_OQ));
+        }
+        else {
+            return _mm256_cmpeq_epi64(lhs, rhs);
+        }
+    }
+#endif
+}
+
+    /**
+     * @brief Selects the keys of the scanned elements.
+     */
+    struct key_column
+    {
+        template <typename Pair>
+        static const auto& get(const Pair& element)
+        {
+            return element.first;
+        }
+    };
+
+    /**
+     * @brief Selects the values of the scanned elements.
+     */
+    struct value_column
+    {
+        template <typename Pair>
+        static const auto& get(const Pair& element)
+        {
+            return element.second;
+        }
+    };
+
+    /**
+     * @brief Scan predicate matching the column values greater than bound.
+     */
+    template <typename T>
+    struct greater_than
+    {
+        T bound;
+
+        bool operator() (const T& value) const
+        {
+            return bound < value;
+        }
+
+#if defined(__AVX2__)
+        __m256i mask(__m256i values) const
+        {
+            if constexpr (detail::is_wide_scan_type<T>) {
+                return detail::wide_greater<T>(values, detail::wide_broadcast(bound));
+            }
+            else {
+                return _mm256_cmpgt_epi32(values, _mm256_set1_epi32(bound));
+            }
+        }
+#endif
+    };
+
+    /**
+     * @brief Scan predicate matching the column values less than bound.
+     */
+    template <typename T>
+    struct less_than
+    {
+        T bound;
+
+        bool operator() (const T& value) const
+        {
+            return value < bound;
+        }
+
+#if defined(__AVX2__)
+        __m256i mask(__m256i values) const
+        {
+            if constexpr (detail::is_wide_scan_type<T>) {
+                return detail::wide_greater<T>(detail::wide_broadcast(bound), values);
+            }
+            else {
+                return _mm256_cmpgt_epi32(_mm256_set1_epi32(bound), values);
+            }
+        }
+#endif
+    };
+
+    /**
+     * @brief Scan predicate matching the column values in [lo, hi).
+     */
+    template <typename T>
+    struct between
+    {
+        T lo;
+        T hi;
+
+        bool operator() (const T& value) const
+        {
+            return !(value < lo) && (value < hi);
+        }
+
+#if defined(__AVX2__)
+        __m256i mask(__m256i values) const
+        {
+            if constexpr (detail::is_wide_scan_type<T>) {
+                return _mm256_andnot_si256(detail::wide_greater<T>(detail::wide_broadcast(lo), values)
+                    , detail::wide_greater<T>(detail::wide_broadcast(hi), values));
+            }
+            else {
+                return _mm256_andnot_si256(_mm256_cmpgt_epi32(_mm256_set1_epi32(lo), values)
+                    , _mm256_cmpgt_epi32(_mm256_set1_epi32(hi), values));
+            }
+        }
+#endif
+    };
+
+    /**
+     * @brief Scan predicate matching the column values equal to value.
+     */
+    template <typename T>
+    struct equals
+    {
+        T value;
+
+        bool operator() (const T& other) const
+        {
+            return other == value;
+        }
+
+#if defined(__AVX2__)
+        __m256i mask(__m256i values) const
+        {
+            if constexpr (detail::is_wide_scan_type<T>) {
+                return detail::wide_equal<T>(values, detail::wide_broadcast(value));
+            }
+            else {
+                return _mm256_cmpeq_epi32(values, _mm256_set1_epi32(value));
+            }
+        }
+#endif
+    };
+
+    /**
+     * @brief Customization point telling whether It points into contiguous storage. True for pointers and std::vector iterators.
+     */
+    template <typename It>
+    struct is_contiguous_iterator : std::bool_constant<std::is_pointer_v<It>
+        || std::is_same_v<It, typename std::vector<typename std::iterator_traits<It>::value_type>::iterator>
+        || std::is_same_v<It, typename std::vector<typename std::iterator_traits<It>::value_type>::const_iterator>>
+    {
+    };
+
+namespace detail
+{
+    template <typename T>
+    using scan_sum_type = std::conditional_t<std::is_floating_point_v<T>, double
+        , std::conditional_t<std::is_signed_v<T>, std::int64_t, std::uint64_t>>;
+
+    template <typename Column, typename It>
+    using scan_column_type = std::decay_t<decltype(Column::get(*std::declval<It>()))>;
+
+    template <typename Pred>
+    struct is_int32_scan_predicate : std::false_type
+    {
+    };
+
+    template <>
+    struct is_int32_scan_predicate<greater_than<std::int32_t>> : std::true_type
+    {
+    };
+
+    template <>
+    struct is_int32_scan_predicate<less_than<std::int32_t>> : std::true_type
+    {
+    };
+
+    template <>
+    struct is_int32_scan_predicate<between<std::int32_t>> : std::true_type
+    {
+    };
+
+    template <>
+    struct is_int32_scan_predicate<equals<std::int32_t>> : std::true_type
+    {
+    };
+
+    /**
+     * @brief Whether [first, last) can be scanned 8 elements at a time: contiguous pairs of 32-bit signed integers.
+     */
+    template <typename It>
+    inline constexpr bool is_int32_pair_range = is_contiguous_iterator<It>::value
+        && std::is_same_v<std::remove_cv_t<typename std::iterator_traits<It>::value_type>, std::pair<std::int32_t, std::int32_t>>;
+
+    template <typename Pair>
+    struct is_wide_pair : std::false_type
+    {
+    };
+
+    template <typename First, typename Second>
+    struct is_wide_pair<std::pair<First, Second>>
+        : std::bool_constant<is_wide_scan_type<First> && is_wide_scan_type<Second> && (sizeof(std::pair<First, Second>) == 16)>
+    {
+    };
+
+    /**
+     * @brief Whether [first, last) can be scanned 4 elements at a time: contiguous pairs of 64-bit integers or doubles.
+     */
+    template <typename It>
+    inline constexpr bool is_wide_pair_range = is_contiguous_iterator<It>::value
+        && is_wide_pair<std::remove_cv_t<typename std::iterator_traits<It>::value_type>>::value;
+
+    /**
+     * @brief Whether Pred has a mask for the 64-bit column type T: one of the scan predicates instantiated with T itself.
+     */
+    template <typename Pred, typename T>
+    struct is_wide_scan_predicate : std::false_type
+    {
+    };
+
+    template <typename T>
+    struct is_wide_scan_predicate<greater_than<T>, T> : std::bool_constant<is_wide_scan_type<T>>
+    {
+    };
+
+    template <typename T>
+    struct is_wide_scan_predicate<less_than<T>, T> : std::bool_constant<is_wide_scan_type<T>>
+    {
+    };
+
+    template <typename T>
+    struct is_wide_scan_predicate<between<T>, T> : std::bool_constant<is_wide_scan_type<T>>
+    {
+    };
+
+    template <typename T>
+    struct is_wide_scan_predicate<equals<T>, T> : std::bool_constant<is_wide_scan_type<T>>
+    {
+    };
+
+    inline std::size_t lowest_bit(std::uint64_t bits) noexcept
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, bits);
+        return index;
+#else
+        return static_cast<std::size_t>(__builtin_ctzll(bits));
+#endif
+    }
+
+    template <typename It>
+    auto pair_data(It first)
+    {
+        return std::addressof(*first);
+    }
+
+#if defined(__AVX2__)
+    inline constexpr bool has_avx2 = true;
+
+    /**
+     * @brief Loads the column of 8 consecutive pairs of 32-bit integers, in order.
+     */
+    template <typename Column>
+    __m256i load_int32_column(const std::pair<std::int32_t, std::int32_t>* pairs)
+    {
+        __m256 low = _mm256_castsi256_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pairs)));
+        __m256 high = _mm256_castsi256_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pairs + 4)));
+        __m256 column = std::is_same_v<Column, key_column>
+            ? _mm256_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0))
+            : _mm256_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1));
+        return _mm256_permute4x64_epi64(_mm256_castps_si256(column), _MM_SHUFFLE(3, 1, 2, 0));
+    }
+
+    inline unsigned mask_bits(__m256i mask)
+    {
+        return static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(mask)));
+    }
+
+    /**
+     * @brief Loads the column of 4 consecutive pairs of 64-bit values, in order.
+     */
+    template <typename Column, typename Pair>
+    __m256i load_wide_column(const Pair* pairs)
+    {
+        __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pairs));
+        __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pairs + 2));
+        __m256i column = std::is_same_v<Column, key_column> ? _mm256_unpacklo_epi64(low, high) : _mm256_unpackhi_epi64(low, high);
+        return _mm256_permute4x64_epi64(column, _MM_SHUFFLE(3, 1, 2, 0));
+    }
+
+    inline unsigned wide_mask_bits(__m256i mask)
+    {
+        return static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(mask)));
+    }
+
+    template <typename T>
+    __m256i wide_add(__m256i lhs, __m256i rhs)
+    {
+        if constexpr (std::is_same_v<T, double>) {
+            return _mm256_castpd_si256(_mm256_add_pd(_mm256_castsi256_pd(lhs), _mm256_castsi256_pd(rhs)));
+        }
+        else {
+            return _mm256_add_epi64(lhs, rhs);
+        }
+    }
+
+    /**
+     * @brief Returns the lane-wise minimum of @values and @minimums, keeping the lane of @minimums when a value is not less
+     *        than it, as the scalar loop of scan_min does (for NaNs too).
+     */
+    template <typename T>
+    __m256i wide_min(__m256i values, __m256i minimums)
+    {
+        if constexpr (std::is_same_v<T, double>) {
+            return _mm256_castpd_si256(_mm256_min_pd(_mm256_castsi256_pd(values), _mm256_castsi256_pd(minimums)));
+        }
+        else {
+            return _mm256_blendv_epi8(minimums, values, wide_greater<T>(minimums, values));
+        }
+    }
+
+    /**
+     * @brief Returns the lane-wise maximum of @values and @maximums, keeping the lane of @maximums when a value is not greater
+     *        than it, as the scalar loop of scan_max does (for NaNs too).
+     */
+    template <typename T>
+    __m256i wide_max(__m256i values, __m256i maximums)
+    {
+        if constexpr (std::is_same_v<T, double>) {
+            return _mm256_castpd_si256(_mm256_max_pd(_mm256_castsi256_pd(values), _mm256_castsi256_pd(maximums)));
+        }
+        else {
+            return _mm256_blendv_epi8(maximums, values, wide_greater<T>(values, maximums));
+        }
+    }
+#else
+    inline constexpr bool has_avx2 = false;
+#endif
+}
+
+    /**
+     * @brief Counts the elements of [@first, @last) whose column matches @pred. Use lower_bound and upper_bound of the map
+     *        to scan a key range. When @pred is one of greater_than, less_than, between or equals of the column type, AVX2
+     *        scans contiguous pairs of int32_t 8 at a time and contiguous pairs of 64-bit integers or doubles 4 at a time.
+     *
+     * @tparam Column key_column or value_column.
+     * @param first range of elements to scan.
+     * @param last range of elements to scan.
+     * @param pred The predicate on the column.
+     * @return std::size_t The number of matching elements.
+     */
+    template <typename Column = value_column, typename It, typename Pred>
+    std::size_t scan_count_if(It first, It last, Pred pred)
+    {
+        std::size_t result = 0;
+        if constexpr (detail::has_avx2 && detail::is_int32_pair_range<It> && detail::is_int32_scan_predicate<Pred>::value) {
+#if defined(__AVX2__)
+            for (; last - first >= 8; first += 8) {
+                __m256i mask = pred.mask(detail::load_int32_column<Column>(detail::pair_data(first)));
+                result += std::bitset<8>(detail::mask_bits(mask)).count();
+            }
+#endif
+        }
+        else if constexpr (detail::has_avx2 && detail::is_wide_pair_range<It>
+            && detail::is_wide_scan_predicate<Pred, detail::scan_column_type<Column, It>>::value) {
+#if defined(__AVX2__)
+            for (; last - first >= 4; first += 4) {
+                __m256i mask = pred.mask(detail::load_wide_column<Column>(detail::pair_data(first)));
+                result += std::bitset<4>(detail::wide_mask_bits(mask)).count();
+            }
+#endif
+        }
+        for (; first != last; ++first) {
+            result += pred(Column::get(*first)) ? 1 : 0;
+        }
+        return result;
+    }
+
+    /**
+     * @brief Sums the column of the elements of [@first, @last) in a 64-bit integer, or a double for floating point columns.
+     *        The AVX2 path of double columns adds the values in 4 interleaved partial sums, so its result may differ from
+     *        the sequential sum in the last bits.
+     *
+     * @tparam Column key_column or value_column.
+     * @param first range of elements to scan.
+     * @param last range of elements to scan.
+     * @return The sum of the column.
+     */
+    template <typename Column = value_column, typename It>
+    auto scan_sum(It first, It last)
+    {
+        using sum_type = detail::scan_sum_type<detail::scan_column_type<Column, It>>;
+        sum_type result = 0;
+        if constexpr (detail::has_avx2 && detail::is_int32_pair_range<It>) {
+#if defined(__AVX2__)
+            __m256i sums = _mm256_setzero_si256();
+            for (; last - first >= 8; first += 8) {
+                __m256i column = detail::load_int32_column<Column>(detail::pair_data(first));
+                sums = _mm256_add_epi64(sums, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(column)));
+                sums = _mm256_add_epi64(sums, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(column, 1)));
+            }
+            alignas(32) std::int64_t lanes[4];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), sums);
+            result = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+        }
+        else if constexpr (detail::has_avx2 && detail::is_wide_pair_range<It>) {
+#if defined(__AVX2__)
+            using column_type = detail::scan_column_type<Column, It>;
+            __m256i sums = _mm256_setzero_si256();
+            for (; last - first >= 4; first += 4) {
+                sums = detail::wide_add<column_type>(sums, detail::load_wide_column<Column>(detail::pair_data(first)));
+            }
+            using lane_type = std::conditional_t<std::is_same_v<column_type, double>, double, std::uint64_t>;
+            alignas(32) lane_type lanes[4];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), sums);
+            result = static_cast<sum_type>((lanes[0] + lanes[1]) + (lanes[2] + lanes[3]));
+#endif
+        }
+        for (; first != last; ++first) {
+            result += Column::get(*first);
+        }
+        return result;
+    }
+
+    /**
+     * @brief Returns the smallest column value of the elements of [@first, @last), or the largest value of the column type if the range is empty.
+     *
+     * @tparam Column key_column or value_column.
+     * @param first range of elements to scan.
+     * @param last range of elements to scan.
+     * @return The minimum of the column.
+     */
+    template <typename Column = value_column, typename It>
+    auto scan_min(It first, It last)
+    {
+        using column_type = detail::scan_column_type<Column, It>;
+        column_type result = std::numeric_limits<column_type>::max();
+        if constexpr (detail::has_avx2 && detail::is_int32_pair_range<It>) {
+#if defined(__AVX2__)
+            __m256i minimums = _mm256_set1_epi32(result);
+            for (; last - first >= 8; first += 8) {
+                minimums = _mm256_min_epi32(minimums, detail::load_int32_column<Column>(detail::pair_data(first)));
+            }
+            alignas(32) std::int32_t lanes[8];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), minimums);
+            for (std::int32_t lane : lanes) {
+                result = (lane < result) ? lane : result;
+            }
+#endif
+        }
+        else if constexpr (detail::has_avx2 && detail::is_wide_pair_range<It>) {
+#if defined(__AVX2__)
+            __m256i minimums = detail::wide_broadcast(result);
+            for (; last - first >= 4; first += 4) {
+                minimums = detail::wide_min<column_type>(detail::load_wide_column<Column>(detail::pair_data(first)), minimums);
+            }
+            alignas(32) column_type lanes[4];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), minimums);
+            for (column_type lane : lanes) {
+                result = (lane < result) ? lane : result;
+            }
+#endif
+        }
+        for (; first != last; ++first) {
+            const auto& value = Column::get(*first);
+            result = (value < result) ? value : result;
+        }
+        return result;
+    }
+
+    /**
+     * @brief Returns the largest column value of the elements of [@first, @last), or the lowest value of the column type if the range is empty.
+     *
+     * @tparam Column key_column or value_column.
+     * @param first range of elements to scan.
+     * @param last range of elements to scan.
+     * @return The maximum of the column.
+     */
+    template <typename Column = value_column, typename It>
+    auto scan_max(It first, It last)
+    {
+        using column_type = detail::scan_column_type<Column, It>;
+        column_type result = std::numeric_limits<column_type>::lowest();
+        if constexpr (detail::has_avx2 && detail::is_int32_pair_range<It>) {
+#if defined(__AVX2__)
+            __m256i maximums = _mm256_set1_epi32(result);
+            for (; last - first >= 8; first += 8) {
+                maximums = _mm256_max_epi32(maximums, detail::load_int32_column<Column>(detail::pair_data(first)));
+            }
+            alignas(32) std::int32_t lanes[8];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), maximums);
+            for (std::int32_t lane : lanes) {
+                result = (result < lane) ? lane : result;
+            }
+#endif
+        }
+        else if constexpr (detail::has_avx2 && detail::is_wide_pair_range<It>) {
+#if defined(__AVX2__)
+            __m256i maximums = detail::wide_broadcast(result);
+            for (; last - first >= 4; first += 4) {
+                maximums = detail::wide_max<column_type>(detail::load_wide_column<Column>(detail::pair_data(first)), maximums);
+            }
+            alignas(32) column_type lanes[4];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), maximums);
+            for (column_type lane : lanes) {
+                result = (result < lane) ? lane : result;
+            }
+#endif
+        }
+        for (; first != last; ++first) {
+            const auto& value = Column::get(*first);
+            result = (result < value) ? value : result;
+        }
+        return result;
+    }
+
+    /**
+     * @brief Sets bit i of @bitmap for every element i of [@first, @last) whose column matches @pred and clears the others.
+     *        @bitmap is resized to hold one bit per element.
+     *
+     * @tparam Column key_column or value_column.
+     * @param first range of elements to scan.
+     * @param last range of elements to scan.
+     * @param pred The predicate on the column.
+     * @param bitmap The bitmap of the matching elements.
+     * @return std::size_t The number of matching elements.
+     */
+    template <typename Column = value_column, typename It, typename Pred>
+    std::size_t scan_filter_to_bitmap(It first, It last, Pred pred, std::vector<std::uint64_t>& bitmap)
+    {
+        std::size_t size = static_cast<std::size_t>(std::distance(first, last));
+        bitmap.assign((size + 63) / 64, 0);
+        std::size_t result = 0;
+        std::size_t index = 0;
+        if constexpr (detail::has_avx2 && detail::is_int32_pair_range<It> && detail::is_int32_scan_predicate<Pred>::value) {
+#if defined(__AVX2__)
+            for (; size - index >= 8; index += 8, first += 8) {
+                unsigned bits = detail::mask_bits(pred.mask(detail::load_int32_column<Column>(detail::pair_data(first))));
+                bitmap[index / 64] |= static_cast<std::uint64_t>(bits) << (index % 64);
+                result += std::bitset<8>(bits).count();
+            }
+#endif
+        }
+        else if constexpr (detail::has_avx2 && detail::is_wide_pair_range<It>
+            && detail::is_wide_scan_predicate<Pred, detail::scan_column_type<Column, It>>::value) {
+#if defined(__AVX2__)
+            for (; size - index >= 4; index += 4, first += 4) {
+                unsigned bits = detail::wide_mask_bits(pred.mask(detail::load_wide_column<Column>(detail::pair_data(first))));
+                bitmap[index / 64] |= static_cast<std::uint64_t>(bits) << (index % 64);
+                result += std::bitset<4>(bits).count();
+            }
+#endif
+        }
+        for (; first != last; ++first, ++index) {
+            if (pred(Column::get(*first))) {
+                bitmap[index / 64] |= std::uint64_t(1) << (index % 64);
+                ++result;
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @brief Sums the column of the elements i of [@first, @last) whose bit i is set in @bitmap, as produced by scan_filter_to_bitmap.
+     *
+     * @tparam Column key_column or value_column.
+     * @param first range of elements to scan.
+     * @param last range of elements to scan.
+     * @param bitmap The bitmap of the elements to sum.
+     * @return The sum of the selected column values.
+     */
+    template <typename Column = value_column, typename It>
+    auto scan_sum_masked(It first, It last, const std::vector<std::uint64_t>& bitmap)
+    {
+        using sum_type = detail::scan_sum_type<detail::scan_column_type<Column, It>>;
+        sum_type result = 0;
+        std::size_t size = static_cast<std::size_t>(std::distance(first, last));
+        for (std::size_t word = 0; word * 64 < size; ++word) {
+            for (std::uint64_t bits = bitmap[word]; bits != 0; bits &= bits - 1) {
+                result += Column::get(first[word * 64 + detail::lowest_bit(bits)]);
+            }
+        }
+        return result;
+    }
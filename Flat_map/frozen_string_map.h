@@ -0,0 +1,494 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "flat_map.h"
+
+namespace detail
+{
+    template <typename Bytes>
+    void append_varint(Bytes& bytes, std::size_t value)
+    {
+        while (value >= 0x80) {
+            bytes.push_back(static_cast<char>((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        bytes.push_back(static_cast<char>(value));
+    }
+
+    inline std::size_t read_varint(const char* bytes, std::size_t& pos) noexcept
+    {
+        std::size_t value = 0;
+        for (unsigned shift = 0;; shift += 7) {
+            auto byte = static_cast<unsigned char>(bytes[pos++]);
+            value |= static_cast<std::size_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+    }
+}
+
+    /**
+     * @brief A read-only map from strings to V whose keys are front-coded in blocks of BlockSize keys.
+     *        The first key of every block is stored in full, each following key stores only the length of the prefix it shares
+     *        with the previous key and the remaining suffix. Lookups binary search the first keys of the blocks and then decode
+     *        and scan a single block, so keys with long common prefixes (URLs, paths) take a fraction of the memory of
+     *        a flat_map<std::string, V> and stay cache resident.
+     *        The map is built once from a range of (string, value) pairs and cannot be modified afterwards, except for the values.
+     *
+     * @tparam V is the value_type of the map.
+     * @tparam BlockSize the number of keys in a block.
+     * @tparam std::allocator<V> the allocator to allocate the values.
+     */
+    template <typename V, std::size_t BlockSize = 16, typename Allocator = std::allocator<V>>
+    struct frozen_string_map
+    {
+        static_assert(BlockSize > 0, "BlockSize must be positive");
+
+        using key_type = std::string_view;
+        using mapped_type = V;
+        using allocator_type = Allocator;
+        using values_type = std::vector<V, Allocator>;
+        using bytes_type = std::vector<char, typename std::allocator_traits<Allocator>::template rebind_alloc<char>>;
+        using size_type = typename values_type::size_type;
+        using difference_type = typename values_type::difference_type;
+
+        /**
+         * @brief A forward iterator which decodes the keys one by one. The key of the dereferenced pair points into the iterator
+         *        and is valid until the iterator is advanced or destroyed. The iterators returned by the lookups decode their
+         *        key when they are first dereferenced, so comparing them with end() neither decodes nor allocates.
+         */
+        struct const_iterator
+        {
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::pair<std::string_view, const V&>;
+            using difference_type = typename frozen_string_map::difference_type;
+            using reference = value_type;
+
+            struct pointer
+            {
+                value_type value;
+
+                const value_type* operator-> () const
+                {
+                    return &value;
+                }
+            };
+
+            const_iterator() = default;
+
+            [[nodiscard]] reference operator* () const
+            {
+                if (!m_decoded) {
+                    decode_block();
+                }
+                return { m_key, m_owner->m_values[m_index] };
+            }
+
+            [[nodiscard]] pointer operator-> () const
+            {
+                return { **this };
+            }
+
+            const_iterator& operator++ ()
+            {
+                ++m_index;
+                if (m_decoded) {
+                    decode();
+                }
+                return *this;
+            }
+
+            const_iterator operator++ (int)
+            {
+                const_iterator result = *this;
+                ++*this;
+                return result;
+            }
+
+            bool operator== (const const_iterator& other) const
+            {
+                return m_index == other.m_index;
+            }
+
+            bool operator!= (const const_iterator& other) const
+            {
+                return m_index != other.m_index;
+            }
+
+        private:
+            friend struct frozen_string_map;
+
+            const frozen_string_map* m_owner = nullptr;
+            size_type m_index = 0;
+            mutable std::size_t m_pos = 0;
+            mutable std::string m_key;
+            mutable bool m_decoded = false;
+
+            const_iterator(const frozen_string_map* owner, size_type index)
+                : m_owner(owner)
+                , m_index(std::min(index, owner->m_values.size()))
+            {
+            }
+
+            /**
+             * @brief Decodes the keys of the block of the element from its first key up to the key of the element.
+             */
+            void decode_block() const
+            {
+                size_type first = m_index - m_index % BlockSize;
+                m_pos = m_owner->m_blocks[first / BlockSize];
+                m_key.clear();
+                for (size_type index = first; index <= m_index; ++index) {
+                    decode_at(index);
+                }
+                m_decoded = true;
+            }
+
+            void decode()
+            {
+                if (m_index < m_owner->m_values.size()) {
+                    decode_at(m_index);
+                }
+            }
+
+            void decode_at(size_type index) const
+            {
+                const char* bytes = m_owner->m_bytes.data();
+                std::size_t shared = (index % BlockSize == 0) ? 0 : detail::read_varint(bytes, m_pos);
+                std::size_t suffix = detail::read_varint(bytes, m_pos);
+                m_key.resize(shared);
+                m_key.append(bytes + m_pos, suffix);
+                m_pos += suffix;
+            }
+        };
+
+        using iterator = const_iterator;
+
+        frozen_string_map() = default;
+        ~frozen_string_map() = default;
+        frozen_string_map(frozen_string_map&&) = default;
+        frozen_string_map(const frozen_string_map&) = default;
+        frozen_string_map& operator=(frozen_string_map&&) = default;
+        frozen_string_map& operator=(const frozen_string_map&) = default;
+
+        /**
+         * @brief Builds the map from the range [begin ,end ). If multiple elements in the range have keys that compare equivalent,
+         *        only the first one is inserted.
+         *
+         * @param begin range of (string, value) pairs to insert.
+         * @param end range of (string, value) pairs to insert.
+         */
+        template <typename It>
+        frozen_string_map(It begin, It end)
+        {
+            std::vector<std::pair<std::string, V>> sorted;
+            for (; begin != end; ++begin) {
+                sorted.emplace_back(std::string(std::string_view(begin->first)), begin->second);
+            }
+            std::stable_sort(std::begin(sorted), std::end(sorted)
+                , [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+            sorted.erase(std::unique(std::begin(sorted), std::end(sorted)
+                , [](const auto& lhs, const auto& rhs) { return lhs.first == rhs.first; }), std::end(sorted));
+            build(std::make_move_iterator(std::begin(sorted)), std::make_move_iterator(std::end(sorted)));
+        }
+
+        /**
+         * @brief Builds the map from the range [begin ,end ), which must be sorted by key and contain no duplicate keys.
+         *
+         * @param begin range of (string, value) pairs to insert.
+         * @param end range of (string, value) pairs to insert.
+         */
+        template <typename It>
+        frozen_string_map(sorted_unique_t, It begin, It end)
+        {
+            build(begin, end);
+        }
+
+        /**
+         * @brief Builds the map from the elements of the initializer_list @init.
+         *
+         * @param init An initializer_list.
+         */
+        frozen_string_map(std::initializer_list<std::pair<std::string_view, V>> init)
+            : frozen_string_map(std::begin(init), std::end(init))
+        {
+        }
+
+        /**
+         * @brief Returns a const_iterator to the first element contained in the container.
+         *
+         * @return const_iterator to the first element.
+         */
+        [[nodiscard]] const_iterator begin() const
+        {
+            return { this, 0 };
+        }
+
+        /**
+         * @brief Returns a const_iterator to the end of the container.
+         *
+         * @return const_iterator to the end of the container.
+         */
+        [[nodiscard]] const_iterator end() const
+        {
+            const_iterator result;
+            result.m_owner = this;
+            result.m_index = m_values.size();
+            return result;
+        }
+
+        /**
+         * @brief Checks the empyiness of the container
+         *
+         * @return true if the container contains no elemets, false otherwise.
+         */
+        [[nodiscard]] bool empty() const noexcept
+        {
+            return m_values.empty();
+        }
+
+        /**
+         * @brief  Returns the number of the elements contained in the container.
+         *
+         * @return The number of the elements of container.
+         */
+        [[nodiscard]] size_type size() const noexcept
+        {
+            return m_values.size();
+        }
+
+        /**
+         * @brief Returns the number of bytes taken by the encoded keys and the block table.
+         *
+         * @return size_type The memory used for the keys.
+         */
+        [[nodiscard]] size_type key_bytes() const noexcept
+        {
+            return m_bytes.size() + m_blocks.size() * sizeof(std::size_t);
+        }
+
+        /**
+         * @brief Returns a reference to the value whose key is equal to @key.
+         *        Throws an exception object of type out_of_range if no such element is present.
+         *
+         * @param key The key of the element to find.
+         * @return const mapped_type& A const reference to the value whose key is equal to @key.
+         */
+        const mapped_type& at(std::string_view key) const
+        {
+            const mapped_type* found = get(key);
+            if (found == nullptr) {
+                detail::throw_out_of_range("key passed to 'at' doesn't exist in this map");
+            }
+            return *found;
+        }
+
+        /**
+         * @brief Returns a reference to the value whose key is equal to @key.
+         *        Throws an exception object of type out_of_range if no such element is present.
+         *
+         * @param key The key of the element to find.
+         * @return mapped_type& A reference to the value whose key is equal to @key.
+         */
+        mapped_type& at(std::string_view key)
+        {
+            return const_cast<mapped_type&>(std::as_const(*this).at(key));
+        }
+
+        /**
+         * @brief Returns a pointer to the value whose key is equal to @key. The keys are compared in place, so the lookup
+         *        does not allocate.
+         *
+         * @param key Key value of the element to search for.
+         * @return const mapped_type* A pointer to the value, or nullptr if such an element is not found.
+         */
+        [[nodiscard]] const mapped_type* get(std::string_view key) const
+        {
+            bool equal;
+            size_type index = search(key, equal);
+            return equal ? &m_values[index] : nullptr;
+        }
+
+        /**
+         * @brief Attempts to find an element with key equal to @key.
+         *
+         * @param key Key value of the element to search for.
+         * @return const_iterator A const_iterator pointing to an element with the key equal to @key, or end() if such an element is not found.
+         */
+        [[nodiscard]] const_iterator find(std::string_view key) const
+        {
+            bool equal;
+            size_type index = search(key, equal);
+            return equal ? const_iterator(this, index) : end();
+        }
+
+        /**
+         * @brief Checks if there is an element with key equal to @key in the container.
+         *
+         * @param key Key value of the element to search for.
+         * @return true if there is such an element, false otherwise.
+         */
+        [[nodiscard]] bool contains(std::string_view key) const
+        {
+            return get(key) != nullptr;
+        }
+
+        /**
+         * @brief Returns the number of elements with key equal to @key.
+         *
+         * @param key Key value of the element to count.
+         * @return 1 if the element is found, 0 otherwise.
+         */
+        [[nodiscard]] size_type count(std::string_view key) const
+        {
+            return contains(key) ? 1 : 0;
+        }
+
+        /**
+         * @brief Finds the first element with key not less than @key, or end() if such an element is not found.
+         *        Binary searches the first keys of the blocks and scans at most one block.
+         *
+         * @param key Key value to compare the elements to.
+         * @return const_iterator An const iterator pointing to the first element with key not less than k, or end() if such an element is not found.
+         */
+        [[nodiscard]] const_iterator lower_bound(std::string_view key) const
+        {
+            bool equal;
+            return { this, search(key, equal) };
+        }
+
+        /**
+         * @brief Finds the first element with key greater than @key, or end() if such an element is not found.
+         *
+         * @param key Key value to compare the elements to.
+         * @return const_iterator An const iterator pointing to the first element with key greater than @key, or end() if such an element is not found.
+         */
+        [[nodiscard]] const_iterator upper_bound(std::string_view key) const
+        {
+            bool equal;
+            size_type index = search(key, equal);
+            return { this, equal ? index + 1 : index };
+        }
+
+        /**
+         * @brief Swaps the contents of *this and other.
+         *
+         * @param other frozen_string_map with which must be swapped.
+         */
+        void swap(frozen_string_map& other) noexcept
+        {
+            m_bytes.swap(other.m_bytes);
+            m_blocks.swap(other.m_blocks);
+            m_values.swap(other.m_values);
+        }
+
+    private:
+        bytes_type m_bytes;
+        std::vector<std::size_t> m_blocks;
+        values_type m_values;
+
+        std::string_view first_key(std::size_t offset) const noexcept
+        {
+            std::size_t length = detail::read_varint(m_bytes.data(), offset);
+            return { m_bytes.data() + offset, length };
+        }
+
+        /**
+         * @brief Returns the index of the first key not less than @key and sets @equal if that key is equal to @key.
+         *        The keys of the block are not decoded: the scan keeps the length of the prefix the previous key shares with
+         *        @key, and a key sharing a longer prefix with the previous key is still less than @key, one sharing a shorter
+         *        prefix is greater, and only the suffix of a key sharing exactly that prefix is compared.
+         */
+        size_type search(std::string_view key, bool& equal) const noexcept
+        {
+            equal = false;
+            auto block = std::upper_bound(std::begin(m_blocks), std::end(m_blocks), key
+                , [this](std::string_view lhs, std::size_t rhs) { return lhs < first_key(rhs); });
+            if (block == std::begin(m_blocks)) {
+                return 0;
+            }
+            size_type index = static_cast<size_type>(block - std::begin(m_blocks) - 1) * BlockSize;
+            size_type last = std::min(index + BlockSize, m_values.size());
+            const char* bytes = m_bytes.data();
+            std::size_t pos = *(block - 1);
+            std::size_t length = detail::read_varint(bytes, pos);
+            std::string_view first(bytes + pos, length);
+            pos += length;
+            std::size_t matched = common_prefix(first, key);
+            if ((matched == first.size()) && (matched == key.size())) {
+                equal = true;
+                return index;
+            }
+            for (++index; index < last; ++index) {
+                std::size_t shared = detail::read_varint(bytes, pos);
+                std::size_t suffix = detail::read_varint(bytes, pos);
+                std::string_view tail(bytes + pos, suffix);
+                pos += suffix;
+                if (shared > matched) {
+                    continue;
+                }
+                if (shared < matched) {
+                    return index;
+                }
+                std::string_view rest = key.substr(matched);
+                std::size_t extra = common_prefix(tail, rest);
+                if (extra == rest.size()) {
+                    equal = (extra == tail.size());
+                    return index;
+                }
+                if ((extra < tail.size())
+                    && (static_cast<unsigned char>(rest[extra]) < static_cast<unsigned char>(tail[extra]))) {
+                    return index;
+                }
+                matched += extra;
+            }
+            return index;
+        }
+
+        static std::size_t common_prefix(std::string_view lhs, std::string_view rhs) noexcept
+        {
+            std::size_t length = std::min(lhs.size(), rhs.size());
+            return static_cast<std::size_t>(std::mismatch(lhs.data(), lhs.data() + length, rhs.data()).first - lhs.data());
+        }
+
+        template <typename It>
+        void build(It begin, It end)
+        {
+            std::string previous;
+            for (; begin != end; ++begin) {
+                auto&& element = *begin;
+                std::string_view key(element.first);
+                if (m_values.size() % BlockSize == 0) {
+                    m_blocks.push_back(m_bytes.size());
+                    detail::append_varint(m_bytes, key.size());
+                    m_bytes.insert(std::end(m_bytes), std::begin(key), std::end(key));
+                }
+                else {
+                    std::size_t shared = std::mismatch(std::begin(key), std::end(key)
+                        , std::begin(previous), std::end(previous)).first - std::begin(key);
+                    detail::append_varint(m_bytes, shared);
+                    detail::append_varint(m_bytes, key.size() - shared);
+                    m_bytes.insert(std::end(m_bytes), std::begin(key) + shared, std::end(key));
+                }
+                previous.assign(key);
+                m_values.emplace_back(std::forward<decltype(element)>(element).second);
+            }
+            m_bytes.shrink_to_fit();
+            m_blocks.shrink_to_fit();
+            m_values.shrink_to_fit();
+        }
+    };
+
+    template <typename V, std::size_t B, typename A>
+    void swap(frozen_string_map<V, B, A>& lhs, frozen_string_map<V, B, A>& rhs) noexcept
+    {
+        lhs.swap(rhs);
+    }
@@ -0,0 +1,732 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include "flat_map.h"
+
+    /**
+     * @brief A flat_map with a side hash index for O(1) point lookups. The index is an open-addressing table of 32-bit
+     *        positions into the sorted storage, keyed by Hash. find, at, contains, count and operator[] hits use
+     *        the index; ordered operations (lower_bound, upper_bound, equal_range, iteration) use the sorted storage.
+     *        The index is patched on single insertions and erasures and rebuilt after bulk operations.
+     *        Keys must not be modified through iterators, and the map can hold at most 2^32 - 1 elements.
+     *
+     * @tparam K is the key_type of the map.
+     * @tparam V is the value_type of the map.
+     * @tparam std::hash<K> the hash function for Keys, consistent with the equivalence defined by Comp.
+     * @tparam std::less<K> the ordering function for Keys.
+     * @tparam std::allocator<std::pair<K, V>> the allocator to allocate the value_types.
+     */
+    template <typename K
+        , typename V
+        , typename Hash = std::hash<K>
+        , typename Comp = std::less<K>
+        , typename Allocator = std::allocator<std::pair<K, V>>
+    >
+        struct hashed_flat_map
+    {
+        using map_type = flat_map<K, V, Comp, Allocator>;
+        using key_type = typename map_type::key_type;
+        using mapped_type = typename map_type::mapped_type;
+        using value_type = typename map_type::value_type;
+        using hasher = Hash;
+        using key_compare = typename map_type::key_compare;
+        using value_compare = typename map_type::value_compare;
+        using allocator_type = typename map_type::allocator_type;
+        using iterator = typename map_type::iterator;
+        using const_iterator = typename map_type::const_iterator;
+        using reverse_iterator = typename map_type::reverse_iterator;
+        using const_reverse_iterator = typename map_type::const_reverse_iterator;
+        using difference_type = typename map_type::difference_type;
+        using size_type = typename map_type::size_type;
+
+        hashed_flat_map() = default;
+        ~hashed_flat_map() = default;
+        hashed_flat_map(hashed_flat_map&&) = default;
+        hashed_flat_map(const hashed_flat_map&) = default;
+        hashed_flat_map& operator=(hashed_flat_map&&) = default;
+        hashed_flat_map& operator=(const hashed_flat_map&) = default;
+
+        /**
+         * @brief Constructs a hashed_flat_map holding the elements of @map.
+         *
+         * @param map The flat_map to take the elements from.
+         */
+        explicit hashed_flat_map(map_type map)
+            : m_map(std::move(map))
+        {
+            rebuild();
+        }
+
+        /**
+         * @brief Constructs an empty hashed_flat_map and inserts elements from the range [begin ,end ).
+         *
+         * @param begin range of elements to insert.
+         * @param end range of elements to insert.
+         */
+        template <typename It>
+        hashed_flat_map(It begin, It end)
+            : hashed_flat_map(map_type(begin, end))
+        {
+        }
+
+        /**
+         * @brief Constructs an empty hashed_flat_map and inserts elements from the range [il.begin() ,il.end()).
+         *
+         * @param init An initializer_list.
+         */
+        hashed_flat_map(std::initializer_list<value_type> init)
+            : hashed_flat_map(map_type(init))
+        {
+        }
+
+        /**
+         * @brief Returns the sorted storage.
+         *
+         * @return const map_type& The underlying flat_map.
+         */
+        [[nodiscard]] const map_type& get() const noexcept
+        {
+            return m_map;
+        }
+
+        /**
+         * @brief Returns an iterator to the first element contained in the container.
+         *
+         * @return An iterator to the first element.
+         */
+        [[nodiscard]] iterator begin() noexcept
+        {
+            return m_map.begin();
+        }
+
+        /**
+         * @brief Returns an iterator to the end of the container.
+         *
+         * @return An iterator to the end of the container.
+         */
+        [[nodiscard]] iterator end() noexcept
+        {
+            return m_map.end();
+        }
+
+        /**
+         * @brief Returns a const_iterator to the first element contained in the container.
+         *
+         * @return const_iterator to the first element.
+         */
+        [[nodiscard]] const_iterator begin() const noexcept
+        {
+            return m_map.begin();
+        }
+
+        /**
+         * @brief Returns a const_iterator to the end of the container.
+         *
+         * @return const_iterator to the end of the container.
+         */
+        [[nodiscard]] const_iterator end() const noexcept
+        {
+            return m_map.end();
+        }
+
+        /**
+         * @brief Returns a const_iterator to the first element contained in the container.
+         *
+         * @return const_iterator to the first element.
+         */
+        [[nodiscard]] const_iterator cbegin() const noexcept
+        {
+            return m_map.cbegin();
+        }
+
+        /**
+         * @brief Returns a const_iterator to the end of the container.
+         *
+         * @return const_iterator to the end of the container.
+         */
+        [[nodiscard]] const_iterator cend() const noexcept
+        {
+            return m_map.cend();
+        }
+
+        /**
+         * @brief Returns a reverse_iterator pointing to the beginning of the reversed container.
+         *
+         * @return reverse_iterator to the beginning of the reversed container.
+         */
+        [[nodiscard]] reverse_iterator rbegin() noexcept
+        {
+            return m_map.rbegin();
+        }
+
+        /**
+         * @brief  Returns a reverse_iterator pointing to the end of the reversed container.
+         *
+         * @return reverse_iterator to the end of the reversed container.
+         */
+        [[nodiscard]] reverse_iterator rend() noexcept
+        {
+            return m_map.rend();
+        }
+
+        /**
+         * @brief Returns a const_reverse_iterator pointing to the beginning of the reversed container.
+         *
+         * @return const_reverse_iterator to the beginning of the reversed container.
+         */
+        [[nodiscard]] const_reverse_iterator crbegin() const noexcept
+        {
+            return m_map.crbegin();
+        }
+
+        /**
+         * @brief Returns a const_reverse_iterator pointing to the end of the reversed container.
+         *
+         * @return const_reverse_iterator to the end of the reversed container.
+         */
+        [[nodiscard]] const_reverse_iterator crend() const noexcept
+        {
+            return m_map.crend();
+        }
+
+        /**
+         * @brief Checks the empyiness of the container
+         *
+         * @return true if the container contains no elemets, false otherwise.
+         */
+        [[nodiscard]] bool empty() const noexcept
+        {
+            return m_map.empty();
+        }
+
+        /**
+         * @brief  Returns the number of the elements contained in the container.
+         *
+         * @return The number of the elements of container.
+         */
+        [[nodiscard]] size_type size() const noexcept
+        {
+            return m_map.size();
+        }
+
+        /**
+         * @brief Requests allocation of memory for at least @size elements, in the storage and in the index.
+         *
+         * @param size Requested size for allocation of additional memory.
+         */
+        void reserve(size_type size)
+        {
+            m_map.reserve(size);
+            if (table_size_for(size) > m_table.size()) {
+                rebuild(table_size_for(size));
+            }
+        }
+
+        /**
+         * @brief If there is no key equivalent to @key in the map, inserts value_type(@key, T()) into the map.
+         *        A hit is answered by the hash index.
+         *
+         * @param key The key of the element to find.
+         * @return mapped_type& A reference to the mapped_type corresponding to @key in *this.
+         */
+        mapped_type& operator[] (const key_type& key)
+        {
+            size_type found = lookup(key);
+            if (found != npos) {
+                return (m_map.begin() + found)->second;
+            }
+            return emplace(key, mapped_type()).first->second;
+        }
+
+        /**
+         * @brief If there is no key equivalent to @key in the map, inserts value_type(move(@key), T()) into the map.
+         *        A hit is answered by the hash index.
+         *
+         * @param key The key of the element to find.
+         * @return mapped_type& A reference to the mapped_type corresponding to @key in *this.
+         */
+        mapped_type& operator[] (key_type&& key)
+        {
+            size_type found = lookup(key);
+            if (found != npos) {
+                return (m_map.begin() + found)->second;
+            }
+            return emplace(std::move(key), mapped_type()).first->second;
+        }
+
+        /**
+         * @brief Returns a reference to the element whose key is equivalent to @key, using the hash index.
+         *        Throws an exception object of type out_of_range if no such element is present.
+         *
+         * @param key The key of the element to find.
+         * @return mapped_type& A reference to the element whose key is equivalent to @key.
+         */
+        mapped_type& at(const key_type& key)
+        {
+            auto found = find(key);
+            if (found == end()) {
+                detail::throw_out_of_range("key passed to 'at' doesn't exist in this map");
+            }
+            return found->second;
+        }
+
+        /**
+         * @brief Returns a reference to the element whose key is equivalent to @key, using the hash index.
+         *        Throws an exception object of type out_of_range if no such element is present.
+         *
+         * @param key The key of the element to find.
+         * @return const mapped_type& A const reference to the element whose key is equivalent to @key.
+         */
+        const mapped_type& at(const key_type& key) const
+        {
+            auto found = find(key);
+            if (found == end()) {
+                detail::throw_out_of_range("key passed to 'at' doesn't exist in this map");
+            }
+            return found->second;
+        }
+
+        /**
+         * @brief  Inserts value if and only if there is no element in the container with key equivalent to the key of value.
+         *
+         * @param value std::pair<Key,T> for insertion.
+         * @return std::pair<iterator, bool> The bool component of the returned pair is true if and only if the insertion takes place,
+         *         and the iterator component of the pair points to the element with key equivalent to the key of @key.
+         */
+        std::pair<iterator, bool> insert(const value_type& value)
+        {
+            return emplace(value);
+        }
+
+        /**
+         * @brief Inserts a new value_type move constructed from the pair if and only if there is no element in the container with key equivalent to the key of value.
+         *
+         * @param value std::pair<Key,T> for insertion.
+         * @return std::pair<iterator, bool> The bool component of the returned pair is true if and only if the insertion takes place,
+         *               and the iterator component of the pair points to the element with key equivalent to the key of @key.
+         */
+        std::pair<iterator, bool> insert(value_type&& value)
+        {
+            return emplace(std::move(value));
+        }
+
+        /**
+         * @brief Inserts each element from the range [first,last) if and only if there is no element with key equivalent to the key of that element.
+         *        The hash index is rebuilt once afterwards.
+         *
+         * @param begin range of elements to insert.
+         * @param end range of elements to insert.
+         */
+        template <typename It>
+        void insert(It begin, It end)
+        {
+            try
+            {
+                m_map.insert(begin, end);
+            }
+            catch (...)
+            {
+                rebuild();
+                throw;
+            }
+            rebuild();
+        }
+
+        /**
+         * @brief Inserts each element from the range [il.begin(), il.end()) if and only if there is no element with key equivalent to the key of that element.
+         *
+         * @param il An initializer_list.
+         */
+        void insert(std::initializer_list<value_type> il)
+        {
+            insert(std::begin(il), std::end(il));
+        }
+
+        /**
+         * @brief Constructs a value_type from @first and @args and inserts it if there is no element with an equivalent key.
+         *        The hash index is patched for the shifted positions.
+         *
+         * @param first
+         * @param args
+         * @return std::pair<iterator, bool> The bool component of the returned pair is true if and only if the insertion took place, and
+                   the iterator component of the pair points to the element with key equivalent to the key of t
+         */
+        template <typename First, typename ... Args>
+        std::pair<iterator, bool> emplace(First&& first, Args&& ... args)
+        {
+            auto inserted = m_map.emplace(std::forward<First>(first), std::forward<Args>(args) ...);
+            if (inserted.second) {
+                size_type position = inserted.first - m_map.begin();
+                if (table_size_for(m_map.size()) > m_table.size()) {
+                    rebuild();
+                }
+                else {
+                    shift_positions(position, 1);
+                    place(position);
+                }
+            }
+            return inserted;
+        }
+
+        /**
+         * @brief Erases the element pointed to by it. The hash index is patched for the shifted positions.
+         *
+         * @param it Iterator pointing to the element to be erased.
+         * @return iterator An iterator pointing to the element immediately following the erased one. If no such element exists, returns end().
+         */
+        iterator erase(const_iterator it)
+        {
+            size_type position = it - m_map.cbegin();
+            unplace(position);
+            shift_positions(position, -1);
+            return m_map.erase(it);
+        }
+
+        /**
+         * @brief Erases element in the container with key equivalent to @key.
+         *
+         * @param key Key value of the element to remove.
+         * @return  0 if @key not found in container, 1 otherwise.
+         */
+        size_type erase(const key_type& key)
+        {
+            size_type found = lookup(key);
+            if (found == npos) {
+                return 0;
+            }
+            erase(m_map.cbegin() + found);
+            return 1;
+        }
+
+        /**
+         * @brief Erases all the elements in the range [first, last). The hash index is rebuilt afterwards.
+         *
+         * @param first range of elements to remove.
+         * @param last range of elements to remove.
+         * @return iterator to the next of the last deleted element.
+         */
+        iterator erase(const_iterator first, const_iterator last)
+        {
+            auto result = m_map.erase(first, last);
+            rebuild();
+            return result;
+        }
+
+        /**
+         * @brief Swaps the contents of *this and other.
+         *
+         * @param other hashed_flat_map with which must be swapped.
+         */
+        void swap(hashed_flat_map& other) noexcept
+        {
+            m_map.swap(other.m_map);
+            m_table.swap(other.m_table);
+        }
+
+        /**
+         * @brief Erases all elements in container.
+         *
+         */
+        void clear()
+        {
+            m_map.clear();
+            m_table.clear();
+        }
+
+        /**
+         * @brief Returns the comparison object out of which a was constructed.
+         *
+         * @return key_compare The comparison object
+         */
+        key_compare key_comp() const
+        {
+            return m_map.key_comp();
+        }
+
+        /**
+         * @brief Returns an object of value_compare constructed out of the comparison object.
+         *
+         * @return value_compare An object of value_compare.
+         */
+        value_compare value_comp() const
+        {
+            return m_map.value_comp();
+        }
+
+        /**
+         * @brief Attempts to find an element with key equivalent to @key, using the hash index.
+         *
+         * @param key Key value of the element to search for.
+         * @return iterator An iterator pointing to an element with the key equivalent to key, or end() if such an element is not found.
+         */
+        [[nodiscard]] iterator find(const key_type& key)
+        {
+            size_type found = lookup(key);
+            return (found == npos) ? m_map.end() : m_map.begin() + found;
+        }
+
+        /**
+         * @brief Attempts to find an element with key equivalent to @key, using the hash index.
+         *
+         * @param key Key value of the element to search for.
+         * @return const_iterator A const_iterator pointing to an element with the key equivalent to @key, or end() if such an element is not found.
+         */
+        [[nodiscard]] const_iterator find(const key_type& key) const
+        {
+            size_type found = lookup(key);
+            return (found == npos) ? m_map.end() : m_map.begin() + found;
+        }
+
+        /**
+         * @brief Checks if there is an element with key equivalent to @key in the container, using the hash index.
+         *
+         * @param key Key value of the element to search for.
+         * @return true if there is such an element, false otherwise.
+         */
+        [[nodiscard]] bool contains(const key_type& key) const
+        {
+            return lookup(key) != npos;
+        }
+
+        /**
+         * @brief Returns the number of elements with key equivalent to @key, using the hash index.
+         *
+         * @param key Key value of the element to count.
+         * @return 1 if the element is found, 0 otherwise.
+         */
+        [[nodiscard]] size_type count(const key_type& key) const
+        {
+            return contains(key) ? 1 : 0;
+        }
+
+        /**
+         * @brief Finds the first element with key not less than @key, or end() if such an element is not found.
+         *
+         * @param key Key value to compare the elements to.
+         * @return iterator An iterator pointing to the first element with key not less than k, or end() if such an element is not found.
+         */
+        template <typename T>
+        [[nodiscard]] iterator lower_bound(const T& key)
+        {
+            return m_map.lower_bound(key);
+        }
+
+        /**
+         * @brief Finds the first element with key not less than @key, or end() if such an element is not found.
+         *
+         * @param key Key value to compare the elements to.
+         * @return const_iterator An const iterator pointing to the first element with key not less than k, or end() if such an element is not found.
+         */
+        template <typename T>
+        [[nodiscard]] const_iterator lower_bound(const T& key) const
+        {
+            return m_map.lower_bound(key);
+        }
+
+        /**
+         * @brief Finds the first element with key greater than @key, or end() if such an element is not found.
+         *
+         * @param key Key value to compare the elements to.
+         * @return iterator An iterator pointing to the first element with key greater than @key, or end() if such an element is not found.
+         */
+        template <typename T>
+        [[nodiscard]] iterator upper_bound(const T& key)
+        {
+            return m_map.upper_bound(key);
+        }
+
+        /**
+         * @brief Finds the first element with key greater than @key, or end() if such an element is not found.
+         *
+         * @param key Key value to compare the elements to.
+         * @return const_iterator An const iterator pointing to the first element with key greater than @key, or end() if such an element is not found.
+         */
+        template <typename T>
+        [[nodiscard]] const_iterator upper_bound(const T& key) const
+        {
+            return m_map.upper_bound(key);
+        }
+
+        /**
+         * @brief  Returns a range containing all elements equivalent to value in the range [first, last).
+         *
+         * @param key Key value to compare the elements to.
+         * @return std::pair<iterator, iterator> std::pair containing a pair of iterators defining the wanted range.
+         */
+        template <typename T>
+        [[nodiscard]] std::pair<iterator, iterator> equal_range(const T& key)
+        {
+            return m_map.equal_range(key);
+        }
+
+        /**
+         * @brief  Returns a range containing all elements equivalent to value in the range [first, last).
+         *
+         * @param key Key value to compare the elements to.
+         * @return std::pair<const_iterator, const_iterator> std::pair containing a pair of iterators defining the wanted range.
+         */
+        template <typename T>
+        [[nodiscard]] std::pair<const_iterator, const_iterator> equal_range(const T& key) const
+        {
+            return m_map.equal_range(key);
+        }
+
+        /**
+         * @brief Returns a copy of the allocator that was passed to the object's constructor.
+         *
+         * @return allocator_type Copy of the allocator.
+         */
+        allocator_type get_allocator() const
+        {
+            return m_map.get_allocator();
+        }
+
+        /**
+         * @brief Compares two hashed_flat_maps.
+         *
+         * @param other A hashed_flat_map with which need to compare.
+         * @return true if they are equal,false otherwise.
+         */
+        bool operator== (const hashed_flat_map& other) const
+        {
+            return m_map == other.m_map;
+        }
+
+        /**
+         * @brief Compares two hashed_flat_maps.
+         *
+         * @param other A hashed_flat_map with which need to compare.
+         * @return true if they are unequal,false otherwise.
+         */
+        bool operator!= (const hashed_flat_map& other) const
+        {
+            return m_map != other.m_map;
+        }
+
+        /**
+         * @brief Compares two hashed_flat_maps.
+         *
+         * @param other A hashed_flat_map with which need to compare.
+         * @return true if current hashed_flat_map is less than other.
+         */
+        bool operator< (const hashed_flat_map& other) const
+        {
+            return m_map < other.m_map;
+        }
+
+    private:
+        using slot_type = std::uint32_t;
+
+        static constexpr slot_type empty_slot = std::numeric_limits<slot_type>::max();
+        static constexpr size_type npos = std::numeric_limits<size_type>::max();
+
+        map_type m_map;
+        std::vector<slot_type> m_table;
+
+        /**
+         * @brief Returns the power of two table size which keeps the load factor of @size elements under one half.
+         */
+        static size_type table_size_for(size_type size)
+        {
+            size_type result = 16;
+            while (result < size * 2) {
+                result *= 2;
+            }
+            return result;
+        }
+
+        /**
+         * @brief Returns the first slot probed for @key. The hash is mixed before it is masked: std::hash of integers is
+         *        usually the identity, and keys sharing their low bits would otherwise all start in the same probe chain.
+         */
+        size_type home(const key_type& key) const
+        {
+            std::uint64_t hash = static_cast<std::uint64_t>(hasher()(key));
+            hash ^= hash >> 33;
+            hash *= 0xff51afd7ed558ccdULL;
+            hash ^= hash >> 33;
+            return static_cast<size_type>(hash) & (m_table.size() - 1);
+        }
+
+        size_type lookup(const key_type& key) const
+        {
+            if (m_table.empty()) {
+                return npos;
+            }
+            key_compare comp;
+            for (size_type i = home(key); ; i = (i + 1) & (m_table.size() - 1)) {
+                slot_type position = m_table[i];
+                if (position == empty_slot) {
+                    return npos;
+                }
+                const key_type& candidate = (m_map.begin() + position)->first;
+                if (!comp(key, candidate) && !comp(candidate, key)) {
+                    return position;
+                }
+            }
+        }
+
+        void place(size_type position)
+        {
+            size_type i = home((m_map.begin() + position)->first);
+            while (m_table[i] != empty_slot) {
+                i = (i + 1) & (m_table.size() - 1);
+            }
+            m_table[i] = static_cast<slot_type>(position);
+        }
+
+        /**
+         * @brief Removes the slot of @position with backward-shift deletion, so no tombstones are needed.
+         */
+        void unplace(size_type position)
+        {
+            size_type mask = m_table.size() - 1;
+            size_type i = home((m_map.begin() + position)->first);
+            while (m_table[i] != position) {
+                i = (i + 1) & mask;
+            }
+            for (size_type j = (i + 1) & mask; m_table[j] != empty_slot; j = (j + 1) & mask) {
+                size_type wanted = home((m_map.begin() + m_table[j])->first);
+                if (((j - wanted) & mask) >= ((j - i) & mask)) {
+                    m_table[i] = m_table[j];
+                    i = j;
+                }
+            }
+            m_table[i] = empty_slot;
+        }
+
+        /**
+         * @brief Adds @delta to every indexed position not less than @from.
+         */
+        void shift_positions(size_type from, int delta)
+        {
+            for (auto& position : m_table) {
+                if ((position != empty_slot) && (position >= from)) {
+                    position = static_cast<slot_type>(position + delta);
+                }
+            }
+        }
+
+        void rebuild()
+        {
+            rebuild(std::max(table_size_for(m_map.size()), m_table.size()));
+        }
+
+        void rebuild(size_type table_size)
+        {
+            m_table.assign(table_size, empty_slot);
+            for (size_type i = 0; i < m_map.size(); ++i) {
+                place(i);
+            }
+        }
+    };
+
+    template <typename K, typename V, typename H, typename C, typename A>
+    void swap(hashed_flat_map<K, V, H, C, A>& lhs, hashed_flat_map<K, V, H, C, A>& rhs) noexcept
+    {
+        lhs.swap(rhs);
+    }
@@ -0,0 +1,782 @@
+#pragma once
+
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "flat_map.h"
+
+    /**
+     * @brief A flat_map whose erase only marks the slot of the element as dead in a side bitmap instead of shifting the
+     *        elements after it. Dead slots are skipped by iteration and lookups, and are removed in one linear pass when
+     *        their fraction crosses max_dead_ratio() or when compact() is called.
+     *        Inserting a key whose slot is dead, or which falls next to a dead slot, reuses that slot in place.
+     *
+     * @tparam K is the key_type of the map.
+     * @tparam V is the value_type of the map.
+     * @tparam std::less<K> the ordering function for Keys.
+     * @tparam std::allocator<std::pair<K, V>> the allocator to allocate the value_types.
+     */
+    template <typename K
+        , typename V
+        , typename Comp = std::less<K>
+        , typename Allocator = std::allocator<std::pair<K, V>>
+    >
+        struct lazy_erase_flat_map
+    {
+        using key_type = K;
+        using mapped_type = V;
+        using value_type = std::pair<K, V>;
+        using key_compare = Comp;
+        using allocator_type = Allocator;
+        using container_type = std::vector<value_type, allocator_type>;
+        using difference_type = typename container_type::difference_type;
+        using size_type = typename container_type::size_type;
+
+        static constexpr double default_max_dead_ratio = 0.25;
+
+    private:
+        template <bool Const>
+        struct basic_iterator
+        {
+            using owner_type = std::conditional_t<Const, const lazy_erase_flat_map, lazy_erase_flat_map>;
+            using iterator_category = std::bidirectional_iterator_tag;
+            using value_type = typename lazy_erase_flat_map::value_type;
+            using difference_type = typename lazy_erase_flat_map::difference_type;
+            using reference = std::conditional_t<Const, const value_type&, value_type&>;
+            using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+
+            basic_iterator() = default;
+
+            basic_iterator(owner_type* owner, size_type index)
+                : m_owner(owner)
+                , m_index(index)
+            {
+            }
+
+            template <bool C = Const, typename = std::enable_if_t<C>>
+            basic_iterator(const basic_iterator<false>& other)
+                : m_owner(other.m_owner)
+                , m_index(other.m_index)
+            {
+            }
+
+            [[nodiscard]] reference operator* () const
+            {
+                return m_owner->m_data[m_index];
+            }
+
+            [[nodiscard]] pointer operator-> () const
+            {
+                return &m_owner->m_data[m_index];
+            }
+
+            basic_iterator& operator++ ()
+            {
+                m_index = m_owner->next_live(m_index + 1);
+                return *this;
+            }
+
+            basic_iterator operator++ (int)
+            {
+                basic_iterator result = *this;
+                ++*this;
+                return result;
+            }
+
+            basic_iterator& operator-- ()
+            {
+                do {
+                    --m_index;
+                } while (m_owner->m_dead[m_index]);
+                return *this;
+            }
+
+            basic_iterator operator-- (int)
+            {
+                basic_iterator result = *this;
+                --*this;
+                return result;
+            }
+
+            bool operator== (const basic_iterator& other) const
+            {
+                return m_index == other.m_index;
+            }
+
+            bool operator!= (const basic_iterator& other) const
+            {
+                return m_index != other.m_index;
+            }
+
+        private:
+            friend struct lazy_erase_flat_map;
+            friend struct basic_iterator<true>;
+
+            owner_type* m_owner = nullptr;
+            size_type m_index = 0;
+        };
+
+    public:
+        using iterator = basic_iterator<false>;
+        using const_iterator = basic_iterator<true>;
+        using reverse_iterator = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+        lazy_erase_flat_map() = default;
+        ~lazy_erase_flat_map() = default;
+        lazy_erase_flat_map(lazy_erase_flat_map&&) = default;
+        lazy_erase_flat_map(const lazy_erase_flat_map&) = default;
+        lazy_erase_flat_map& operator=(lazy_erase_flat_map&&) = default;
+        lazy_erase_flat_map& operator=(const lazy_erase_flat_map&) = default;
+
+        /**
+         * @brief Constructs an empty lazy_erase_flat_map and inserts elements from the range [begin ,end ).
+         *
+         * @param begin range of elements to insert.
+         * @param end range of elements to insert.
+         */
+        template <typename It>
+        lazy_erase_flat_map(It begin, It end)
+        {
+            insert(begin, end);
+        }
+
+        /**
+         * @brief Constructs an empty lazy_erase_flat_map and inserts elements from the range [il.begin() ,il.end()).
+         *
+         * @param init An initializer_list.
+         */
+        lazy_erase_flat_map(std::initializer_list<value_type> init)
+            : lazy_erase_flat_map(std::begin(init), std::end(init))
+        {
+        }
+
+        /**
+         * @brief Returns an iterator to the first live element contained in the container.
+         *
+         * @return An iterator to the first element.
+         */
+        [[nodiscard]] iterator begin() noexcept
+        {
+            return { this, next_live(0) };
+        }
+
+        /**
+         * @brief Returns an iterator to the end of the container.
+         *
+         * @return An iterator to the end of the container.
+         */
+        [[nodiscard]] iterator end() noexcept
+        {
+            return { this, m_data.size() };
+        }
+
+        /**
+         * @brief Returns a const_iterator to the first live element contained in the container.
+         *
+         * @return const_iterator to the first element.
+         */
+        [[nodiscard]] const_iterator begin() const noexcept
+        {
+            return { this, next_live(0) };
+        }
+
+        /**
+         * @brief Returns a const_iterator to the end of the container.
+         *
+         * @return const_iterator to the end of the container.
+         */
+        [[nodiscard]] const_iterator end() const noexcept
+        {
+            return { this, m_data.size() };
+        }
+
+        /**
+         * @brief Returns a const_iterator to the first live element contained in the container.
+         *
+         * @return const_iterator to the first element.
+         */
+        [[nodiscard]] const_iterator cbegin() const noexcept
+        {
+            return begin();
+        }
+
+        /**
+         * @brief Returns a const_iterator to the end of the container.
+         *
+         * @return const_iterator to the end of the container.
+         */
+        [[nodiscard]] const_iterator cend() const noexcept
+        {
+            return end();
+        }
+
+        /**
+         * @brief Returns a reverse_iterator pointing to the beginning of the reversed container.
+         *
+         * @return reverse_iterator to the beginning of the reversed container.
+         */
+        [[nodiscard]] reverse_iterator rbegin() noexcept
+        {
+            return reverse_iterator(end());
+        }
+
+        /**
+         * @brief  Returns a reverse_iterator pointing to the end of the reversed container.
+         *
+         * @return reverse_iterator to the end of the reversed container.
+         */
+        [[nodiscard]] reverse_iterator rend() noexcept
+        {
+            return reverse_iterator(begin());
+        }
+
+        /**
+         * @brief Returns a const_reverse_iterator pointing to the beginning of the reversed container.
+         *
+         * @return const_reverse_iterator to the beginning of the reversed container.
+         */
+        [[nodiscard]] const_reverse_iterator rbegin() const noexcept
+        {
+            return const_reverse_iterator(end());
+        }
+
+        /**
+         * @brief Returns a const_reverse_iterator pointing to the end of the reversed container.
+         *
+         * @return const_reverse_iterator to the end of the reversed container.
+         */
+        [[nodiscard]] const_reverse_iterator rend() const noexcept
+        {
+            return const_reverse_iterator(begin());
+        }
+
+        /**
+         * @brief Checks the empyiness of the container
+         *
+         * @return true if the container contains no live elemets, false otherwise.
+         */
+        [[nodiscard]] bool empty() const noexcept
+        {
+            return size() == 0;
+        }
+
+        /**
+         * @brief  Returns the number of the live elements contained in the container.
+         *
+         * @return The number of the elements of container.
+         */
+        [[nodiscard]] size_type size() const noexcept
+        {
+            return m_data.size() - m_dead_count;
+        }
+
+        /**
+         * @brief  Returns the number of the slots which are marked as dead and wait for compaction.
+         *
+         * @return The number of the dead slots.
+         */
+        [[nodiscard]] size_type dead_count() const noexcept
+        {
+            return m_dead_count;
+        }
+
+        /**
+         * @brief Number of elements for which memory has been allocated. capacity() is always greater than or equal to size().
+         *
+         * @return Number of elements for which memory has been allocated.
+         */
+        [[nodiscard]] size_type capacity() const noexcept
+        {
+            return m_data.capacity();
+        }
+
+        /**
+         * @brief Requests allocation of memory for at least @size slots.
+         *
+         * @param size Requested size for allocation of additional memory.
+         */
+        void reserve(size_type size)
+        {
+            m_data.reserve(size);
+            m_dead.reserve(size);
+        }
+
+        /**
+         * @brief Returns the fraction of dead slots above which erase compacts the storage.
+         *
+         * @return The maximal fraction of dead slots.
+         */
+        [[nodiscard]] double max_dead_ratio() const noexcept
+        {
+            return m_max_dead_ratio;
+        }
+
+        /**
+         * @brief Sets the fraction of dead slots above which erase compacts the storage.
+         *        0 compacts on every erase, 1 never compacts automatically.
+         *
+         * @param ratio The maximal fraction of dead slots.
+         */
+        void max_dead_ratio(double ratio) noexcept
+        {
+            m_max_dead_ratio = ratio;
+        }
+
+        /**
+         * @brief Removes all dead slots in one linear pass. Invalidates all iterators.
+         *
+         */
+        void compact()
+        {
+            compact_before(m_data.size());
+        }
+
+        /**
+         * @brief If there is no key equivalent to @key in the map, inserts value_type(@key, T()) into the map.
+         *
+         * @param key The key of the element to find.
+         * @return mapped_type& A reference to the mapped_type corresponding to @key in *this.
+         */
+        mapped_type& operator[] (const key_type& key)
+        {
+            return emplace(key).first->second;
+        }
+
+        /**
+         * @brief If there is no key equivalent to @key in the map, inserts value_type(move(@key), T()) into the map.
+         *
+         * @param key The key of the element to find.
+         * @return mapped_type& A reference to the mapped_type corresponding to @key in *this.
+         */
+        mapped_type& operator[] (key_type&& key)
+        {
+            return emplace(std::move(key)).first->second;
+        }
+
+        /**
+         * @brief Returns a reference to the element whose key is equivalent to @key.
+         *        Throws an exception object of type out_of_range if no such element is present.
+         *
+         * @param key The key of the element to find.
+         * @return mapped_type& A reference to the element whose key is equivalent to @key.
+         */
+        mapped_type& at(const key_type& key)
+        {
+            auto found = find(key);
+            if (found == end()) {
+                detail::throw_out_of_range("key passed to 'at' doesn't exist in this map");
+            }
+            return found->second;
+        }
+
+        /**
+         * @brief Returns a reference to the element whose key is equivalent to @key.
+         *        Throws an exception object of type out_of_range if no such element is present.
+         *
+         * @param key The key of the element to find.
+         * @return const mapped_type& A const reference to the element whose key is equivalent to @key.
+         */
+        const mapped_type& at(const key_type& key) const
+        {
+            auto found = find(key);
+            if (found == end()) {
+                detail::throw_out_of_range("key passed to 'at' doesn't exist in this map");
+            }
+            return found->second;
+        }
+
+        /**
+         * @brief  Inserts value if and only if there is no live element in the container with key equivalent to the key of value.
+         *
+         * @param value std::pair<Key,T> for insertion.
+         * @return std::pair<iterator, bool> The bool component of the returned pair is true if and only if the insertion takes place,
+         *         and the iterator component of the pair points to the element with key equivalent to the key of @key.
+         */
+        std::pair<iterator, bool> insert(const value_type& value)
+        {
+            return emplace(value.first, value.second);
+        }
+
+        /**
+         * @brief Inserts a new value_type move constructed from the pair if and only if there is no live element in the container with key equivalent to the key of value.
+         *
+         * @param value std::pair<Key,T> for insertion.
+         * @return std::pair<iterator, bool> The bool component of the returned pair is true if and only if the insertion takes place,
+         *               and the iterator component of the pair points to the element with key equivalent to the key of @key.
+         */
+        std::pair<iterator, bool> insert(value_type&& value)
+        {
+            return emplace(std::move(value.first), std::move(value.second));
+        }
+
+        /**
+         * @brief Inserts each element from the range [first,last) if and only if there is no element with key equivalent to the key of that element.
+         *
+         * @param begin range of elements to insert.
+         * @param end range of elements to insert.
+         */
+        template <typename It>
+        void insert(It begin, It end)
+        {
+            for (; begin != end; ++begin) {
+                insert(*begin);
+            }
+        }
+
+        /**
+         * @brief Inserts each element from the range [il.begin(), il.end()) if and only if there is no element with key equivalent to the key of that element.
+         *
+         * @param il An initializer_list.
+         */
+        void insert(std::initializer_list<value_type> il)
+        {
+            insert(std::begin(il), std::end(il));
+        }
+
+        /**
+         * @brief Inserts a value constructed from @args with the key @key if and only if there is no live element with key equivalent to @key.
+         *        A dead slot of the same key, or a dead slot adjacent to the insertion point, is reused without shifting.
+         *
+         * @param key The key of the element to insert.
+         * @param args Arguments to construct the value from.
+         * @return std::pair<iterator, bool> The bool component of the returned pair is true if and only if the insertion took place, and
+                   the iterator component of the pair points to the element with key equivalent to @key.
+         */
+        template <typename Key, typename ... Args>
+        std::pair<iterator, bool> emplace(Key&& key, Args&& ... args)
+        {
+            key_compare comp;
+            size_type index = raw_lower_bound(key);
+            bool found = (index != m_data.size()) && !comp(key, m_data[index].first);
+            if (found && !m_dead[index]) {
+                return { iterator(this, index), false };
+            }
+            if (!found && (index != 0) && m_dead[index - 1]) {
+                --index;
+                found = true;
+            }
+            else if (!found && (index != m_data.size()) && m_dead[index]) {
+                found = true;
+            }
+            if (found) {
+                m_data[index] = value_type(std::forward<Key>(key), mapped_type(std::forward<Args>(args) ...));
+                m_dead[index] = false;
+                --m_dead_count;
+                return { iterator(this, index), true };
+            }
+            m_data.emplace(std::begin(m_data) + index, std::piecewise_construct
+                , std::forward_as_tuple(std::forward<Key>(key)), std::forward_as_tuple(std::forward<Args>(args) ...));
+            try
+            {
+                m_dead.insert(std::begin(m_dead) + index, false);
+            }
+            catch (...)
+            {
+                m_data.erase(std::begin(m_data) + index);
+                throw;
+            }
+            return { iterator(this, index), true };
+        }
+
+        /**
+         * @brief Marks the element pointed to by it as dead.
+         *
+         * @param it Iterator pointing to the element to be erased.
+         * @return iterator An iterator pointing to the element immediately following the erased one. If no such element exists, returns end().
+         */
+        iterator erase(const_iterator it)
+        {
+            m_dead[it.m_index] = true;
+            ++m_dead_count;
+            return settle(next_live(it.m_index + 1));
+        }
+
+        /**
+         * @brief Marks the element pointed to by it as dead.
+         *
+         * @param it Iterator pointing to the element to be erased.
+         * @return iterator An iterator pointing to the element immediately following the erased one. If no such element exists, returns end().
+         */
+        iterator erase(iterator it)
+        {
+            return erase(const_iterator(it));
+        }
+
+        /**
+         * @brief Marks element in the container with key equivalent to @key as dead.
+         *
+         * @param key Key value of the element to remove.
+         * @return  0 if @key not found in container, 1 otherwise.
+         */
+        size_type erase(const key_type& key)
+        {
+            auto found = find(key);
+            if (found == end()) {
+                return 0;
+            }
+            erase(found);
+            return 1;
+        }
+
+        /**
+         * @brief Marks all the elements in the range [first, last) as dead.
+         *
+         * @param first range of elements to remove.
+         * @param last range of elements to remove.
+         * @return iterator to the next of the last deleted element.
+         */
+        iterator erase(const_iterator first, const_iterator last)
+        {
+            for (size_type i = first.m_index; i < last.m_index; ++i) {
+                if (!m_dead[i]) {
+                    m_dead[i] = true;
+                    ++m_dead_count;
+                }
+            }
+            return settle(last.m_index);
+        }
+
+        /**
+         * @brief Swaps the contents of *this and other.
+         *
+         * @param other lazy_erase_flat_map with which must be swapped.
+         */
+        void swap(lazy_erase_flat_map& other) noexcept
+        {
+            m_data.swap(other.m_data);
+            m_dead.swap(other.m_dead);
+            std::swap(m_dead_count, other.m_dead_count);
+            std::swap(m_max_dead_ratio, other.m_max_dead_ratio);
+        }
+
+        /**
+         * @brief Erases all elements in container.
+         *
+         */
+        void clear()
+        {
+            m_data.clear();
+            m_dead.clear();
+            m_dead_count = 0;
+        }
+
+        /**
+         * @brief Returns the comparison object out of which a was constructed.
+         *
+         * @return key_compare The comparison object
+         */
+        key_compare key_comp() const
+        {
+            return key_compare();
+        }
+
+        /**
+         * @brief Attempts to find a live element with key equivalent to @key.
+         *
+         * @param key Key value of the element to search for.
+         * @return iterator An iterator pointing to an element with the key equivalent to key, or end() if such an element is not found.
+         */
+        [[nodiscard]] iterator find(const key_type& key)
+        {
+            return { this, raw_find(key) };
+        }
+
+        /**
+         * @brief Attempts to find a live element with key equivalent to @key.
+         *
+         * @param key Key value of the element to search for.
+         * @return const_iterator A const_iterator pointing to an element with the key equivalent to @key, or end() if such an element is not found.
+         */
+        [[nodiscard]] const_iterator find(const key_type& key) const
+        {
+            return { this, raw_find(key) };
+        }
+
+        /**
+         * @brief Checks if there is a live element with key equivalent to @key in the container.
+         *
+         * @param key Key value of the element to search for.
+         * @return true if there is such an element, false otherwise.
+         */
+        [[nodiscard]] bool contains(const key_type& key) const
+        {
+            return raw_find(key) != m_data.size();
+        }
+
+        /**
+         * @brief Returns the number of live elements with key equivalent to @key.
+         *
+         * @param key Key value of the element to count.
+         * @return 1 if the element is found, 0 otherwise.
+         */
+        [[nodiscard]] size_type count(const key_type& key) const
+        {
+            return contains(key) ? 1 : 0;
+        }
+
+        /**
+         * @brief Finds the first live element with key not less than @key, or end() if such an element is not found.
+         *
+         * @param key Key value to compare the elements to.
+         * @return iterator An iterator pointing to the first element with key not less than k, or end() if such an element is not found.
+         */
+        [[nodiscard]] iterator lower_bound(const key_type& key)
+        {
+            return { this, next_live(raw_lower_bound(key)) };
+        }
+
+        /**
+         * @brief Finds the first live element with key not less than @key, or end() if such an element is not found.
+         *
+         * @param key Key value to compare the elements to.
+         * @return const_iterator An const iterator pointing to the first element with key not less than k, or end() if such an element is not found.
+         */
+        [[nodiscard]] const_iterator lower_bound(const key_type& key) const
+        {
+            return { this, next_live(raw_lower_bound(key)) };
+        }
+
+        /**
+         * @brief Finds the first live element with key greater than @key, or end() if such an element is not found.
+         *
+         * @param key Key value to compare the elements to.
+         * @return iterator An iterator pointing to the first element with key greater than @key, or end() if such an element is not found.
+         */
+        [[nodiscard]] iterator upper_bound(const key_type& key)
+        {
+            return { this, next_live(raw_upper_bound(key)) };
+        }
+
+        /**
+         * @brief Finds the first live element with key greater than @key, or end() if such an element is not found.
+         *
+         * @param key Key value to compare the elements to.
+         * @return const_iterator An const iterator pointing to the first element with key greater than @key, or end() if such an element is not found.
+         */
+        [[nodiscard]] const_iterator upper_bound(const key_type& key) const
+        {
+            return { this, next_live(raw_upper_bound(key)) };
+        }
+
+        /**
+         * @brief Returns a copy of the allocator that was passed to the object's constructor.
+         *
+         * @return allocator_type Copy of the allocator.
+         */
+        allocator_type get_allocator() const
+        {
+            return m_data.get_allocator();
+        }
+
+        /**
+         * @brief Compares the live elements of two maps.
+         *
+         * @param other A lazy_erase_flat_map with which need to compare.
+         * @return true if they are equal,false otherwise.
+         */
+        bool operator== (const lazy_erase_flat_map& other) const
+        {
+            return (size() == other.size()) && std::equal(begin(), end(), other.begin());
+        }
+
+        /**
+         * @brief Compares the live elements of two maps.
+         *
+         * @param other A lazy_erase_flat_map with which need to compare.
+         * @return true if they are unequal,false otherwise.
+         */
+        bool operator!= (const lazy_erase_flat_map& other) const
+        {
+            return !(*this == other);
+        }
+
+    private:
+        container_type m_data;
+        std::vector<bool> m_dead;
+        size_type m_dead_count = 0;
+        double m_max_dead_ratio = default_max_dead_ratio;
+
+        size_type next_live(size_type index) const noexcept
+        {
+            while ((index < m_data.size()) && m_dead[index]) {
+                ++index;
+            }
+            return index;
+        }
+
+        size_type raw_lower_bound(const key_type& key) const
+        {
+            return std::lower_bound(std::begin(m_data), std::end(m_data), key
+                , [](const value_type& lhs, const key_type& rhs) { return key_compare()(lhs.first, rhs); })
+                - std::begin(m_data);
+        }
+
+        size_type raw_upper_bound(const key_type& key) const
+        {
+            return std::upper_bound(std::begin(m_data), std::end(m_data), key
+                , [](const key_type& lhs, const value_type& rhs) { return key_compare()(lhs, rhs.first); })
+                - std::begin(m_data);
+        }
+
+        size_type raw_find(const key_type& key) const
+        {
+            size_type index = raw_lower_bound(key);
+            if ((index == m_data.size()) || m_dead[index] || key_compare()(key, m_data[index].first)) {
+                return m_data.size();
+            }
+            return index;
+        }
+
+        /**
+         * @brief Compacts the storage if the fraction of dead slots is too high.
+         *
+         * @param index Slot index which must be translated to the compacted storage.
+         * @return iterator An iterator to the element which was at @index.
+         */
+        iterator settle(size_type index)
+        {
+            if (static_cast<double>(m_dead_count) <= m_max_dead_ratio * static_cast<double>(m_data.size())) {
+                return { this, index };
+            }
+            return { this, compact_before(index) };
+        }
+
+        /**
+         * @brief Removes all dead slots, keeping the relative order of the live ones.
+         *
+         * @param index Slot index which must be translated to the compacted storage.
+         * @return size_type The new index of the slot which was at @index.
+         */
+        size_type compact_before(size_type index)
+        {
+            size_type out = 0;
+            size_type translated = 0;
+            for (size_type i = 0; i < m_data.size(); ++i) {
+                if (i == index) {
+                    translated = out;
+                }
+                if (!m_dead[i]) {
+                    if (out != i) {
+                        m_data[out] = std::move(m_data[i]);
+                    }
+                    ++out;
+                }
+            }
+            if (index >= m_data.size()) {
+                translated = out;
+            }
+            m_data.erase(std::begin(m_data) + out, std::end(m_data));
+            m_dead.assign(out, false);
+            m_dead_count = 0;
+            return translated;
+        }
+    };
+
+    template <typename K, typename V, typename C, typename A>
+    void swap(lazy_erase_flat_map<K, V, C, A>& lhs, lazy_erase_flat_map<K, V, C, A>& rhs) noexcept
+    {
+        lhs.swap(rhs);
+    }
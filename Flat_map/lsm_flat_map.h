@@ -0,0 +1,561 @@
+#pragma once
+
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#include "flat_map.h"
+
+namespace detail
+{
+    /**
+     * @brief An entry of a lsm_flat_map run, the value of a key or a tombstone hiding the key in older runs.
+     */
+    template <typename V>
+    struct lsm_slot
+    {
+        V value;
+        bool erased = false;
+    };
+}
+
+    /**
+     * @brief A log-structured flat_map. Writes go to a small mutable level which is flushed as an immutable sorted run
+     *        when it is full. Runs are kept in geometrically growing sizes and merged with the sorted merge of flat_map,
+     *        so a write costs amortized O(log N) moves instead of the O(N) shift of flat_map::emplace.
+     *        Lookups search the runs from the newest to the oldest one, ordered iteration is a k-way merge of the runs.
+     *
+     * @tparam K is the key_type of the map.
+     * @tparam V is the value_type of the map.
+     * @tparam std::less<K> the ordering function for Keys.
+     * @tparam std::allocator<std::pair<K, V>> the allocator to allocate the value_types.
+     */
+    template <typename K
+        , typename V
+        , typename Comp = std::less<K>
+        , typename Allocator = std::allocator<std::pair<K, V>>
+    >
+        struct lsm_flat_map
+    {
+        using key_type = K;
+        using mapped_type = V;
+        using value_type = std::pair<K, V>;
+        using key_compare = Comp;
+        using allocator_type = Allocator;
+        using size_type = std::size_t;
+        using slot_type = detail::lsm_slot<V>;
+        using run_type = flat_map<K, slot_type, Comp
+            , typename std::allocator_traits<Allocator>::template rebind_alloc<std::pair<K, slot_type>>>;
+
+        static constexpr size_type default_memtable_limit = 256;
+        static constexpr size_type default_growth_factor = 4;
+
+        /**
+         * @brief Forward iterator which visits the live elements of all runs in key order.
+         *        Any modification of the map invalidates all iterators.
+         */
+        struct const_iterator
+        {
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::pair<const K&, const V&>;
+            using difference_type = std::ptrdiff_t;
+            using reference = value_type;
+
+            struct pointer
+            {
+                value_type value;
+
+                const value_type* operator-> () const
+                {
+                    return &value;
+                }
+            };
+
+            const_iterator() = default;
+
+            [[nodiscard]] reference operator* () const
+            {
+                const auto& entry = *m_cursors[m_current].first;
+                return { entry.first, entry.second.value };
+            }
+
+            [[nodiscard]] pointer operator-> () const
+            {
+                return { **this };
+            }
+
+            const_iterator& operator++ ()
+            {
+                skip(m_cursors[m_current].first->first);
+                settle();
+                return *this;
+            }
+
+            const_iterator operator++ (int)
+            {
+                const_iterator result = *this;
+                ++*this;
+                return result;
+            }
+
+            bool operator== (const const_iterator& other) const
+            {
+                return m_cursors == other.m_cursors;
+            }
+
+            bool operator!= (const const_iterator& other) const
+            {
+                return !(*this == other);
+            }
+
+        private:
+            friend struct lsm_flat_map;
+            using cursor = std::pair<typename run_type::const_iterator, typename run_type::const_iterator>;
+
+            std::vector<cursor> m_cursors;
+            size_type m_current = 0;
+
+            /**
+             * @brief Advances every cursor which points to a key equivalent to @key.
+             */
+            void skip(const key_type& key)
+            {
+                key_compare comp;
+                for (auto& c : m_cursors) {
+                    if ((c.first != c.second) && !comp(key, c.first->first)) {
+                        ++c.first;
+                    }
+                }
+            }
+
+            /**
+             * @brief Positions the iterator on the smallest live key, the newest run wins between equivalent keys.
+             */
+            void settle()
+            {
+                key_compare comp;
+                for (;;) {
+                    m_current = m_cursors.size();
+                    for (size_type i = 0; i < m_cursors.size(); ++i) {
+                        const auto& c = m_cursors[i];
+                        if ((c.first != c.second) && ((m_current == m_cursors.size())
+                            || comp(c.first->first, m_cursors[m_current].first->first))) {
+                            m_current = i;
+                        }
+                    }
+                    if ((m_current == m_cursors.size()) || !m_cursors[m_current].first->second.erased) {
+                        return;
+                    }
+                    skip(m_cursors[m_current].first->first);
+                }
+            }
+        };
+
+        using iterator = const_iterator;
+
+        lsm_flat_map() = default;
+        ~lsm_flat_map() = default;
+        lsm_flat_map(lsm_flat_map&&) = default;
+        lsm_flat_map(const lsm_flat_map&) = default;
+        lsm_flat_map& operator=(lsm_flat_map&&) = default;
+        lsm_flat_map& operator=(const lsm_flat_map&) = default;
+
+        /**
+         * @brief Constructs an empty lsm_flat_map.
+         *
+         * @param memtable_limit Number of elements of the mutable level which triggers a flush.
+         * @param growth_factor Minimal size ratio between an older run and the next newer one.
+         */
+        explicit lsm_flat_map(size_type memtable_limit, size_type growth_factor = default_growth_factor)
+            : m_memtable_limit(std::max<size_type>(memtable_limit, 1))
+            , m_growth_factor(std::max<size_type>(growth_factor, 2))
+        {
+        }
+
+        /**
+         * @brief Constructs an empty lsm_flat_map and inserts elements from the range [begin ,end ).
+         *
+         * @param begin range of elements to insert.
+         * @param end range of elements to insert.
+         */
+        template <typename It, typename = typename std::iterator_traits<It>::iterator_category>
+        lsm_flat_map(It begin, It end)
+        {
+            insert(begin, end);
+        }
+
+        /**
+         * @brief Constructs an empty lsm_flat_map and inserts elements from the range [il.begin() ,il.end()).
+         *
+         * @param init An initializer_list.
+         */
+        lsm_flat_map(std::initializer_list<value_type> init)
+            : lsm_flat_map(std::begin(init), std::end(init))
+        {
+        }
+
+        /**
+         * @brief Returns a const_iterator to the smallest element contained in the container.
+         *
+         * @return const_iterator to the first element.
+         */
+        [[nodiscard]] const_iterator begin() const
+        {
+            const_iterator result = make_iterator([](const run_type& run) { return run.begin(); });
+            result.settle();
+            return result;
+        }
+
+        /**
+         * @brief Returns a const_iterator to the end of the container.
+         *
+         * @return const_iterator to the end of the container.
+         */
+        [[nodiscard]] const_iterator end() const
+        {
+            const_iterator result = make_iterator([](const run_type& run) { return run.end(); });
+            result.m_current = result.m_cursors.size();
+            return result;
+        }
+
+        /**
+         * @brief Checks the empyiness of the container
+         *
+         * @return true if the container contains no elemets, false otherwise.
+         */
+        [[nodiscard]] bool empty() const noexcept
+        {
+            return m_size == 0;
+        }
+
+        /**
+         * @brief  Returns the number of the live elements contained in the container.
+         *
+         * @return The number of the elements of container.
+         */
+        [[nodiscard]] size_type size() const noexcept
+        {
+            return m_size;
+        }
+
+        /**
+         * @brief Returns the number of immutable sorted runs, the mutable level is not counted.
+         *
+         * @return The number of runs.
+         */
+        [[nodiscard]] size_type run_count() const noexcept
+        {
+            return m_runs.size();
+        }
+
+        /**
+         * @brief Attempts to find the value of the element with key equivalent to @key, searching the newest runs first.
+         *
+         * @param key Key value of the element to search for.
+         * @return const mapped_type* A pointer to the value, or nullptr if such an element is not found.
+         */
+        [[nodiscard]] const mapped_type* get(const key_type& key) const
+        {
+            const slot_type* slot = find_slot(key);
+            return ((slot == nullptr) || slot->erased) ? nullptr : &slot->value;
+        }
+
+        /**
+         * @brief Checks if there is an element with key equivalent to @key in the container.
+         *
+         * @param key Key value of the element to search for.
+         * @return true if there is such an element, false otherwise.
+         */
+        [[nodiscard]] bool contains(const key_type& key) const
+        {
+            return get(key) != nullptr;
+        }
+
+        /**
+         * @brief Returns the number of elements with key equivalent to @key.
+         *
+         * @param key Key value of the element to count.
+         * @return 1 if the element is found, 0 otherwise.
+         */
+        [[nodiscard]] size_type count(const key_type& key) const
+        {
+            return contains(key) ? 1 : 0;
+        }
+
+        /**
+         * @brief Returns a reference to the element whose key is equivalent to @key.
+         *        Throws an exception object of type out_of_range if no such element is present.
+         *
+         * @param key The key of the element to find.
+         * @return const mapped_type& A const reference to the element whose key is equivalent to @key.
+         */
+        const mapped_type& at(const key_type& key) const
+        {
+            const mapped_type* found = get(key);
+            if (found == nullptr) {
+                detail::throw_out_of_range("key passed to 'at' doesn't exist in this map");
+            }
+            return *found;
+        }
+
+        /**
+         * @brief Finds the first element with key not less than @key, or end() if such an element is not found.
+         *
+         * @param key Key value to compare the elements to.
+         * @return const_iterator An const iterator pointing to the first element with key not less than k, or end() if such an element is not found.
+         */
+        [[nodiscard]] const_iterator lower_bound(const key_type& key) const
+        {
+            const_iterator result = make_iterator([&key](const run_type& run) { return run.lower_bound(key); });
+            result.settle();
+            return result;
+        }
+
+        /**
+         * @brief Attempts to find an element with key equivalent to @key.
+         *
+         * @param key Key value of the element to search for.
+         * @return const_iterator A const_iterator pointing to an element with the key equivalent to @key, or end() if such an element is not found.
+         */
+        [[nodiscard]] const_iterator find(const key_type& key) const
+        {
+            if (!contains(key)) {
+                return end();
+            }
+            return lower_bound(key);
+        }
+
+        /**
+         * @brief Inserts a new element if and only if there is no element in the container with key equivalent to the key of @value.
+         *
+         * @param value std::pair<Key,T> for insertion.
+         * @return true if the insertion took place, false otherwise.
+         */
+        bool insert(const value_type& value)
+        {
+            return emplace(value.first, value.second);
+        }
+
+        /**
+         * @brief Inserts a new element if and only if there is no element in the container with key equivalent to the key of @value.
+         *
+         * @param value std::pair<Key,T> for insertion.
+         * @return true if the insertion took place, false otherwise.
+         */
+        bool insert(value_type&& value)
+        {
+            return emplace(std::move(value.first), std::move(value.second));
+        }
+
+        /**
+         * @brief Inserts each element from the range [first,last) if and only if there is no element with key equivalent to the key of that element.
+         *
+         * @param begin range of elements to insert.
+         * @param end range of elements to insert.
+         */
+        template <typename It>
+        void insert(It begin, It end)
+        {
+            for (; begin != end; ++begin) {
+                insert(*begin);
+            }
+        }
+
+        /**
+         * @brief Inserts a value constructed from @args with the key @key if and only if there is no element in the container with key equivalent to @key.
+         *
+         * @param key The key of the element to insert.
+         * @param args Arguments to construct the value from.
+         * @return true if the insertion took place, false otherwise.
+         */
+        template <typename Key, typename ... Args>
+        bool emplace(Key&& key, Args&& ... args)
+        {
+            if (contains(key)) {
+                return false;
+            }
+            write(std::forward<Key>(key), slot_type{ V(std::forward<Args>(args) ...), false });
+            ++m_size;
+            return true;
+        }
+
+        /**
+         * @brief Inserts @value with the key @key, or replaces the value of the existing element with key equivalent to @key.
+         *
+         * @param key The key of the element to insert or assign.
+         * @param value The value to write.
+         * @return true if the insertion took place, false if the assignment took place.
+         */
+        template <typename Key, typename Value>
+        bool insert_or_assign(Key&& key, Value&& value)
+        {
+            bool inserted = !contains(key);
+            write(std::forward<Key>(key), slot_type{ V(std::forward<Value>(value)), false });
+            if (inserted) {
+                ++m_size;
+            }
+            return inserted;
+        }
+
+        /**
+         * @brief Erases element in the container with key equivalent to @key by writing a tombstone for it.
+         *
+         * @param key Key value of the element to remove.
+         * @return  0 if @key not found in container, 1 otherwise.
+         */
+        size_type erase(const key_type& key)
+        {
+            if (!contains(key)) {
+                return 0;
+            }
+            if (m_runs.empty()) {
+                m_memtable.erase(key);
+            }
+            else {
+                write(key, slot_type{ V(), true });
+            }
+            --m_size;
+            return 1;
+        }
+
+        /**
+         * @brief Erases all elements in container.
+         *
+         */
+        void clear()
+        {
+            m_memtable.clear();
+            m_runs.clear();
+            m_size = 0;
+        }
+
+        /**
+         * @brief Swaps the contents of *this and other.
+         *
+         * @param other lsm_flat_map with which must be swapped.
+         */
+        void swap(lsm_flat_map& other) noexcept
+        {
+            m_memtable.swap(other.m_memtable);
+            m_runs.swap(other.m_runs);
+            std::swap(m_size, other.m_size);
+            std::swap(m_memtable_limit, other.m_memtable_limit);
+            std::swap(m_growth_factor, other.m_growth_factor);
+        }
+
+        /**
+         * @brief Flushes the mutable level and merges all runs into a single one without tombstones.
+         *
+         */
+        void compact()
+        {
+            flush();
+            while (m_runs.size() > 1) {
+                merge_newest();
+            }
+        }
+
+        /**
+         * @brief Returns the comparison object out of which a was constructed.
+         *
+         * @return key_compare The comparison object
+         */
+        key_compare key_comp() const
+        {
+            return key_compare();
+        }
+
+    private:
+        run_type m_memtable;
+        std::vector<run_type> m_runs;
+        size_type m_size = 0;
+        size_type m_memtable_limit = default_memtable_limit;
+        size_type m_growth_factor = default_growth_factor;
+
+        template <typename F>
+        const_iterator make_iterator(F position) const
+        {
+            const_iterator result;
+            result.m_cursors.reserve(m_runs.size() + 1);
+            result.m_cursors.emplace_back(position(m_memtable), m_memtable.end());
+            for (const auto& run : m_runs) {
+                result.m_cursors.emplace_back(position(run), run.end());
+            }
+            return result;
+        }
+
+        const slot_type* find_slot(const key_type& key) const
+        {
+            auto found = m_memtable.find(key);
+            if (found != m_memtable.end()) {
+                return &found->second;
+            }
+            for (const auto& run : m_runs) {
+                auto in_run = run.find(key);
+                if (in_run != run.end()) {
+                    return &in_run->second;
+                }
+            }
+            return nullptr;
+        }
+
+        template <typename Key>
+        void write(Key&& key, slot_type&& slot)
+        {
+            auto found = m_memtable.find(key);
+            if (found != m_memtable.end()) {
+                found->second = std::move(slot);
+                return;
+            }
+            m_memtable.emplace(std::forward<Key>(key), std::move(slot));
+            if (m_memtable.size() >= m_memtable_limit) {
+                flush();
+            }
+        }
+
+        /**
+         * @brief Turns the mutable level into the newest run and restores the geometric growth of the run sizes.
+         */
+        void flush()
+        {
+            if (m_memtable.empty()) {
+                return;
+            }
+            m_runs.insert(std::begin(m_runs), std::move(m_memtable));
+            m_memtable = run_type();
+            while ((m_runs.size() > 1) && (m_runs[1].size() < m_runs[0].size() * m_growth_factor)) {
+                merge_newest();
+            }
+            if (m_runs.size() == 1) {
+                drop_tombstones(m_runs.front());
+            }
+        }
+
+        /**
+         * @brief Merges the newest run into the next older one, the entries of the newest run win.
+         */
+        void merge_newest()
+        {
+            run_type merged = std::move(m_runs[0]);
+            const run_type& older = m_runs[1];
+            merged.reserve(merged.size() + older.size());
+            merged.insert(sorted_unique, older.begin(), older.end());
+            m_runs.erase(std::begin(m_runs));
+            m_runs[0] = std::move(merged);
+            if (m_runs.size() == 1) {
+                drop_tombstones(m_runs[0]);
+            }
+        }
+
+        static void drop_tombstones(run_type& run)
+        {
+            run.erase(std::remove_if(run.begin(), run.end()
+                , [](const auto& entry) { return entry.second.erased; }), run.cend());
+        }
+    };
+
+    template <typename K, typename V, typename C, typename A>
+    void swap(lsm_flat_map<K, V, C, A>& lhs, lsm_flat_map<K, V, C, A>& rhs) noexcept
+    {
+        lhs.swap(rhs);
+    }
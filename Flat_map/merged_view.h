@@ -0,0 +1,275 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "flat_map.h"
+
+    /**
+     * @brief What a merged_view yields when several maps contain equivalent keys.
+     */
+    enum class merge_policy
+    {
+        all,        ///< every element, the ones of the lower map index first
+        first_wins, ///< only the element of the lowest map index
+        last_wins   ///< only the element of the highest map index
+    };
+
+    /**
+     * @brief A lazy view iterating the elements of N sorted maps in key order without materializing them. The iterator keeps one
+     *        cursor per map and a loser tree over the cursors, so advancing costs log(N) comparisons.
+     *        The maps must outlive the view and its iterators, and must not be modified while they are used.
+     *
+     * @tparam Map the type of the merged maps, such as flat_map, with const_iterator, key_compare, begin(), end() and lower_bound().
+     */
+    template <typename Map>
+    struct merged_view
+    {
+        using map_type = Map;
+        using key_type = typename Map::key_type;
+        using value_type = typename Map::value_type;
+        using key_compare = typename Map::key_compare;
+        using size_type = std::size_t;
+
+        /**
+         * @brief A forward iterator over the merged elements, holding one cursor per map and the loser tree over them.
+         */
+        struct const_iterator
+        {
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = typename merged_view::value_type;
+            using difference_type = std::ptrdiff_t;
+            using reference = const value_type&;
+            using pointer = const value_type*;
+
+            const_iterator() = default;
+
+            [[nodiscard]] reference operator* () const
+            {
+                return *m_cursors[m_tree[0]];
+            }
+
+            [[nodiscard]] pointer operator-> () const
+            {
+                return &**this;
+            }
+
+            /**
+             * @brief Returns the index of the map holding the current element.
+             */
+            [[nodiscard]] size_type source() const
+            {
+                return m_tree[0];
+            }
+
+            const_iterator& operator++ ()
+            {
+                size_type winner = m_tree[0];
+                if (m_view->m_policy == merge_policy::all) {
+                    advance(winner);
+                    return *this;
+                }
+                const key_type& key = m_cursors[winner]->first;
+                do {
+                    advance(m_tree[0]);
+                } while (!exhausted(m_tree[0]) && !key_compare()(key, m_cursors[m_tree[0]]->first));
+                return *this;
+            }
+
+            const_iterator operator++ (int)
+            {
+                const_iterator result = *this;
+                ++*this;
+                return result;
+            }
+
+            bool operator== (const const_iterator& other) const
+            {
+                return m_cursors == other.m_cursors;
+            }
+
+            bool operator!= (const const_iterator& other) const
+            {
+                return !(*this == other);
+            }
+
+        private:
+            friend struct merged_view;
+
+            using cursor_type = typename Map::const_iterator;
+
+            const merged_view* m_view = nullptr;
+            std::vector<cursor_type> m_cursors;
+            std::vector<size_type> m_tree;
+
+            const_iterator(const merged_view* view, std::vector<cursor_type> cursors)
+                : m_view(view)
+                , m_cursors(std::move(cursors))
+                , m_tree(std::max<size_type>(m_cursors.size(), 1))
+            {
+                if (m_cursors.empty()) {
+                    return;
+                }
+                m_tree[0] = (m_cursors.size() == 1) ? 0 : build(1);
+            }
+
+            bool exhausted(size_type source) const
+            {
+                return m_cursors[source] == m_view->m_maps[source]->end();
+            }
+
+            /**
+             * @brief Checks whether the current element of @lhs comes before the current element of @rhs. Exhausted cursors come last,
+             *        and equivalent keys are ordered by map index, descending for last_wins.
+             */
+            bool before(size_type lhs, size_type rhs) const
+            {
+                if (exhausted(lhs) || exhausted(rhs)) {
+                    return !exhausted(lhs) || (exhausted(rhs) && lhs < rhs);
+                }
+                key_compare comp;
+                if (comp(m_cursors[lhs]->first, m_cursors[rhs]->first)) {
+                    return true;
+                }
+                if (comp(m_cursors[rhs]->first, m_cursors[lhs]->first)) {
+                    return false;
+                }
+                return (m_view->m_policy == merge_policy::last_wins) ? (rhs < lhs) : (lhs < rhs);
+            }
+
+            /**
+             * @brief Plays the matches of the subtree of @node, storing the losers in the nodes, and returns its winner.
+             *        Nodes 1 to N-1 are internal, nodes N to 2N-1 are the leaves of the maps.
+             */
+            size_type build(size_type node)
+            {
+                size_type leaves = m_cursors.size();
+                if (node >= leaves) {
+                    return node - leaves;
+                }
+                size_type left = build(2 * node);
+                size_type right = build(2 * node + 1);
+                if (before(left, right)) {
+                    m_tree[node] = right;
+                    return left;
+                }
+                m_tree[node] = left;
+                return right;
+            }
+
+            /**
+             * @brief Advances the cursor of @source, which must be the winner, and replays its path to the root.
+             */
+            void advance(size_type source)
+            {
+                ++m_cursors[source];
+                size_type winner = source;
+                for (size_type node = (source + m_cursors.size()) / 2; node >= 1; node /= 2) {
+                    if (before(m_tree[node], winner)) {
+                        std::swap(m_tree[node], winner);
+                    }
+                }
+                m_tree[0] = winner;
+            }
+        };
+
+        using iterator = const_iterator;
+
+        /**
+         * @brief Constructs a view merging @maps.
+         *
+         * @param maps The maps to merge.
+         * @param policy What to yield for equivalent keys in several maps.
+         */
+        explicit merged_view(std::vector<const Map*> maps, merge_policy policy = merge_policy::all)
+            : m_maps(std::move(maps))
+            , m_policy(policy)
+        {
+        }
+
+        /**
+         * @brief Constructs a view merging @maps.
+         *
+         * @param maps The maps to merge.
+         * @param policy What to yield for equivalent keys in several maps.
+         */
+        merged_view(std::initializer_list<const Map*> maps, merge_policy policy = merge_policy::all)
+            : merged_view(std::vector<const Map*>(maps), policy)
+        {
+        }
+
+        /**
+         * @brief Returns an iterator to the smallest element of the merged maps.
+         *
+         * @return const_iterator to the first element.
+         */
+        [[nodiscard]] const_iterator begin() const
+        {
+            std::vector<typename Map::const_iterator> cursors;
+            cursors.reserve(m_maps.size());
+            for (const Map* map : m_maps) {
+                cursors.push_back(map->begin());
+            }
+            return const_iterator(this, std::move(cursors));
+        }
+
+        /**
+         * @brief Returns an iterator past the largest element of the merged maps.
+         *
+         * @return const_iterator to the end of the view.
+         */
+        [[nodiscard]] const_iterator end() const
+        {
+            std::vector<typename Map::const_iterator> cursors;
+            cursors.reserve(m_maps.size());
+            for (const Map* map : m_maps) {
+                cursors.push_back(map->end());
+            }
+            return const_iterator(this, std::move(cursors));
+        }
+
+        /**
+         * @brief Finds the first element with key not less than @key by repositioning the cursor of every map with its lower_bound.
+         *
+         * @param key Key value to compare the elements to.
+         * @return const_iterator An iterator pointing to the first element with key not less than @key, or end().
+         */
+        template <typename T>
+        [[nodiscard]] const_iterator lower_bound(const T& key) const
+        {
+            std::vector<typename Map::const_iterator> cursors;
+            cursors.reserve(m_maps.size());
+            for (const Map* map : m_maps) {
+                cursors.push_back(map->lower_bound(key));
+            }
+            return const_iterator(this, std::move(cursors));
+        }
+
+        /**
+         * @brief Returns the number of merged maps.
+         *
+         * @return size_type The number of maps.
+         */
+        [[nodiscard]] size_type map_count() const noexcept
+        {
+            return m_maps.size();
+        }
+
+        /**
+         * @brief Returns the policy for equivalent keys in several maps.
+         *
+         * @return merge_policy The policy.
+         */
+        [[nodiscard]] merge_policy policy() const noexcept
+        {
+            return m_policy;
+        }
+
+    private:
+        std::vector<const Map*> m_maps;
+        merge_policy m_policy;
+    };
@@ -0,0 +1,342 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "flat_map.h"
+
+namespace detail
+{
+    /**
+     * @brief One version of the value of a mvcc_flat_map key, or a tombstone if the key was erased at that time.
+     */
+    template <typename V>
+    struct mvcc_version
+    {
+        std::uint64_t timestamp;
+        bool erased;
+        V value;
+    };
+}
+
+    /**
+     * @brief A multi-version flat_map which keeps the history of every key for time-travel reads.
+     *        Each write gets a new timestamp and appends a version to the contiguous version chain of its key, so
+     *        find(key, as_of) is a binary search for the key followed by a binary search in its chain.
+     *        Versions which are not visible to any active snapshot are removed by collect_garbage() in a single pass.
+     *
+     * @tparam K is the key_type of the map.
+     * @tparam V is the value_type of the map.
+     * @tparam std::less<K> the ordering function for Keys.
+     * @tparam std::allocator<std::pair<K, V>> the allocator to allocate the value_types.
+     */
+    template <typename K
+        , typename V
+        , typename Comp = std::less<K>
+        , typename Allocator = std::allocator<std::pair<K, V>>
+    >
+        struct mvcc_flat_map
+    {
+        using key_type = K;
+        using mapped_type = V;
+        using key_compare = Comp;
+        using allocator_type = Allocator;
+        using timestamp_type = std::uint64_t;
+        using version_type = detail::mvcc_version<V>;
+        using chain_type = std::vector<version_type
+            , typename std::allocator_traits<Allocator>::template rebind_alloc<version_type>>;
+        using map_type = flat_map<K, chain_type, Comp
+            , typename std::allocator_traits<Allocator>::template rebind_alloc<std::pair<K, chain_type>>>;
+        using size_type = typename map_type::size_type;
+
+        /**
+         * @brief A registered reader of the map. The versions it can see are kept by collect_garbage() until it is released.
+         *        The map must outlive its snapshots.
+         */
+        struct snapshot
+        {
+            snapshot() = default;
+
+            snapshot(snapshot&& other) noexcept
+                : m_owner(other.m_owner)
+                , m_timestamp(other.m_timestamp)
+            {
+                other.m_owner = nullptr;
+            }
+
+            snapshot& operator=(snapshot&& other) noexcept
+            {
+                if (this != &other) {
+                    release();
+                    m_owner = other.m_owner;
+                    m_timestamp = other.m_timestamp;
+                    other.m_owner = nullptr;
+                }
+                return *this;
+            }
+
+            snapshot(const snapshot&) = delete;
+            snapshot& operator=(const snapshot&) = delete;
+
+            ~snapshot()
+            {
+                release();
+            }
+
+            /**
+             * @brief Returns the timestamp the snapshot reads the map as of.
+             */
+            [[nodiscard]] timestamp_type timestamp() const noexcept
+            {
+                return m_timestamp;
+            }
+
+            /**
+             * @brief Unregisters the snapshot from its map.
+             */
+            void release() noexcept
+            {
+                if (m_owner != nullptr) {
+                    m_owner->m_readers.erase(m_owner->m_readers.find(m_timestamp));
+                    m_owner = nullptr;
+                }
+            }
+
+        private:
+            friend struct mvcc_flat_map;
+
+            snapshot(mvcc_flat_map* owner, timestamp_type timestamp)
+                : m_owner(owner)
+                , m_timestamp(timestamp)
+            {
+            }
+
+            mvcc_flat_map* m_owner = nullptr;
+            timestamp_type m_timestamp = 0;
+        };
+
+        mvcc_flat_map() = default;
+        ~mvcc_flat_map() = default;
+        mvcc_flat_map(mvcc_flat_map&&) = delete;
+        mvcc_flat_map(const mvcc_flat_map&) = delete;
+        mvcc_flat_map& operator=(mvcc_flat_map&&) = delete;
+        mvcc_flat_map& operator=(const mvcc_flat_map&) = delete;
+
+        /**
+         * @brief Returns the timestamp of the last write, reads as of this timestamp see the current state of the map.
+         *
+         * @return timestamp_type The current timestamp.
+         */
+        [[nodiscard]] timestamp_type now() const noexcept
+        {
+            return m_clock;
+        }
+
+        /**
+         * @brief Registers a reader of the current state of the map.
+         *
+         * @return snapshot A handle which keeps the versions it sees alive until it is released.
+         */
+        [[nodiscard]] snapshot acquire_snapshot()
+        {
+            m_readers.insert(m_clock);
+            return snapshot(this, m_clock);
+        }
+
+        /**
+         * @brief Returns the timestamp of the oldest active snapshot, or now() if there is none.
+         *
+         * @return timestamp_type The oldest timestamp which may still be read.
+         */
+        [[nodiscard]] timestamp_type oldest_active() const noexcept
+        {
+            return m_readers.empty() ? m_clock : *m_readers.begin();
+        }
+
+        /**
+         * @brief Returns the number of keys which have at least one stored version.
+         *
+         * @return size_type The number of version chains.
+         */
+        [[nodiscard]] size_type key_count() const noexcept
+        {
+            return m_chains.size();
+        }
+
+        /**
+         * @brief Returns the number of stored versions, including tombstones.
+         *
+         * @return size_type The number of versions.
+         */
+        [[nodiscard]] size_type version_count() const noexcept
+        {
+            size_type result = 0;
+            for (const auto& chain : m_chains) {
+                result += chain.second.size();
+            }
+            return result;
+        }
+
+        /**
+         * @brief Writes a new version of the value of @key. The version is built before the chain of @key is looked up,
+         *        and a chain created for it is removed again if appending the version throws, so a failed write leaves no trace.
+         *
+         * @param key The key of the element to write.
+         * @param value The new value.
+         * @return timestamp_type The timestamp of the write.
+         */
+        template <typename Key, typename Value>
+        timestamp_type put(Key&& key, Value&& value)
+        {
+            version_type version{ m_clock + 1, false, V(std::forward<Value>(value)) };
+            auto chain = m_chains.emplace(std::forward<Key>(key), chain_type()).first;
+            try
+            {
+                chain->second.push_back(std::move(version));
+            }
+            catch (...)
+            {
+                if (chain->second.empty()) {
+                    m_chains.erase(chain);
+                }
+                throw;
+            }
+            return ++m_clock;
+        }
+
+        /**
+         * @brief Writes a tombstone for @key if the key is currently visible.
+         *
+         * @param key Key value of the element to remove.
+         * @return  0 if @key not found in container, 1 otherwise.
+         */
+        size_type erase(const key_type& key)
+        {
+            auto found = m_chains.find(key);
+            if ((found == m_chains.end()) || found->second.empty() || found->second.back().erased) {
+                return 0;
+            }
+            found->second.push_back(version_type{ ++m_clock, true, V() });
+            return 1;
+        }
+
+        /**
+         * @brief Returns the value of @key as of the timestamp @as_of.
+         *
+         * @param key Key value of the element to search for.
+         * @param as_of The timestamp to read at.
+         * @return const mapped_type* A pointer to the value, or nullptr if the key was not visible at @as_of.
+         *         The pointer is invalidated by the next write to the map.
+         */
+        [[nodiscard]] const mapped_type* find(const key_type& key, timestamp_type as_of) const
+        {
+            auto found = m_chains.find(key);
+            if (found == m_chains.end()) {
+                return nullptr;
+            }
+            const version_type* visible = visible_version(found->second, as_of);
+            return ((visible == nullptr) || visible->erased) ? nullptr : &visible->value;
+        }
+
+        /**
+         * @brief Returns the current value of @key.
+         *
+         * @param key Key value of the element to search for.
+         * @return const mapped_type* A pointer to the value, or nullptr if the key is not visible.
+         */
+        [[nodiscard]] const mapped_type* find(const key_type& key) const
+        {
+            return find(key, m_clock);
+        }
+
+        /**
+         * @brief Returns the value of @key as seen by @reader.
+         *
+         * @param key Key value of the element to search for.
+         * @param reader The snapshot to read with.
+         * @return const mapped_type* A pointer to the value, or nullptr if the key was not visible.
+         */
+        [[nodiscard]] const mapped_type* find(const key_type& key, const snapshot& reader) const
+        {
+            return find(key, reader.timestamp());
+        }
+
+        /**
+         * @brief Calls @fn(key, value) for every key visible at @as_of, in key order.
+         *
+         * @param as_of The timestamp to read at.
+         * @param fn The function to call.
+         */
+        template <typename F>
+        void for_each(timestamp_type as_of, F fn) const
+        {
+            for (const auto& chain : m_chains) {
+                const version_type* visible = visible_version(chain.second, as_of);
+                if ((visible != nullptr) && !visible->erased) {
+                    fn(chain.first, visible->value);
+                }
+            }
+        }
+
+        /**
+         * @brief Removes, in a single pass over all version chains, every version which is hidden by a newer version
+         *        for all timestamps from oldest_active() on, and the keys which are left with a tombstone only.
+         *
+         * @return size_type The number of removed versions.
+         */
+        size_type collect_garbage()
+        {
+            timestamp_type horizon = oldest_active();
+            size_type removed = 0;
+            for (auto& chain : m_chains) {
+                chain_type& versions = chain.second;
+                auto upper = std::upper_bound(std::begin(versions), std::end(versions), horizon
+                    , [](timestamp_type lhs, const version_type& rhs) { return lhs < rhs.timestamp; });
+                if (upper == std::begin(versions)) {
+                    continue;
+                }
+                auto keep = upper - 1;
+                if (keep->erased) {
+                    ++keep;
+                }
+                removed += keep - std::begin(versions);
+                versions.erase(std::begin(versions), keep);
+            }
+            m_chains.erase(std::remove_if(m_chains.begin(), m_chains.end()
+                , [](const auto& chain) { return chain.second.empty(); }), m_chains.cend());
+            return removed;
+        }
+
+        /**
+         * @brief Erases all keys and versions. The clock keeps running.
+         *
+         */
+        void clear()
+        {
+            m_chains.clear();
+        }
+
+        /**
+         * @brief Returns the comparison object out of which a was constructed.
+         *
+         * @return key_compare The comparison object
+         */
+        key_compare key_comp() const
+        {
+            return key_compare();
+        }
+
+    private:
+        map_type m_chains;
+        std::multiset<timestamp_type> m_readers;
+        timestamp_type m_clock = 0;
+
+        static const version_type* visible_version(const chain_type& versions, timestamp_type as_of)
+        {
+            auto upper = std::upper_bound(std::begin(versions), std::end(versions), as_of
+                , [](timestamp_type lhs, const version_type& rhs) { return lhs < rhs.timestamp; });
+            return (upper == std::begin(versions)) ? nullptr : &*(upper - 1);
+        }
+    };
@@ -0,0 +1,1053 @@
+#pragma once
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "flat_map.h"
+
+    /**
+     * @brief A flat_map which stores its elements as a sorted sequence of sorted blocks of about PageSize bytes,
+     *        with a top-level index of the minimal key of every block. Insertion and erasure shift the elements
+     *        of one block only, and split or merge blocks when they become full or nearly empty.
+     *        Lookups binary search the index of block minimums and then one block.
+     *
+     * @tparam K is the key_type of the map.
+     * @tparam V is the value_type of the map.
+     * @tparam std::less<K> the ordering function for Keys.
+     * @tparam std::allocator<std::pair<K, V>> the allocator to allocate the value_types.
+     * @tparam PageSize the approximate size of a block in bytes.
+     */
+    template <typename K
+        , typename V
+        , typename Comp = std::less<K>
+        , typename Allocator = std::allocator<std::pair<K, V>>
+        , std::size_t PageSize = 4096
+    >
+        struct paged_flat_map
+    {
+        using key_type = K;
+        using mapped_type = V;
+        using value_type = std::pair<K, V>;
+        using key_compare = Comp;
+        using allocator_type = Allocator;
+        using block_type = std::vector<value_type, allocator_type>;
+        using difference_type = typename block_type::difference_type;
+        using size_type = typename block_type::size_type;
+
+        static constexpr size_type block_capacity = std::max<size_type>(PageSize / sizeof(value_type), 4);
+
+    private:
+        template <bool Const>
+        struct basic_iterator
+        {
+            using owner_type = std::conditional_t<Const, const paged_flat_map, paged_flat_map>;
+            using iterator_category = std::bidirectional_iterator_tag;
+            using value_type = typename paged_flat_map::value_type;
+            using difference_type = typename paged_flat_map::difference_type;
+            using reference = std::conditional_t<Const, const value_type&, value_type&>;
+            using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+
+            basic_iterator() = default;
+
+            basic_iterator(owner_type* owner, size_type block, size_type offset)
+                : m_owner(owner)
+                , m_block(block)
+                , m_offset(offset)
+            {
+            }
+
+            template <bool C = Const, typename = std::enable_if_t<C>>
+            basic_iterator(const basic_iterator<false>& other)
+                : m_owner(other.m_owner)
+                , m_block(other.m_block)
+                , m_offset(other.m_offset)
+            {
+            }
+
+            [[nodiscard]] reference operator* () const
+            {
+                return m_owner->m_blocks[m_block][m_offset];
+            }
+
+            [[nodiscard]] pointer operator-> () const
+            {
+                return &m_owner->m_blocks[m_block][m_offset];
+            }
+
+            basic_iterator& operator++ ()
+            {
+                if (++m_offset == m_owner->m_blocks[m_block].size()) {
+                    ++m_block;
+                    m_offset = 0;
+                }
+                return *this;
+            }
+
+            basic_iterator operator++ (int)
+            {
+                basic_iterator result = *this;
+                ++*this;
+                return result;
+            }
+
+            basic_iterator& operator-- ()
+            {
+                if (m_offset == 0) {
+                    m_offset = m_owner->m_blocks[--m_block].size();
+                }
+                --m_offset;
+                return *this;
+            }
+
+            basic_iterator operator-- (int)
+            {
+                basic_iterator result = *this;
+                --*this;
+                return result;
+            }
+
+            /**
+             * @brief Advances the iterator by @n elements, skipping whole blocks at a time.
+             */
+            basic_iterator& operator+= (difference_type n)
+            {
+                if (n < 0) {
+                    return *this -= -n;
+                }
+                size_type rest = static_cast<size_type>(n) + m_offset;
+                while ((m_block < m_owner->m_blocks.size()) && (rest >= m_owner->m_blocks[m_block].size())) {
+                    rest -= m_owner->m_blocks[m_block].size();
+                    ++m_block;
+                }
+                m_offset = rest;
+                return *this;
+            }
+
+            /**
+             * @brief Moves the iterator back by @n elements, skipping whole blocks at a time.
+             */
+            basic_iterator& operator-= (difference_type n)
+            {
+                if (n < 0) {
+                    return *this += -n;
+                }
+                size_type rest = static_cast<size_type>(n);
+                while (rest > m_offset) {
+                    rest -= m_offset;
+                    m_offset = m_owner->m_blocks[--m_block].size();
+                }
+                m_offset -= rest;
+                if ((m_block < m_owner->m_blocks.size()) && (m_offset == m_owner->m_blocks[m_block].size())) {
+                    ++m_block;
+                    m_offset = 0;
+                }
+                return *this;
+            }
+
+            [[nodiscard]] basic_iterator operator+ (difference_type n) const
+            {
+                basic_iterator result = *this;
+                return result += n;
+            }
+
+            [[nodiscard]] basic_iterator operator- (difference_type n) const
+            {
+                basic_iterator result = *this;
+                return result -= n;
+            }
+
+            [[nodiscard]] difference_type operator- (const basic_iterator& other) const
+            {
+                return static_cast<difference_type>(m_owner->position_of(m_block, m_offset))
+                    - static_cast<difference_type>(m_owner->position_of(other.m_block, other.m_offset));
+            }
+
+            bool operator== (const basic_iterator& other) const
+            {
+                return (m_block == other.m_block) && (m_offset == other.m_offset);
+            }
+
+            bool operator!= (const basic_iterator& other) const
+            {
+                return !(*this == other);
+            }
+
+        private:
+            friend struct paged_flat_map;
+            friend struct basic_iterator<true>;
+
+            owner_type* m_owner = nullptr;
+            size_type m_block = 0;
+            size_type m_offset = 0;
+        };
+
+    public:
+        using iterator = basic_iterator<false>;
+        using const_iterator = basic_iterator<true>;
+        using reverse_iterator = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+        paged_flat_map() = default;
+        ~paged_flat_map() = default;
+        paged_flat_map(paged_flat_map&&) = default;
+        paged_flat_map(const paged_flat_map&) = default;
+        paged_flat_map& operator=(paged_flat_map&&) = default;
+        paged_flat_map& operator=(const paged_flat_map&) = default;
+
+        /**
+         * @brief Constructs an empty paged_flat_map whose blocks allocate their elements with @allocator.
+         *
+         * @param allocator The allocator of the blocks.
+         */
+        explicit paged_flat_map(const allocator_type& allocator)
+            : m_allocator(allocator)
+        {
+        }
+
+        /**
+         * @brief Constructs an empty paged_flat_map and inserts elements from the range [begin ,end ).
+         *
+         * @param begin range of elements to insert.
+         * @param end range of elements to insert.
+         */
+        template <typename It>
+        paged_flat_map(It begin, It end)
+        {
+            insert(begin, end);
+        }
+
+        /**
+         * @brief Constructs an empty paged_flat_map and inserts elements from the range [il.begin() ,il.end()).
+         *
+         * @param init An initializer_list.
+         */
+        paged_flat_map(std::initializer_list<value_type> init)
+            : paged_flat_map(std::begin(init), std::end(init))
+        {
+        }
+
+        /**
+         * @brief Returns an iterator to the first element contained in the container.
+         *
+         * @return An iterator to the first element.
+         */
+        [[nodiscard]] iterator begin() noexcept
+        {
+            return { this, 0, 0 };
+        }
+
+        /**
+         * @brief Returns an iterator to the end of the container.
+         *
+         * @return An iterator to the end of the container.
+         */
+        [[nodiscard]] iterator end() noexcept
+        {
+            return { this, m_blocks.size(), 0 };
+        }
+
+        /**
+         * @brief Returns a const_iterator to the first element contained in the container.
+         *
+         * @return const_iterator to the first element.
+         */
+        [[nodiscard]] const_iterator begin() const noexcept
+        {
+            return { this, 0, 0 };
+        }
+
+        /**
+         * @brief Returns a const_iterator to the end of the container.
+         *
+         * @return const_iterator to the end of the container.
+         */
+        [[nodiscard]] const_iterator end() const noexcept
+        {
+            return { this, m_blocks.size(), 0 };
+        }
+
+        /**
+         * @brief Returns a const_iterator to the first element contained in the container.
+         *
+         * @return const_iterator to the first element.
+         */
+        [[nodiscard]] const_iterator cbegin() const noexcept
+        {
+            return begin();
+        }
+
+        /**
+         * @brief Returns a const_iterator to the end of the container.
+         *
+         * @return const_iterator to the end of the container.
+         */
+        [[nodiscard]] const_iterator cend() const noexcept
+        {
+            return end();
+        }
+
+        /**
+         * @brief Returns a reverse_iterator pointing to the beginning of the reversed container.
+         *
+         * @return reverse_iterator to the beginning of the reversed container.
+         */
+        [[nodiscard]] reverse_iterator rbegin() noexcept
+        {
+            return reverse_iterator(end());
+        }
+
+        /**
+         * @brief  Returns a reverse_iterator pointing to the end of the reversed container.
+         *
+         * @return reverse_iterator to the end of the reversed container.
+         */
+        [[nodiscard]] reverse_iterator rend() noexcept
+        {
+            return reverse_iterator(begin());
+        }
+
+        /**
+         * @brief Returns a const_reverse_iterator pointing to the beginning of the reversed container.
+         *
+         * @return const_reverse_iterator to the beginning of the reversed container.
+         */
+        [[nodiscard]] const_reverse_iterator rbegin() const noexcept
+        {
+            return const_reverse_iterator(end());
+        }
+
+        /**
+         * @brief Returns a const_reverse_iterator pointing to the end of the reversed container.
+         *
+         * @return const_reverse_iterator to the end of the reversed container.
+         */
+        [[nodiscard]] const_reverse_iterator rend() const noexcept
+        {
+            return const_reverse_iterator(begin());
+        }
+
+        /**
+         * @brief Returns a const_reverse_iterator pointing to the beginning of the reversed container.
+         *
+         * @return const_reverse_iterator to the beginning of the reversed container.
+         */
+        [[nodiscard]] const_reverse_iterator crbegin() const noexcept
+        {
+            return rbegin();
+        }
+
+        /**
+         * @brief Returns a const_reverse_iterator pointing to the end of the reversed container.
+         *
+         * @return const_reverse_iterator to the end of the reversed container.
+         */
+        [[nodiscard]] const_reverse_iterator crend() const noexcept
+        {
+            return rend();
+        }
+
+        /**
+         * @brief Checks the empyiness of the container
+         *
+         * @return true if the container contains no elemets, false otherwise.
+         */
+        [[nodiscard]] bool empty() const noexcept
+        {
+            return m_size == 0;
+        }
+
+        /**
+         * @brief  Returns the number of the elements contained in the container.
+         *
+         * @return The number of the elements of container.
+         */
+        [[nodiscard]] size_type size() const noexcept
+        {
+            return m_size;
+        }
+
+        /**
+         * @brief Returns the largest possible size of the container.
+         *
+         * @return The largest possible size.
+         */
+        [[nodiscard]] size_type max_size() const noexcept
+        {
+            size_type blocks = std::min(m_blocks.max_size(), std::numeric_limits<size_type>::max() / block_capacity);
+            return std::min(blocks * block_capacity, static_cast<size_type>(std::numeric_limits<difference_type>::max()));
+        }
+
+        /**
+         * @brief Reserves the block index for @size elements. Blocks are split in halves when they are full, so the index is
+         *        reserved for blocks filled to half of their capacity; the blocks themselves allocate their capacity when created.
+         *
+         * @param size Requested number of elements.
+         */
+        void reserve(size_type size)
+        {
+            size_type half = block_capacity / 2;
+            size_type blocks = (size + half - 1) / half;
+            m_blocks.reserve(blocks);
+            m_index.reserve(blocks);
+        }
+
+        /**
+         * @brief  Returns the number of the blocks the elements are stored in.
+         *
+         * @return The number of the blocks.
+         */
+        [[nodiscard]] size_type block_count() const noexcept
+        {
+            return m_blocks.size();
+        }
+
+        /**
+         * @brief If there is no key equivalent to @key in the map, inserts value_type(@key, T()) into the map.
+         *
+         * @param key The key of the element to find.
+         * @return mapped_type& A reference to the mapped_type corresponding to @key in *this.
+         */
+        mapped_type& operator[] (const key_type& key)
+        {
+            return emplace(key, mapped_type()).first->second;
+        }
+
+        /**
+         * @brief If there is no key equivalent to @key in the map, inserts value_type(move(@key), T()) into the map.
+         *
+         * @param key The key of the element to find.
+         * @return mapped_type& A reference to the mapped_type corresponding to @key in *this.
+         */
+        mapped_type& operator[] (key_type&& key)
+        {
+            return emplace(std::move(key), mapped_type()).first->second;
+        }
+
+        /**
+         * @brief Returns a reference to the element whose key is equivalent to @key.
+         *        Throws an exception object of type out_of_range if no such element is present.
+         *
+         * @param key The key of the element to find.
+         * @return mapped_type& A reference to the element whose key is equivalent to @key.
+         */
+        mapped_type& at(const key_type& key)
+        {
+            auto found = find(key);
+            if (found == end()) {
+                detail::throw_out_of_range("key passed to 'at' doesn't exist in this map");
+            }
+            return found->second;
+        }
+
+        /**
+         * @brief Returns a reference to the element whose key is equivalent to @key.
+         *        Throws an exception object of type out_of_range if no such element is present.
+         *
+         * @param key The key of the element to find.
+         * @return const mapped_type& A const reference to the element whose key is equivalent to @key.
+         */
+        const mapped_type& at(const key_type& key) const
+        {
+            auto found = find(key);
+            if (found == end()) {
+                detail::throw_out_of_range("key passed to 'at' doesn't exist in this map");
+            }
+            return found->second;
+        }
+
+        /**
+         * @brief  Inserts value if and only if there is no element in the container with key equivalent to the key of value.
+         *
+         * @param value std::pair<Key,T> for insertion.
+         * @return std::pair<iterator, bool> The bool component of the returned pair is true if and only if the insertion takes place,
+         *         and the iterator component of the pair points to the element with key equivalent to the key of @key.
+         */
+        std::pair<iterator, bool> insert(const value_type& value)
+        {
+            return emplace(value);
+        }
+
+        /**
+         * @brief Inserts a new value_type move constructed from the pair if and only if there is no element in the container with key equivalent to the key of value.
+         *
+         * @param value std::pair<Key,T> for insertion.
+         * @return std::pair<iterator, bool> The bool component of the returned pair is true if and only if the insertion takes place,
+         *               and the iterator component of the pair points to the element with key equivalent to the key of @key.
+         */
+        std::pair<iterator, bool> insert(value_type&& value)
+        {
+            return emplace(std::move(value));
+        }
+
+        /**
+         * @brief  Inserts an element move constructed from "value" in the container.
+         *
+         * @param hint Hint pointing to where the insert should start to search.
+         * @param value std::pair<Key,T> for insertion.
+         * @return iterator An iterator pointing to the element with key equivalent to the key of @key.
+         */
+        iterator insert(const_iterator hint, value_type&& value)
+        {
+            return emplace_hint(hint, std::move(value));
+        }
+
+        /**
+         * @brief Inserts a copy of "value" in the container if and only if there is no element in the container with key equivalent to the key of "value".
+         *
+         * @param hint Hint pointing to where the insert should start to search.
+         * @param value std::pair<Key,T> for insertion.
+         * @return iterator An iterator pointing to the element with key equivalent to the key of "value".
+         */
+        iterator insert(const_iterator hint, const value_type& value)
+        {
+            return emplace_hint(hint, value);
+        }
+
+        /**
+         * @brief Inserts each element from the range [first,last) if and only if there is no element with key equivalent to the key of that element.
+         *
+         * @param begin range of elements to insert.
+         * @param end range of elements to insert.
+         */
+        template <typename It>
+        void insert(It begin, It end)
+        {
+            for (; begin != end; ++begin) {
+                emplace(*begin);
+            }
+        }
+
+        /**
+         * @brief Inserts each element from the range [il.begin(), il.end()) if and only if there is no element with key equivalent to the key of that element.
+         *
+         * @param il An initializer_list.
+         */
+        void insert(std::initializer_list<value_type> il)
+        {
+            insert(std::begin(il), std::end(il));
+        }
+
+        /**
+         * @brief Constructs a pair<key_type, value_type> object t constructed with std::forward<Args>(args)....
+                  If the map already contains an element whose key is equivalent to the key of t, nothing is inserted.
+         *        Only the block the key belongs to is shifted, the block is split first if it is full.
+         *
+         * @param first
+         * @param args
+         * @return std::pair<iterator, bool> The bool component of the returned pair is true if and only if the insertion took place, and
+                   the iterator component of the pair points to the element with key equivalent to the key of t
+         */
+        template <typename First, typename ... Args>
+        std::pair<iterator, bool> emplace(First&& first, Args&& ... args)
+        {
+            value_type value(std::forward<First>(first), std::forward<Args>(args) ...);
+            if (m_blocks.empty()) {
+                m_blocks.emplace_back(m_allocator).reserve(block_capacity);
+                m_index.push_back(value.first);
+            }
+            size_type block = block_of(value.first);
+            size_type offset = lower_offset(block, value.first);
+            if ((offset != m_blocks[block].size()) && !key_compare()(value.first, m_blocks[block][offset].first)) {
+                return { iterator(this, block, offset), false };
+            }
+            return { insert_at(block, offset, std::move(value)), true };
+        }
+
+        /**
+         * @brief Inserts an object of type T constructed with std::forward<Args>(args)... in the container if
+         *        and only if there is no element in the container with key equivalent to the key of x.
+         *        When the element belongs right before @hint, it is inserted without searching the index.
+         *
+         * @param hint Hint pointing to where the insert should start to search.
+         * @param first
+         * @param args
+         * @return iterator pointing to the element with key equivalent to the key of x.
+         */
+        template <typename First, typename ... Args>
+        iterator emplace_hint(const_iterator hint, First&& first, Args&& ... args)
+        {
+            value_type value(std::forward<First>(first), std::forward<Args>(args) ...);
+            key_compare comp;
+            if (m_blocks.empty()) {
+                return emplace(std::move(value)).first;
+            }
+            if ((hint == cend()) || comp(value.first, hint->first)) {
+                if (hint == cbegin()) {
+                    return insert_at(0, 0, std::move(value));
+                }
+                auto before = std::prev(hint);
+                if (comp(before->first, value.first)) {
+                    return insert_at(before.m_block, before.m_offset + 1, std::move(value));
+                }
+            }
+            else if (!comp(hint->first, value.first)) {
+                return { this, hint.m_block, hint.m_offset };
+            }
+            return emplace(std::move(value)).first;
+        }
+
+        iterator emplace_hint(const_iterator hint)
+        {
+            return emplace_hint(hint, value_type());
+        }
+
+        /**
+         * @brief Erases the element pointed to by it. Only the block of the element is shifted, and the block is merged
+         *        with its successor when both fit into one block.
+         *
+         * @param it Iterator pointing to the element to be erased.
+         * @return iterator An iterator pointing to the element immediately following the erased one. If no such element exists, returns end().
+         */
+        iterator erase(const_iterator it)
+        {
+            auto& target = m_blocks[it.m_block];
+            target.erase(std::begin(target) + it.m_offset);
+            --m_size;
+            return rebalance(it.m_block, it.m_offset);
+        }
+
+        /**
+         * @brief Erases the element pointed to by it.
+         *
+         * @param it Iterator pointing to the element to be erased.
+         * @return iterator An iterator pointing to the element immediately following the erased one. If no such element exists, returns end().
+         */
+        iterator erase(iterator it)
+        {
+            return erase(const_iterator(it));
+        }
+
+        /**
+         * @brief Erases all the elements in the range [first, last). Only the first and the last block of the range are
+         *        shifted, the blocks in between are removed whole.
+         *
+         * @param first range of elements to remove.
+         * @param last range of elements to remove.
+         * @return iterator to the next of the last deleted element.
+         */
+        iterator erase(const_iterator first, const_iterator last)
+        {
+            if (first == last) {
+                return { this, first.m_block, first.m_offset };
+            }
+            size_type block = first.m_block;
+            size_type offset = first.m_offset;
+            auto& head = m_blocks[block];
+            if (block == last.m_block) {
+                head.erase(std::begin(head) + offset, std::begin(head) + last.m_offset);
+                m_size -= last.m_offset - offset;
+                return rebalance(block, offset);
+            }
+            m_size -= head.size() - offset;
+            head.erase(std::begin(head) + offset, std::end(head));
+            for (size_type i = block + 1; i < last.m_block; ++i) {
+                m_size -= m_blocks[i].size();
+            }
+            if (last.m_block < m_blocks.size()) {
+                auto& tail = m_blocks[last.m_block];
+                tail.erase(std::begin(tail), std::begin(tail) + last.m_offset);
+                m_size -= last.m_offset;
+                m_index[last.m_block] = tail.front().first;
+            }
+            m_blocks.erase(std::begin(m_blocks) + block + 1, std::begin(m_blocks) + last.m_block);
+            m_index.erase(std::begin(m_index) + block + 1, std::begin(m_index) + last.m_block);
+            return rebalance(block, offset);
+        }
+
+        /**
+         * @brief Erases element in the container with key equivalent to @key.
+         *
+         * @param key Key value of the element to remove.
+         * @return  0 if @key not found in container, 1 otherwise.
+         */
+        size_type erase(const key_type& key)
+        {
+            auto found = find(key);
+            if (found == end()) {
+                return 0;
+            }
+            erase(found);
+            return 1;
+        }
+
+        /**
+         * @brief Swaps the contents of *this and other.
+         *
+         * @param other paged_flat_map with which must be swapped.
+         */
+        void swap(paged_flat_map& other) noexcept
+        {
+            m_blocks.swap(other.m_blocks);
+            m_index.swap(other.m_index);
+            std::swap(m_size, other.m_size);
+            std::swap(m_allocator, other.m_allocator);
+        }
+
+        /**
+         * @brief Erases all elements in container.
+         *
+         */
+        void clear()
+        {
+            m_blocks.clear();
+            m_index.clear();
+            m_size = 0;
+        }
+
+        /**
+         * @brief Returns the comparison object out of which a was constructed.
+         *
+         * @return key_compare The comparison object
+         */
+        key_compare key_comp() const
+        {
+            return key_compare();
+        }
+
+        /**
+         * @brief Attempts to find an element with key equivalent to @key.
+         *
+         * @param key Key value of the element to search for.
+         * @return iterator An iterator pointing to an element with the key equivalent to key, or end() if such an element is not found.
+         */
+        [[nodiscard]] iterator find(const key_type& key)
+        {
+            auto found = std::as_const(*this).find(key);
+            return { this, found.m_block, found.m_offset };
+        }
+
+        /**
+         * @brief Attempts to find an element with key equivalent to @key.
+         *
+         * @param key Key value of the element to search for.
+         * @return const_iterator A const_iterator pointing to an element with the key equivalent to @key, or end() if such an element is not found.
+         */
+        [[nodiscard]] const_iterator find(const key_type& key) const
+        {
+            if (m_blocks.empty()) {
+                return end();
+            }
+            size_type block = block_of(key);
+            size_type offset = lower_offset(block, key);
+            if ((offset == m_blocks[block].size()) || key_compare()(key, m_blocks[block][offset].first)) {
+                return end();
+            }
+            return { this, block, offset };
+        }
+
+        /**
+         * @brief Checks if there is an element with key equivalent to @key in the container.
+         *
+         * @param key Key value of the element to search for.
+         * @return true if there is such an element, false otherwise.
+         */
+        [[nodiscard]] bool contains(const key_type& key) const
+        {
+            return find(key) != end();
+        }
+
+        /**
+         * @brief Returns the number of elements with key equivalent to @key.
+         *
+         * @param key Key value of the element to count.
+         * @return 1 if the element is found, 0 otherwise.
+         */
+        [[nodiscard]] size_type count(const key_type& key) const
+        {
+            return contains(key) ? 1 : 0;
+        }
+
+        /**
+         * @brief Finds the first element with key not less than @key, or end() if such an element is not found.
+         *
+         * @param key Key value to compare the elements to.
+         * @return iterator An iterator pointing to the first element with key not less than k, or end() if such an element is not found.
+         */
+        [[nodiscard]] iterator lower_bound(const key_type& key)
+        {
+            auto found = std::as_const(*this).lower_bound(key);
+            return { this, found.m_block, found.m_offset };
+        }
+
+        /**
+         * @brief Finds the first element with key not less than @key, or end() if such an element is not found.
+         *
+         * @param key Key value to compare the elements to.
+         * @return const_iterator An const iterator pointing to the first element with key not less than k, or end() if such an element is not found.
+         */
+        [[nodiscard]] const_iterator lower_bound(const key_type& key) const
+        {
+            if (m_blocks.empty()) {
+                return end();
+            }
+            size_type block = block_of(key);
+            return normalized(block, lower_offset(block, key));
+        }
+
+        /**
+         * @brief Finds the first element with key greater than @key, or end() if such an element is not found.
+         *
+         * @param key Key value to compare the elements to.
+         * @return iterator An iterator pointing to the first element with key greater than @key, or end() if such an element is not found.
+         */
+        [[nodiscard]] iterator upper_bound(const key_type& key)
+        {
+            auto found = std::as_const(*this).upper_bound(key);
+            return { this, found.m_block, found.m_offset };
+        }
+
+        /**
+         * @brief Finds the first element with key greater than @key, or end() if such an element is not found.
+         *
+         * @param key Key value to compare the elements to.
+         * @return const_iterator An const iterator pointing to the first element with key greater than @key, or end() if such an element is not found.
+         */
+        [[nodiscard]] const_iterator upper_bound(const key_type& key) const
+        {
+            if (m_blocks.empty()) {
+                return end();
+            }
+            size_type block = block_of(key);
+            const auto& target = m_blocks[block];
+            auto upper = std::upper_bound(std::begin(target), std::end(target), key
+                , [](const key_type& lhs, const value_type& rhs) { return key_compare()(lhs, rhs.first); });
+            return normalized(block, upper - std::begin(target));
+        }
+
+        /**
+         * @brief  Returns a range containing the element with key equivalent to @key.
+         *
+         * @param key Key value to compare the elements to.
+         * @return std::pair<iterator, iterator> std::pair containing a pair of iterators defining the wanted range.
+         */
+        [[nodiscard]] std::pair<iterator, iterator> equal_range(const key_type& key)
+        {
+            return { lower_bound(key), upper_bound(key) };
+        }
+
+        /**
+         * @brief  Returns a range containing the element with key equivalent to @key.
+         *
+         * @param key Key value to compare the elements to.
+         * @return std::pair<const_iterator, const_iterator> std::pair containing a pair of iterators defining the wanted range.
+         */
+        [[nodiscard]] std::pair<const_iterator, const_iterator> equal_range(const key_type& key) const
+        {
+            return { lower_bound(key), upper_bound(key) };
+        }
+
+        /**
+         * @brief Returns a copy of the allocator used by the blocks.
+         *
+         * @return allocator_type Copy of the allocator.
+         */
+        allocator_type get_allocator() const
+        {
+            return m_allocator;
+        }
+
+        /**
+         * @brief Compares two paged_flat_maps.
+         *
+         * @param other A paged_flat_map with which need to compare.
+         * @return true if they are equal,false otherwise.
+         */
+        bool operator== (const paged_flat_map& other) const
+        {
+            return (size() == other.size()) && std::equal(begin(), end(), other.begin());
+        }
+
+        /**
+         * @brief Compares two paged_flat_maps.
+         *
+         * @param other A paged_flat_map with which need to compare.
+         * @return true if they are unequal,false otherwise.
+         */
+        bool operator!= (const paged_flat_map& other) const
+        {
+            return !(*this == other);
+        }
+
+        /**
+         * @brief Compares two paged_flat_maps.
+         *
+         * @param other A paged_flat_map with which need to compare.
+         * @return true if current paged_flat_map is less than other.
+         */
+        bool operator< (const paged_flat_map& other) const
+        {
+            return std::lexicographical_compare(begin(), end(), other.begin(), other.end());
+        }
+
+        /**
+         * @brief Compares two paged_flat_maps.
+         *
+         * @param other A paged_flat_map with which need to compare.
+         * @return true if current paged_flat_map is greater than other, false otherwise.
+         */
+        bool operator> (const paged_flat_map& other) const
+        {
+            return other < *this;
+        }
+
+        /**
+         * @brief Compares two paged_flat_maps.
+         *
+         * @param other A paged_flat_map with which need to compare.
+         * @return true if current paged_flat_map is equal or less than other, false otherwise.
+         */
+        bool operator<= (const paged_flat_map& other) const
+        {
+            return !(other < *this);
+        }
+
+        /**
+         * @brief Compares two paged_flat_maps.
+         *
+         * @param other A paged_flat_map with which need to compare.
+         * @return true if current paged_flat_map is equal or greater than other, false otherwise.
+         */
+        bool operator>= (const paged_flat_map& other) const
+        {
+            return !(*this < other);
+        }
+
+    private:
+        std::vector<block_type> m_blocks;
+        std::vector<key_type> m_index;
+        size_type m_size = 0;
+        allocator_type m_allocator;
+
+        /**
+         * @brief Returns the index of the block whose range of keys contains @key.
+         */
+        size_type block_of(const key_type& key) const
+        {
+            auto upper = std::upper_bound(std::begin(m_index), std::end(m_index), key, key_compare());
+            return (upper == std::begin(m_index)) ? 0 : (upper - std::begin(m_index)) - 1;
+        }
+
+        size_type lower_offset(size_type block, const key_type& key) const
+        {
+            const auto& target = m_blocks[block];
+            return std::lower_bound(std::begin(target), std::end(target), key
+                , [](const value_type& lhs, const key_type& rhs) { return key_compare()(lhs.first, rhs); })
+                - std::begin(target);
+        }
+
+        const_iterator normalized(size_type block, size_type offset) const
+        {
+            if (offset == m_blocks[block].size()) {
+                return { this, block + 1, 0 };
+            }
+            return { this, block, offset };
+        }
+
+        /**
+         * @brief Inserts @value at @offset in @block, splitting the block first if it is full.
+         */
+        iterator insert_at(size_type block, size_type offset, value_type&& value)
+        {
+            if (m_blocks[block].size() == block_capacity) {
+                split(block);
+                if (offset > m_blocks[block].size()) {
+                    offset -= m_blocks[block].size();
+                    ++block;
+                }
+            }
+            auto& target = m_blocks[block];
+            target.emplace(std::begin(target) + offset, std::move(value));
+            if (offset == 0) {
+                m_index[block] = target.front().first;
+            }
+            ++m_size;
+            return { this, block, offset };
+        }
+
+        /**
+         * @brief Restores the invariants of @block after elements were erased at @offset: removes the block if it is empty,
+         *        updates its minimal key and merges it with a neighbour when both fit into one block.
+         *
+         * @return iterator An iterator pointing to the element which followed the erased ones.
+         */
+        iterator rebalance(size_type block, size_type offset)
+        {
+            auto& target = m_blocks[block];
+            if (target.empty()) {
+                m_blocks.erase(std::begin(m_blocks) + block);
+                m_index.erase(std::begin(m_index) + block);
+                return { this, block, 0 };
+            }
+            if (offset == 0) {
+                m_index[block] = target.front().first;
+            }
+            if ((block + 1 < m_blocks.size()) && (target.size() + m_blocks[block + 1].size() <= block_capacity / 2)) {
+                merge_next(block);
+            }
+            else if ((block > 0) && (target.size() + m_blocks[block - 1].size() <= block_capacity / 2)) {
+                offset += m_blocks[block - 1].size();
+                merge_next(--block);
+            }
+            if (offset == m_blocks[block].size()) {
+                return { this, block + 1, 0 };
+            }
+            return { this, block, offset };
+        }
+
+        size_type position_of(size_type block, size_type offset) const
+        {
+            size_type position = offset;
+            for (size_type i = 0; i < block; ++i) {
+                position += m_blocks[i].size();
+            }
+            return position;
+        }
+
+        /**
+         * @brief Moves the upper half of a full block into a new block inserted after it.
+         */
+        void split(size_type block)
+        {
+            auto& source = m_blocks[block];
+            size_type half = source.size() / 2;
+            block_type upper(m_allocator);
+            upper.reserve(block_capacity);
+            upper.insert(std::end(upper), std::make_move_iterator(std::begin(source) + half)
+                , std::make_move_iterator(std::end(source)));
+            m_index.insert(std::begin(m_index) + block + 1, upper.front().first);
+            try
+            {
+                m_blocks.insert(std::begin(m_blocks) + block + 1, std::move(upper));
+            }
+            catch (...)
+            {
+                m_index.erase(std::begin(m_index) + block + 1);
+                throw;
+            }
+            auto& lower = m_blocks[block];
+            lower.erase(std::begin(lower) + half, std::end(lower));
+        }
+
+        /**
+         * @brief Appends the elements of the block after @block to it and removes the emptied block.
+         */
+        void merge_next(size_type block)
+        {
+            auto& target = m_blocks[block];
+            auto& next = m_blocks[block + 1];
+            target.insert(std::end(target), std::make_move_iterator(std::begin(next)), std::make_move_iterator(std::end(next)));
+            m_blocks.erase(std::begin(m_blocks) + block + 1);
+            m_index.erase(std::begin(m_index) + block + 1);
+        }
+    };
+
+    template <typename K, typename V, typename C, typename A, std::size_t P>
+    void swap(paged_flat_map<K, V, C, A, P>& lhs, paged_flat_map<K, V, C, A, P>& rhs) noexcept
+    {
+        lhs.swap(rhs);
+    }
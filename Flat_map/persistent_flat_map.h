@@ -0,0 +1,475 @@
+#pragma once
+
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#include "flat_map.h"
+
+    /**
+     * @brief An immutable flat_map whose mutations return a new version of the map. The elements are stored in sorted
+     *        chunks of at most ChunkSize elements, and a new version copies only the chunk it modifies and the small
+     *        table of chunk pointers, sharing all the other chunks with the previous version.
+     *        A persistent_flat_map is a cheap handle to a version; a version and its chunks are released when the last
+     *        handle referring to them is destroyed. Handles may be read from several threads.
+     *
+     * @tparam K is the key_type of the map.
+     * @tparam V is the value_type of the map.
+     * @tparam std::less<K> the ordering function for Keys.
+     * @tparam std::allocator<std::pair<K, V>> the allocator to allocate the value_types.
+     * @tparam ChunkSize the maximal number of elements of a chunk.
+     */
+    template <typename K
+        , typename V
+        , typename Comp = std::less<K>
+        , typename Allocator = std::allocator<std::pair<K, V>>
+        , std::size_t ChunkSize = 512
+    >
+        struct persistent_flat_map
+    {
+        using chunk_type = flat_map<K, V, Comp, Allocator>;
+        using key_type = K;
+        using mapped_type = V;
+        using value_type = std::pair<K, V>;
+        using key_compare = Comp;
+        using allocator_type = Allocator;
+        using size_type = typename chunk_type::size_type;
+        using difference_type = typename chunk_type::difference_type;
+
+        static_assert(ChunkSize >= 2, "a chunk must be able to hold two elements to be split");
+
+    private:
+        using chunk_pointer = std::shared_ptr<const chunk_type>;
+
+        struct version
+        {
+            std::vector<chunk_pointer> chunks;
+            size_type size = 0;
+        };
+
+    public:
+        /**
+         * @brief Bidirectional iterator over the elements of one version. It keeps the version alive.
+         */
+        struct const_iterator
+        {
+            using iterator_category = std::bidirectional_iterator_tag;
+            using value_type = typename persistent_flat_map::value_type;
+            using difference_type = typename persistent_flat_map::difference_type;
+            using reference = const value_type&;
+            using pointer = const value_type*;
+
+            const_iterator() = default;
+
+            [[nodiscard]] reference operator* () const
+            {
+                return *(m_version->chunks[m_chunk]->begin() + m_offset);
+            }
+
+            [[nodiscard]] pointer operator-> () const
+            {
+                return &**this;
+            }
+
+            const_iterator& operator++ ()
+            {
+                if (++m_offset == m_version->chunks[m_chunk]->size()) {
+                    ++m_chunk;
+                    m_offset = 0;
+                }
+                return *this;
+            }
+
+            const_iterator operator++ (int)
+            {
+                const_iterator result = *this;
+                ++*this;
+                return result;
+            }
+
+            const_iterator& operator-- ()
+            {
+                if (m_offset == 0) {
+                    m_offset = m_version->chunks[--m_chunk]->size();
+                }
+                --m_offset;
+                return *this;
+            }
+
+            const_iterator operator-- (int)
+            {
+                const_iterator result = *this;
+                --*this;
+                return result;
+            }
+
+            bool operator== (const const_iterator& other) const
+            {
+                return (m_chunk == other.m_chunk) && (m_offset == other.m_offset);
+            }
+
+            bool operator!= (const const_iterator& other) const
+            {
+                return !(*this == other);
+            }
+
+        private:
+            friend struct persistent_flat_map;
+
+            const_iterator(std::shared_ptr<const version> owner, size_type chunk, size_type offset)
+                : m_version(std::move(owner))
+                , m_chunk(chunk)
+                , m_offset(offset)
+            {
+            }
+
+            std::shared_ptr<const version> m_version;
+            size_type m_chunk = 0;
+            size_type m_offset = 0;
+        };
+
+        using iterator = const_iterator;
+
+        persistent_flat_map() = default;
+        ~persistent_flat_map() = default;
+        persistent_flat_map(persistent_flat_map&&) = default;
+        persistent_flat_map(const persistent_flat_map&) = default;
+        persistent_flat_map& operator=(persistent_flat_map&&) = default;
+        persistent_flat_map& operator=(const persistent_flat_map&) = default;
+
+        /**
+         * @brief Constructs a persistent_flat_map holding the elements of @map.
+         *
+         * @param map The flat_map to take the elements from.
+         */
+        explicit persistent_flat_map(const chunk_type& map)
+        {
+            auto result = std::make_shared<version>();
+            result->size = map.size();
+            for (auto it = map.begin(); it != map.end(); ) {
+                auto last = it + std::min<difference_type>(ChunkSize / 2 + 1, map.end() - it);
+                result->chunks.push_back(std::make_shared<const chunk_type>(sorted_unique, it, last));
+                it = last;
+            }
+            m_version = std::move(result);
+        }
+
+        /**
+         * @brief Constructs a persistent_flat_map and inserts elements from the range [begin ,end ).
+         *
+         * @param begin range of elements to insert.
+         * @param end range of elements to insert.
+         */
+        template <typename It>
+        persistent_flat_map(It begin, It end)
+            : persistent_flat_map(chunk_type(begin, end))
+        {
+        }
+
+        /**
+         * @brief Constructs a persistent_flat_map and inserts elements from the range [il.begin() ,il.end()).
+         *
+         * @param init An initializer_list.
+         */
+        persistent_flat_map(std::initializer_list<value_type> init)
+            : persistent_flat_map(chunk_type(init))
+        {
+        }
+
+        /**
+         * @brief Returns a const_iterator to the first element of this version.
+         *
+         * @return const_iterator to the first element.
+         */
+        [[nodiscard]] const_iterator begin() const
+        {
+            return { m_version, 0, 0 };
+        }
+
+        /**
+         * @brief Returns a const_iterator to the end of this version.
+         *
+         * @return const_iterator to the end of the container.
+         */
+        [[nodiscard]] const_iterator end() const
+        {
+            return { m_version, chunk_count(), 0 };
+        }
+
+        /**
+         * @brief Checks the empyiness of the container
+         *
+         * @return true if the container contains no elemets, false otherwise.
+         */
+        [[nodiscard]] bool empty() const noexcept
+        {
+            return size() == 0;
+        }
+
+        /**
+         * @brief  Returns the number of the elements contained in this version.
+         *
+         * @return The number of the elements of container.
+         */
+        [[nodiscard]] size_type size() const noexcept
+        {
+            return m_version ? m_version->size : 0;
+        }
+
+        /**
+         * @brief  Returns the number of the chunks of this version.
+         *
+         * @return The number of the chunks.
+         */
+        [[nodiscard]] size_type chunk_count() const noexcept
+        {
+            return m_version ? m_version->chunks.size() : 0;
+        }
+
+        /**
+         * @brief Checks if two handles refer to the same version.
+         *
+         * @param other A persistent_flat_map to compare the version with.
+         * @return true if both handles refer to the same version, false otherwise.
+         */
+        [[nodiscard]] bool same_version(const persistent_flat_map& other) const noexcept
+        {
+            return m_version == other.m_version;
+        }
+
+        /**
+         * @brief Attempts to find an element with key equivalent to @key.
+         *
+         * @param key Key value of the element to search for.
+         * @return const_iterator A const_iterator pointing to an element with the key equivalent to @key, or end() if such an element is not found.
+         */
+        [[nodiscard]] const_iterator find(const key_type& key) const
+        {
+            size_type chunk = chunk_of(key);
+            if (chunk == chunk_count()) {
+                return end();
+            }
+            const chunk_type& target = *m_version->chunks[chunk];
+            auto found = target.find(key);
+            if (found == target.end()) {
+                return end();
+            }
+            return { m_version, chunk, static_cast<size_type>(found - target.begin()) };
+        }
+
+        /**
+         * @brief Finds the first element with key not less than @key, or end() if such an element is not found.
+         *
+         * @param key Key value to compare the elements to.
+         * @return const_iterator An const iterator pointing to the first element with key not less than k, or end() if such an element is not found.
+         */
+        [[nodiscard]] const_iterator lower_bound(const key_type& key) const
+        {
+            size_type chunk = chunk_of(key);
+            if (chunk == chunk_count()) {
+                return end();
+            }
+            const chunk_type& target = *m_version->chunks[chunk];
+            auto lower = target.lower_bound(key);
+            if (lower == target.end()) {
+                return { m_version, chunk + 1, 0 };
+            }
+            return { m_version, chunk, static_cast<size_type>(lower - target.begin()) };
+        }
+
+        /**
+         * @brief Checks if there is an element with key equivalent to @key in the container.
+         *
+         * @param key Key value of the element to search for.
+         * @return true if there is such an element, false otherwise.
+         */
+        [[nodiscard]] bool contains(const key_type& key) const
+        {
+            return find(key) != end();
+        }
+
+        /**
+         * @brief Returns the number of elements with key equivalent to @key.
+         *
+         * @param key Key value of the element to count.
+         * @return 1 if the element is found, 0 otherwise.
+         */
+        [[nodiscard]] size_type count(const key_type& key) const
+        {
+            return contains(key) ? 1 : 0;
+        }
+
+        /**
+         * @brief Returns a reference to the element whose key is equivalent to @key.
+         *        Throws an exception object of type out_of_range if no such element is present.
+         *
+         * @param key The key of the element to find.
+         * @return const mapped_type& A const reference to the element, valid while this version is alive.
+         */
+        const mapped_type& at(const key_type& key) const
+        {
+            auto found = find(key);
+            if (found == end()) {
+                detail::throw_out_of_range("key passed to 'at' doesn't exist in this map");
+            }
+            return found->second;
+        }
+
+        /**
+         * @brief Returns a new version which contains @value if there was no element with key equivalent to the key of @value.
+         *
+         * @param value std::pair<Key,T> for insertion.
+         * @return persistent_flat_map The new version, or this version if nothing was inserted.
+         */
+        [[nodiscard]] persistent_flat_map insert(const value_type& value) const
+        {
+            if (contains(value.first)) {
+                return *this;
+            }
+            return insert_or_assign(value.first, value.second);
+        }
+
+        /**
+         * @brief Returns a new version in which the key @key is mapped to @value.
+         *        Only the chunk holding @key is copied, all the other chunks are shared with this version.
+         *
+         * @param key The key of the element to insert or assign.
+         * @param value The value to write.
+         * @return persistent_flat_map The new version.
+         */
+        [[nodiscard]] persistent_flat_map insert_or_assign(const key_type& key, const mapped_type& value) const
+        {
+            auto result = copy_version();
+            if (result->chunks.empty()) {
+                result->chunks.push_back(std::make_shared<const chunk_type>());
+            }
+            size_type chunk = std::min(chunk_of(key), result->chunks.size() - 1);
+            chunk_type modified = *result->chunks[chunk];
+            auto inserted = modified.emplace(key, value);
+            if (inserted.second) {
+                ++result->size;
+            }
+            else {
+                inserted.first->second = value;
+            }
+            if (modified.size() > ChunkSize) {
+                auto middle = modified.begin() + modified.size() / 2;
+                auto upper = std::make_shared<const chunk_type>(sorted_unique, middle, modified.end());
+                modified.erase(middle, modified.end());
+                result->chunks.insert(std::begin(result->chunks) + chunk + 1, std::move(upper));
+            }
+            result->chunks[chunk] = std::make_shared<const chunk_type>(std::move(modified));
+            return persistent_flat_map(std::move(result));
+        }
+
+        /**
+         * @brief Returns a new version without the element with key equivalent to @key.
+         *        Only the chunk holding @key is copied, all the other chunks are shared with this version.
+         *
+         * @param key Key value of the element to remove.
+         * @return persistent_flat_map The new version, or this version if @key is not found.
+         */
+        [[nodiscard]] persistent_flat_map erase(const key_type& key) const
+        {
+            auto found = find(key);
+            if (found == end()) {
+                return *this;
+            }
+            auto result = copy_version();
+            --result->size;
+            chunk_type modified = *result->chunks[found.m_chunk];
+            modified.erase(modified.begin() + found.m_offset);
+            if (modified.empty()) {
+                result->chunks.erase(std::begin(result->chunks) + found.m_chunk);
+            }
+            else {
+                result->chunks[found.m_chunk] = std::make_shared<const chunk_type>(std::move(modified));
+            }
+            return persistent_flat_map(std::move(result));
+        }
+
+        /**
+         * @brief Returns an empty version.
+         *
+         * @return persistent_flat_map An empty map.
+         */
+        [[nodiscard]] persistent_flat_map clear() const
+        {
+            return persistent_flat_map();
+        }
+
+        /**
+         * @brief Swaps the versions *this and other refer to.
+         *
+         * @param other persistent_flat_map with which must be swapped.
+         */
+        void swap(persistent_flat_map& other) noexcept
+        {
+            m_version.swap(other.m_version);
+        }
+
+        /**
+         * @brief Returns the comparison object out of which a was constructed.
+         *
+         * @return key_compare The comparison object
+         */
+        key_compare key_comp() const
+        {
+            return key_compare();
+        }
+
+        /**
+         * @brief Compares the elements of two versions.
+         *
+         * @param other A persistent_flat_map with which need to compare.
+         * @return true if they are equal,false otherwise.
+         */
+        bool operator== (const persistent_flat_map& other) const
+        {
+            return same_version(other) || ((size() == other.size()) && std::equal(begin(), end(), other.begin()));
+        }
+
+        /**
+         * @brief Compares the elements of two versions.
+         *
+         * @param other A persistent_flat_map with which need to compare.
+         * @return true if they are unequal,false otherwise.
+         */
+        bool operator!= (const persistent_flat_map& other) const
+        {
+            return !(*this == other);
+        }
+
+    private:
+        std::shared_ptr<const version> m_version;
+
+        explicit persistent_flat_map(std::shared_ptr<const version> owner)
+            : m_version(std::move(owner))
+        {
+        }
+
+        std::shared_ptr<version> copy_version() const
+        {
+            return m_version ? std::make_shared<version>(*m_version) : std::make_shared<version>();
+        }
+
+        /**
+         * @brief Returns the index of the chunk whose range of keys contains @key, or chunk_count() if the map is empty.
+         */
+        size_type chunk_of(const key_type& key) const
+        {
+            if (chunk_count() == 0) {
+                return 0;
+            }
+            const auto& chunks = m_version->chunks;
+            auto upper = std::upper_bound(std::begin(chunks), std::end(chunks), key
+                , [](const key_type& lhs, const chunk_pointer& rhs) { return key_compare()(lhs, rhs->begin()->first); });
+            return (upper == std::begin(chunks)) ? 0 : (upper - std::begin(chunks)) - 1;
+        }
+    };
+
+    template <typename K, typename V, typename C, typename A, std::size_t S>
+    void swap(persistent_flat_map<K, V, C, A, S>& lhs, persistent_flat_map<K, V, C, A, S>& rhs) noexcept
+    {
+        lhs.swap(rhs);
+    }
@@ -0,0 +1,748 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "flat_map.h"
+
+    /**
+     * @brief Customization point telling whether moving a T to a new address and ending the lifetime of the source can be done
+     *        by copying its bytes. True for trivially copyable types and for pairs of trivially relocatable types; specialize it
+     *        for other types whose objects do not point into themselves.
+     */
+    template <typename T>
+    struct is_trivially_relocatable : std::is_trivially_copyable<T>
+    {
+    };
+
+    template <typename First, typename Second>
+    struct is_trivially_relocatable<std::pair<First, Second>>
+        : std::bool_constant<is_trivially_relocatable<First>::value && is_trivially_relocatable<Second>::value>
+    {
+    };
+
+    template <typename T>
+    inline constexpr bool is_trivially_relocatable_v = is_trivially_relocatable<T>::value;
+
+    /**
+     * @brief A vector-like container which, for trivially relocatable T, opens and closes gaps with memmove and grows with realloc
+     *        instead of moving the elements one by one, and, on Linux, grows huge buffers by remapping their pages.
+     *        For other types it behaves like std::vector.
+     *        It can be used as the Container of flat_map, see relocatable_flat_map.
+     *
+     * @tparam T is the element type.
+     */
+    template <typename T>
+    struct relocatable_vector
+    {
+        static_assert(alignof(T) <= alignof(std::max_align_t), "relocatable_vector does not support over-aligned types");
+
+        using value_type = T;
+        using allocator_type = std::allocator<T>;
+        using size_type = std::size_t;
+        using difference_type = std::ptrdiff_t;
+        using reference = T&;
+        using const_reference = const T&;
+        using pointer = T*;
+        using const_pointer = const T*;
+        using iterator = T*;
+        using const_iterator = const T*;
+        using reverse_iterator = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+        static constexpr bool relocatable = is_trivially_relocatable_v<T>;
+
+        /**
+         * @brief The size in bytes from which buffers of trivially relocatable elements are mapped pages grown with mremap (Linux only).
+         */
+        static constexpr std::size_t mapped_threshold = std::size_t(64) << 20;
+
+        relocatable_vector() = default;
+
+        relocatable_vector(const relocatable_vector& other)
+        {
+            reserve(other.size());
+            try
+            {
+                m_size = std::uninitialized_copy(other.begin(), other.end(), m_data) - m_data;
+            }
+            catch (...)
+            {
+                release();
+                throw;
+            }
+        }
+
+        relocatable_vector(relocatable_vector&& other) noexcept
+            : m_data(std::exchange(other.m_data, nullptr))
+            , m_size(std::exchange(other.m_size, 0))
+            , m_capacity(std::exchange(other.m_capacity, 0))
+            , m_mapped_bytes(std::exchange(other.m_mapped_bytes, 0))
+        {
+        }
+
+        relocatable_vector& operator=(const relocatable_vector& other)
+        {
+            if (this != &other) {
+                relocatable_vector copy(other);
+                swap(copy);
+            }
+            return *this;
+        }
+
+        relocatable_vector& operator=(relocatable_vector&& other) noexcept
+        {
+            relocatable_vector moved(std::move(other));
+            swap(moved);
+            return *this;
+        }
+
+        ~relocatable_vector()
+        {
+            clear();
+            release();
+        }
+
+        /**
+         * @brief Returns an iterator to the first element.
+         */
+        [[nodiscard]] iterator begin() noexcept
+        {
+            return m_data;
+        }
+
+        /**
+         * @brief Returns an iterator past the last element.
+         */
+        [[nodiscard]] iterator end() noexcept
+        {
+            return m_data + m_size;
+        }
+
+        /**
+         * @brief Returns an iterator to the first element.
+         */
+        [[nodiscard]] const_iterator begin() const noexcept
+        {
+            return m_data;
+        }
+
+        /**
+         * @brief Returns an iterator past the last element.
+         */
+        [[nodiscard]] const_iterator end() const noexcept
+        {
+            return m_data + m_size;
+        }
+
+        /**
+         * @brief Returns a const_iterator to the first element.
+         */
+        [[nodiscard]] const_iterator cbegin() const noexcept
+        {
+            return m_data;
+        }
+
+        /**
+         * @brief Returns a const_iterator past the last element.
+         */
+        [[nodiscard]] const_iterator cend() const noexcept
+        {
+            return m_data + m_size;
+        }
+
+        /**
+         * @brief Returns a reverse iterator to the last element.
+         */
+        [[nodiscard]] reverse_iterator rbegin() noexcept
+        {
+            return reverse_iterator(end());
+        }
+
+        /**
+         * @brief Returns a reverse iterator before the first element.
+         */
+        [[nodiscard]] reverse_iterator rend() noexcept
+        {
+            return reverse_iterator(begin());
+        }
+
+        /**
+         * @brief Returns a reverse iterator to the last element.
+         */
+        [[nodiscard]] const_reverse_iterator rbegin() const noexcept
+        {
+            return const_reverse_iterator(end());
+        }
+
+        /**
+         * @brief Returns a reverse iterator before the first element.
+         */
+        [[nodiscard]] const_reverse_iterator rend() const noexcept
+        {
+            return const_reverse_iterator(begin());
+        }
+
+        /**
+         * @brief Returns a const reverse iterator to the last element.
+         */
+        [[nodiscard]] const_reverse_iterator crbegin() const noexcept
+        {
+            return rbegin();
+        }
+
+        /**
+         * @brief Returns a const reverse iterator before the first element.
+         */
+        [[nodiscard]] const_reverse_iterator crend() const noexcept
+        {
+            return rend();
+        }
+
+        /**
+         * @brief Returns a pointer to the first element.
+         */
+        [[nodiscard]] T* data() noexcept
+        {
+            return m_data;
+        }
+
+        /**
+         * @brief Returns a pointer to the first element.
+         */
+        [[nodiscard]] const T* data() const noexcept
+        {
+            return m_data;
+        }
+
+        /**
+         * @brief Returns the element at @index.
+         */
+        [[nodiscard]] T& operator[] (size_type index) noexcept
+        {
+            return m_data[index];
+        }
+
+        /**
+         * @brief Returns the element at @index.
+         */
+        [[nodiscard]] const T& operator[] (size_type index) const noexcept
+        {
+            return m_data[index];
+        }
+
+        /**
+         * @brief Returns the last element.
+         */
+        [[nodiscard]] T& back() noexcept
+        {
+            return m_data[m_size - 1];
+        }
+
+        /**
+         * @brief Returns the last element.
+         */
+        [[nodiscard]] const T& back() const noexcept
+        {
+            return m_data[m_size - 1];
+        }
+
+        /**
+         * @brief Checks whether the container has no elements.
+         */
+        [[nodiscard]] bool empty() const noexcept
+        {
+            return m_size == 0;
+        }
+
+        /**
+         * @brief Returns the number of elements.
+         */
+        [[nodiscard]] size_type size() const noexcept
+        {
+            return m_size;
+        }
+
+        /**
+         * @brief Returns the number of elements the buffer can hold without growing.
+         */
+        [[nodiscard]] size_type capacity() const noexcept
+        {
+            return m_capacity;
+        }
+
+        /**
+         * @brief Returns the largest possible size of the container.
+         */
+        [[nodiscard]] size_type max_size() const noexcept
+        {
+            return std::numeric_limits<difference_type>::max() / sizeof(T);
+        }
+
+        /**
+         * @brief Returns a default allocator; the storage is allocated with malloc and realloc.
+         */
+        [[nodiscard]] allocator_type get_allocator() const noexcept
+        {
+            return allocator_type();
+        }
+
+        /**
+         * @brief Grows the capacity to at least @capacity elements.
+         *
+         * @param capacity Requested capacity.
+         */
+        void reserve(size_type capacity)
+        {
+            if (capacity > m_capacity) {
+                reallocate(capacity);
+            }
+        }
+
+        /**
+         * @brief Releases the unused capacity.
+         *
+         */
+        void shrink_to_fit()
+        {
+            if (m_size < m_capacity) {
+                reallocate(m_size);
+            }
+        }
+
+        /**
+         * @brief Constructs an element from @args before @pos. For trivially relocatable T the element is built aside,
+         *        the tail is shifted with one memmove and the element is relocated into the gap.
+         *
+         * @param pos Iterator before which the element is constructed.
+         * @param args Arguments to construct the element from.
+         * @return iterator An iterator pointing to the new element.
+         */
+        template <typename ... Args>
+        iterator emplace(const_iterator pos, Args&& ... args)
+        {
+            size_type index = pos - m_data;
+            if constexpr (relocatable) {
+                alignas(T) unsigned char buffer[sizeof(T)];
+                T* element = ::new (static_cast<void*>(buffer)) T(std::forward<Args>(args) ...);
+                try
+                {
+                    grow_for(1);
+                }
+                catch (...)
+                {
+                    element->~T();
+                    throw;
+                }
+                std::memmove(static_cast<void*>(m_data + index + 1), m_data + index, (m_size - index) * sizeof(T));
+                std::memcpy(static_cast<void*>(m_data + index), buffer, sizeof(T));
+                ++m_size;
+            }
+            else {
+                emplace_back(std::forward<Args>(args) ...);
+                std::rotate(m_data + index, m_data + m_size - 1, m_data + m_size);
+            }
+            return m_data + index;
+        }
+
+        /**
+         * @brief Inserts a copy of @value before @pos.
+         *
+         * @param pos Iterator before which the element is inserted.
+         * @param value The element to insert.
+         * @return iterator An iterator pointing to the new element.
+         */
+        iterator insert(const_iterator pos, const T& value)
+        {
+            return emplace(pos, value);
+        }
+
+        /**
+         * @brief Inserts @value before @pos.
+         *
+         * @param pos Iterator before which the element is inserted.
+         * @param value The element to insert.
+         * @return iterator An iterator pointing to the new element.
+         */
+        iterator insert(const_iterator pos, T&& value)
+        {
+            return emplace(pos, std::move(value));
+        }
+
+        /**
+         * @brief Constructs an element from @args at the end.
+         *
+         * @param args Arguments to construct the element from.
+         * @return T& The new element.
+         */
+        template <typename ... Args>
+        T& emplace_back(Args&& ... args)
+        {
+            if (m_size == m_capacity) {
+                if constexpr (relocatable) {
+                    alignas(T) unsigned char buffer[sizeof(T)];
+                    T* element = ::new (static_cast<void*>(buffer)) T(std::forward<Args>(args) ...);
+                    try
+                    {
+                        grow_for(1);
+                    }
+                    catch (...)
+                    {
+                        element->~T();
+                        throw;
+                    }
+                    std::memcpy(static_cast<void*>(m_data + m_size), buffer, sizeof(T));
+                    return m_data[m_size++];
+                }
+                else {
+                    return emplace_back_reallocate(std::forward<Args>(args) ...);
+                }
+            }
+            ::new (static_cast<void*>(m_data + m_size)) T(std::forward<Args>(args) ...);
+            return m_data[m_size++];
+        }
+
+        /**
+         * @brief Appends up to @count elements constructed by @op directly in uninitialized storage.
+         *        @op is called as op(T* first, size_type count) and returns the number of elements it constructed.
+         *
+         * @param count The maximal number of elements to append.
+         * @param op The function constructing the elements.
+         */
+        template <typename Op>
+        void append_and_overwrite(size_type count, Op op)
+        {
+            grow_for(count);
+            size_type written = op(m_data + m_size, count);
+            m_size += std::min(written, count);
+        }
+
+        /**
+         * @brief Appends a copy of @value.
+         */
+        void push_back(const T& value)
+        {
+            emplace_back(value);
+        }
+
+        /**
+         * @brief Appends @value.
+         */
+        void push_back(T&& value)
+        {
+            emplace_back(std::move(value));
+        }
+
+        /**
+         * @brief Destroys the last element.
+         */
+        void pop_back() noexcept
+        {
+            m_data[--m_size].~T();
+        }
+
+        /**
+         * @brief Erases the element at @pos.
+         *
+         * @param pos Iterator pointing to the element to erase.
+         * @return iterator An iterator pointing to the element following the erased one.
+         */
+        iterator erase(const_iterator pos)
+        {
+            return erase(pos, pos + 1);
+        }
+
+        /**
+         * @brief Erases the elements in [first, last). For trivially relocatable T the tail is shifted with one memmove.
+         *
+         * @param first range of elements to erase.
+         * @param last range of elements to erase.
+         * @return iterator An iterator pointing to the element following the erased ones.
+         */
+        iterator erase(const_iterator first, const_iterator last)
+        {
+            T* begin = m_data + (first - m_data);
+            T* end = m_data + (last - m_data);
+            if (begin == end) {
+                return begin;
+            }
+            if constexpr (relocatable) {
+                std::destroy(begin, end);
+                std::memmove(static_cast<void*>(begin), end, (m_data + m_size - end) * sizeof(T));
+            }
+            else {
+                T* new_end = std::move(end, m_data + m_size, begin);
+                std::destroy(new_end, m_data + m_size);
+            }
+            m_size -= end - begin;
+            return begin;
+        }
+
+        /**
+         * @brief Resizes the container to @size elements, value-initializing the new ones.
+         *
+         * @param size The new size.
+         */
+        void resize(size_type size)
+        {
+            if (size < m_size) {
+                erase(m_data + size, m_data + m_size);
+                return;
+            }
+            reserve(size);
+            std::uninitialized_value_construct(m_data + m_size, m_data + size);
+            m_size = size;
+        }
+
+        /**
+         * @brief Destroys all elements and keeps the capacity.
+         */
+        void clear() noexcept
+        {
+            std::destroy(m_data, m_data + m_size);
+            m_size = 0;
+        }
+
+        /**
+         * @brief Swaps the contents of *this and @other.
+         */
+        void swap(relocatable_vector& other) noexcept
+        {
+            std::swap(m_data, other.m_data);
+            std::swap(m_size, other.m_size);
+            std::swap(m_capacity, other.m_capacity);
+            std::swap(m_mapped_bytes, other.m_mapped_bytes);
+        }
+
+        /**
+         * @brief Compares the elements of two containers for equality.
+         */
+        bool operator== (const relocatable_vector& other) const
+        {
+            return std::equal(begin(), end(), other.begin(), other.end());
+        }
+
+        /**
+         * @brief Compares the elements of two containers for inequality.
+         */
+        bool operator!= (const relocatable_vector& other) const
+        {
+            return !(*this == other);
+        }
+
+        /**
+         * @brief Compares the elements of two containers lexicographically.
+         */
+        bool operator< (const relocatable_vector& other) const
+        {
+            return std::lexicographical_compare(begin(), end(), other.begin(), other.end());
+        }
+
+    private:
+        T* m_data = nullptr;
+        size_type m_size = 0;
+        size_type m_capacity = 0;
+        std::size_t m_mapped_bytes = 0;
+
+        void grow_for(size_type count)
+        {
+            if (m_size + count > m_capacity) {
+                reallocate(grown_capacity(count));
+            }
+        }
+
+        size_type grown_capacity(size_type count) const noexcept
+        {
+            return std::max(m_size + count, m_capacity + m_capacity / 2);
+        }
+
+        /**
+         * @brief Appends an element constructed from @args to a full buffer of non-relocatable elements. The element is built
+         *        in the new buffer before the old elements are moved, so @args may refer to an element of the vector.
+         */
+        template <typename ... Args>
+        T& emplace_back_reallocate(Args&& ... args)
+        {
+            size_type capacity = grown_capacity(1);
+            if (capacity > max_size()) {
+                throw std::length_error("relocatable_vector exceeds max_size");
+            }
+            T* data = static_cast<T*>(std::malloc(capacity * sizeof(T)));
+            if (data == nullptr) {
+                throw std::bad_alloc();
+            }
+            T* element = data + m_size;
+            try
+            {
+                ::new (static_cast<void*>(element)) T(std::forward<Args>(args) ...);
+            }
+            catch (...)
+            {
+                std::free(data);
+                throw;
+            }
+            try
+            {
+                relocate_elements(data);
+            }
+            catch (...)
+            {
+                element->~T();
+                std::free(data);
+                throw;
+            }
+            std::destroy(m_data, m_data + m_size);
+            std::free(m_data);
+            m_data = data;
+            m_capacity = capacity;
+            return m_data[m_size++];
+        }
+
+        /**
+         * @brief Constructs the elements of a non-relocatable T at @data, moving them if that cannot throw and copying them
+         *        otherwise, like std::move_if_noexcept, so that the elements are intact if a constructor throws.
+         */
+        void relocate_elements(T* data)
+        {
+            if constexpr (std::is_nothrow_move_constructible_v<T> || !std::is_copy_constructible_v<T>) {
+                std::uninitialized_move_n(m_data, m_size, data);
+            }
+            else {
+                std::uninitialized_copy_n(m_data, m_size, data);
+            }
+        }
+
+        /**
+         * @brief Moves the elements to a buffer of @capacity elements. Trivially relocatable elements are moved by realloc,
+         *        which can often extend the buffer in place. On Linux, buffers of trivially relocatable elements of at least
+         *        mapped_threshold bytes are mapped pages which grow with mremap, so growth remaps the pages instead of copying
+         *        them and never holds the old and the new buffer at the same time.
+         */
+        void reallocate(size_type capacity)
+        {
+            if (capacity > max_size()) {
+                throw std::length_error("relocatable_vector exceeds max_size");
+            }
+            if (capacity == 0) {
+                release();
+                m_data = nullptr;
+                m_capacity = 0;
+                return;
+            }
+            T* data = nullptr;
+            if constexpr (relocatable) {
+#ifdef __linux__
+                std::size_t bytes = capacity * sizeof(T);
+                if (bytes >= mapped_threshold) {
+                    reallocate_mapped(bytes);
+                    return;
+                }
+                if (m_mapped_bytes != 0) {
+                    data = static_cast<T*>(std::malloc(bytes));
+                    if (data == nullptr) {
+                        throw std::bad_alloc();
+                    }
+                    std::memcpy(static_cast<void*>(data), m_data, m_size * sizeof(T));
+                    release();
+                    m_data = data;
+                    m_capacity = capacity;
+                    return;
+                }
+#endif
+                data = static_cast<T*>(std::realloc(static_cast<void*>(m_data), capacity * sizeof(T)));
+                if (data == nullptr) {
+                    throw std::bad_alloc();
+                }
+            }
+            else {
+                data = static_cast<T*>(std::malloc(capacity * sizeof(T)));
+                if (data == nullptr) {
+                    throw std::bad_alloc();
+                }
+                try
+                {
+                    relocate_elements(data);
+                }
+                catch (...)
+                {
+                    std::free(data);
+                    throw;
+                }
+                std::destroy(m_data, m_data + m_size);
+                std::free(m_data);
+            }
+            m_data = data;
+            m_capacity = capacity;
+        }
+
+#ifdef __linux__
+        /**
+         * @brief Moves the elements to mapped pages holding at least @bytes bytes, remapping the current pages if they are mapped.
+         */
+        void reallocate_mapped(std::size_t bytes)
+        {
+            std::size_t page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+            bytes = (bytes + page - 1) / page * page;
+            void* data = MAP_FAILED;
+            if (m_mapped_bytes != 0) {
+                data = ::mremap(static_cast<void*>(m_data), m_mapped_bytes, bytes, MREMAP_MAYMOVE);
+            }
+            else {
+                data = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (data != MAP_FAILED) {
+                    if (m_size != 0) {
+                        std::memcpy(data, m_data, m_size * sizeof(T));
+                    }
+                    std::free(m_data);
+                }
+            }
+            if (data == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+            m_data = static_cast<T*>(data);
+            m_capacity = bytes / sizeof(T);
+            m_mapped_bytes = bytes;
+        }
+#endif
+
+        /**
+         * @brief Frees the buffer, which must not hold elements.
+         */
+        void release() noexcept
+        {
+#ifdef __linux__
+            if (m_mapped_bytes != 0) {
+                ::munmap(static_cast<void*>(m_data), m_mapped_bytes);
+                m_mapped_bytes = 0;
+                return;
+            }
+#endif
+            std::free(m_data);
+        }
+    };
+
+    template <typename T>
+    void swap(relocatable_vector<T>& lhs, relocatable_vector<T>& rhs) noexcept
+    {
+        lhs.swap(rhs);
+    }
+
+    /**
+     * @brief A flat_map stored in a relocatable_vector, whose insertions and erasures shift trivially relocatable elements with memmove.
+     */
+    template <typename K, typename V, typename Comp = std::less<K>>
+    using relocatable_flat_map = flat_map<K, V, Comp, std::allocator<std::pair<K, V>>, relocatable_vector<std::pair<K, V>>>;
@@ -0,0 +1,639 @@
+#pragma once
+
+#include <deque>
+#include <iterator>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+#include "flat_map.h"
+
+    /**
+     * @brief A flat_map for large values: the sorted array holds (key, slot) records and the values live out of line in a slab
+     *        of slots with a free list. Insertion and erasure shift the small records only, never the values.
+     *        References to values and value handles stay valid until the element is erased, even across insertions.
+     *
+     * @tparam K is the key_type of the map.
+     * @tparam V is the value_type of the map.
+     * @tparam std::less<K> the ordering function for Keys.
+     * @tparam std::allocator<std::pair<K, V>> the allocator to allocate the value_types.
+     */
+    template <typename K
+        , typename V
+        , typename Comp = std::less<K>
+        , typename Allocator = std::allocator<std::pair<K, V>>
+    >
+        struct slab_flat_map
+    {
+        using key_type = K;
+        using mapped_type = V;
+        using key_compare = Comp;
+        using allocator_type = Allocator;
+        using index_type = flat_map<K, std::size_t, Comp
+            , typename std::allocator_traits<Allocator>::template rebind_alloc<std::pair<K, std::size_t>>>;
+        using slab_type = std::deque<std::optional<V>
+            , typename std::allocator_traits<Allocator>::template rebind_alloc<std::optional<V>>>;
+        using size_type = typename index_type::size_type;
+        using difference_type = typename index_type::difference_type;
+
+        /**
+         * @brief A stable reference to a value, valid until its element is erased.
+         */
+        struct handle
+        {
+            size_type slot;
+        };
+
+    private:
+        template <bool Const>
+        struct basic_iterator
+        {
+            using owner_type = std::conditional_t<Const, const slab_flat_map, slab_flat_map>;
+            using index_iterator = std::conditional_t<Const
+                , typename index_type::const_iterator, typename index_type::iterator>;
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = std::pair<const K&, std::conditional_t<Const, const V&, V&>>;
+            using difference_type = typename slab_flat_map::difference_type;
+            using reference = value_type;
+
+            struct pointer
+            {
+                value_type value;
+
+                const value_type* operator-> () const
+                {
+                    return &value;
+                }
+            };
+
+            basic_iterator() = default;
+
+            basic_iterator(owner_type* owner, index_iterator it)
+                : m_owner(owner)
+                , m_it(it)
+            {
+            }
+
+            template <bool C = Const, typename = std::enable_if_t<C>>
+            basic_iterator(const basic_iterator<false>& other)
+                : m_owner(other.m_owner)
+                , m_it(other.m_it)
+            {
+            }
+
+            [[nodiscard]] reference operator* () const
+            {
+                return { m_it->first, *m_owner->m_slab[m_it->second] };
+            }
+
+            [[nodiscard]] pointer operator-> () const
+            {
+                return { **this };
+            }
+
+            [[nodiscard]] reference operator[] (difference_type n) const
+            {
+                return *(*this + n);
+            }
+
+            basic_iterator& operator++ ()
+            {
+                ++m_it;
+                return *this;
+            }
+
+            basic_iterator operator++ (int)
+            {
+                basic_iterator result = *this;
+                ++m_it;
+                return result;
+            }
+
+            basic_iterator& operator-- ()
+            {
+                --m_it;
+                return *this;
+            }
+
+            basic_iterator operator-- (int)
+            {
+                basic_iterator result = *this;
+                --m_it;
+                return result;
+            }
+
+            basic_iterator& operator+= (difference_type n)
+            {
+                m_it += n;
+                return *this;
+            }
+
+            basic_iterator& operator-= (difference_type n)
+            {
+                m_it -= n;
+                return *this;
+            }
+
+            [[nodiscard]] basic_iterator operator+ (difference_type n) const
+            {
+                return { m_owner, m_it + n };
+            }
+
+            [[nodiscard]] basic_iterator operator- (difference_type n) const
+            {
+                return { m_owner, m_it - n };
+            }
+
+            [[nodiscard]] difference_type operator- (const basic_iterator& other) const
+            {
+                return m_it - other.m_it;
+            }
+
+            bool operator== (const basic_iterator& other) const
+            {
+                return m_it == other.m_it;
+            }
+
+            bool operator!= (const basic_iterator& other) const
+            {
+                return m_it != other.m_it;
+            }
+
+            bool operator< (const basic_iterator& other) const
+            {
+                return m_it < other.m_it;
+            }
+
+        private:
+            friend struct slab_flat_map;
+            friend struct basic_iterator<true>;
+
+            owner_type* m_owner = nullptr;
+            index_iterator m_it{};
+        };
+
+    public:
+        using iterator = basic_iterator<false>;
+        using const_iterator = basic_iterator<true>;
+
+        slab_flat_map() = default;
+        ~slab_flat_map() = default;
+        slab_flat_map(slab_flat_map&&) = default;
+        slab_flat_map(const slab_flat_map&) = default;
+        slab_flat_map& operator=(slab_flat_map&&) = default;
+        slab_flat_map& operator=(const slab_flat_map&) = default;
+
+        /**
+         * @brief Constructs an empty slab_flat_map and inserts elements from the range [begin ,end ).
+         *
+         * @param begin range of elements to insert.
+         * @param end range of elements to insert.
+         */
+        template <typename It>
+        slab_flat_map(It begin, It end)
+        {
+            insert(begin, end);
+        }
+
+        /**
+         * @brief Constructs an empty slab_flat_map and inserts elements from the range [il.begin() ,il.end()).
+         *
+         * @param init An initializer_list.
+         */
+        slab_flat_map(std::initializer_list<std::pair<K, V>> init)
+            : slab_flat_map(std::begin(init), std::end(init))
+        {
+        }
+
+        /**
+         * @brief Returns an iterator to the first element contained in the container.
+         *
+         * @return An iterator to the first element.
+         */
+        [[nodiscard]] iterator begin() noexcept
+        {
+            return { this, m_index.begin() };
+        }
+
+        /**
+         * @brief Returns an iterator to the end of the container.
+         *
+         * @return An iterator to the end of the container.
+         */
+        [[nodiscard]] iterator end() noexcept
+        {
+            return { this, m_index.end() };
+        }
+
+        /**
+         * @brief Returns a const_iterator to the first element contained in the container.
+         *
+         * @return const_iterator to the first element.
+         */
+        [[nodiscard]] const_iterator begin() const noexcept
+        {
+            return { this, m_index.begin() };
+        }
+
+        /**
+         * @brief Returns a const_iterator to the end of the container.
+         *
+         * @return const_iterator to the end of the container.
+         */
+        [[nodiscard]] const_iterator end() const noexcept
+        {
+            return { this, m_index.end() };
+        }
+
+        /**
+         * @brief Checks the empyiness of the container
+         *
+         * @return true if the container contains no elemets, false otherwise.
+         */
+        [[nodiscard]] bool empty() const noexcept
+        {
+            return m_index.empty();
+        }
+
+        /**
+         * @brief  Returns the number of the elements contained in the container.
+         *
+         * @return The number of the elements of container.
+         */
+        [[nodiscard]] size_type size() const noexcept
+        {
+            return m_index.size();
+        }
+
+        /**
+         * @brief Returns the number of slots of the slab, including the free ones.
+         *
+         * @return size_type The number of slots.
+         */
+        [[nodiscard]] size_type slot_count() const noexcept
+        {
+            return m_slab.size();
+        }
+
+        /**
+         * @brief Requests allocation of memory for @size records. The slab grows by chunks and needs no reservation.
+         *
+         * @param size Requested number of elements.
+         */
+        void reserve(size_type size)
+        {
+            m_index.reserve(size);
+        }
+
+        /**
+         * @brief If there is no key equivalent to @key in the map, inserts (@key, V()) into the map.
+         *
+         * @param key The key of the element to find.
+         * @return mapped_type& A reference to the value corresponding to @key in *this, stable until the element is erased.
+         */
+        template <typename Key>
+        mapped_type& operator[] (Key&& key)
+        {
+            return emplace(std::forward<Key>(key)).first->second;
+        }
+
+        /**
+         * @brief Returns a reference to the value whose key is equivalent to @key.
+         *        Throws an exception object of type out_of_range if no such element is present.
+         *
+         * @param key The key of the element to find.
+         * @return mapped_type& A reference to the value whose key is equivalent to @key.
+         */
+        mapped_type& at(const key_type& key)
+        {
+            auto found = m_index.find(key);
+            if (found == m_index.end()) {
+                detail::throw_out_of_range("key passed to 'at' doesn't exist in this map");
+            }
+            return *m_slab[found->second];
+        }
+
+        /**
+         * @brief Returns a reference to the value whose key is equivalent to @key.
+         *        Throws an exception object of type out_of_range if no such element is present.
+         *
+         * @param key The key of the element to find.
+         * @return const mapped_type& A const reference to the value whose key is equivalent to @key.
+         */
+        const mapped_type& at(const key_type& key) const
+        {
+            auto found = m_index.find(key);
+            if (found == m_index.end()) {
+                detail::throw_out_of_range("key passed to 'at' doesn't exist in this map");
+            }
+            return *m_slab[found->second];
+        }
+
+        /**
+         * @brief Returns the stable handle of the value whose key is equivalent to @key.
+         *        Throws an exception object of type out_of_range if no such element is present.
+         *
+         * @param key The key of the element to find.
+         * @return handle A handle which stays valid until the element is erased.
+         */
+        [[nodiscard]] handle handle_of(const key_type& key) const
+        {
+            auto found = m_index.find(key);
+            if (found == m_index.end()) {
+                detail::throw_out_of_range("key passed to 'handle_of' doesn't exist in this map");
+            }
+            return { found->second };
+        }
+
+        /**
+         * @brief Returns the value referred to by @h, which must belong to an element that was not erased.
+         *
+         * @param h A handle returned by handle_of().
+         * @return mapped_type& The value of the element.
+         */
+        [[nodiscard]] mapped_type& value(handle h)
+        {
+            return *m_slab[h.slot];
+        }
+
+        /**
+         * @brief Returns the value referred to by @h, which must belong to an element that was not erased.
+         *
+         * @param h A handle returned by handle_of().
+         * @return const mapped_type& The value of the element.
+         */
+        [[nodiscard]] const mapped_type& value(handle h) const
+        {
+            return *m_slab[h.slot];
+        }
+
+        /**
+         * @brief Inserts a value constructed from @args with the key @key if and only if there is no element with key equivalent to @key.
+         *        The value is constructed in a free slot of the slab and only the (key, slot) record is inserted in the sorted array.
+         *
+         * @param key The key of the element to insert.
+         * @param args Arguments to construct the value from.
+         * @return std::pair<iterator, bool> The bool component of the returned pair is true if and only if the insertion took place, and
+                   the iterator component of the pair points to the element with key equivalent to @key.
+         */
+        template <typename Key, typename ... Args>
+        std::pair<iterator, bool> emplace(Key&& key, Args&& ... args)
+        {
+            auto lower_bound = m_index.lower_bound(key);
+            if ((lower_bound != m_index.end()) && !key_compare()(key, lower_bound->first)) {
+                return { iterator(this, lower_bound), false };
+            }
+            size_type slot = acquire(std::forward<Args>(args) ...);
+            try
+            {
+                return { iterator(this, m_index.emplace_hint(lower_bound, std::forward<Key>(key), slot)), true };
+            }
+            catch (...)
+            {
+                release(slot);
+                throw;
+            }
+        }
+
+        /**
+         * @brief Inserts @value if and only if there is no element with key equivalent to the key of @value.
+         *
+         * @param value A (key, value) pair.
+         * @return std::pair<iterator, bool> The bool component of the returned pair is true if and only if the insertion takes place,
+         *         and the iterator component of the pair points to the element with key equivalent to the key of @value.
+         */
+        std::pair<iterator, bool> insert(const std::pair<K, V>& value)
+        {
+            return emplace(value.first, value.second);
+        }
+
+        /**
+         * @brief Inserts @value if and only if there is no element with key equivalent to the key of @value.
+         *
+         * @param value A (key, value) pair.
+         * @return std::pair<iterator, bool> The bool component of the returned pair is true if and only if the insertion takes place,
+         *         and the iterator component of the pair points to the element with key equivalent to the key of @value.
+         */
+        std::pair<iterator, bool> insert(std::pair<K, V>&& value)
+        {
+            return emplace(std::move(value.first), std::move(value.second));
+        }
+
+        /**
+         * @brief Inserts each element from the range [first,last) if and only if there is no element with key equivalent to the key of that element.
+         *        The values are placed in slots first, then the (key, slot) records are merged into the sorted array in one pass
+         *        and the slots of the rejected duplicates are freed. If an exception is thrown, the records already merged
+         *        stay in the map and the slots of the others are freed.
+         *
+         * @param begin range of elements to insert.
+         * @param end range of elements to insert.
+         */
+        template <typename It>
+        void insert(It begin, It end)
+        {
+            std::vector<std::pair<K, size_type>> records;
+            auto release_unindexed = [this, &records]() {
+                for (const auto& record : records) {
+                    auto found = m_index.find(record.first);
+                    if ((found == m_index.end()) || (found->second != record.second)) {
+                        release(record.second);
+                    }
+                }
+            };
+            try
+            {
+                for (; begin != end; ++begin) {
+                    size_type slot = acquire(begin->second);
+                    try
+                    {
+                        records.emplace_back(begin->first, slot);
+                    }
+                    catch (...)
+                    {
+                        release(slot);
+                        throw;
+                    }
+                }
+                m_index.insert(std::begin(records), std::end(records));
+            }
+            catch (...)
+            {
+                release_unindexed();
+                throw;
+            }
+            release_unindexed();
+        }
+
+        /**
+         * @brief Inserts each element from the range [il.begin(), il.end()) if and only if there is no element with key equivalent to the key of that element.
+         *
+         * @param il An initializer_list.
+         */
+        void insert(std::initializer_list<std::pair<K, V>> il)
+        {
+            insert(std::begin(il), std::end(il));
+        }
+
+        /**
+         * @brief Erases the element pointed to by it and frees its slot.
+         *
+         * @param it Iterator pointing to the element to be erased.
+         * @return iterator An iterator pointing to the element immediately following the erased one. If no such element exists, returns end().
+         */
+        iterator erase(const_iterator it)
+        {
+            release(it.m_it->second);
+            return { this, m_index.erase(it.m_it) };
+        }
+
+        /**
+         * @brief Erases element in the container with key equivalent to @key.
+         *
+         * @param key Key value of the element to remove.
+         * @return  0 if @key not found in container, 1 otherwise.
+         */
+        size_type erase(const key_type& key)
+        {
+            auto found = m_index.find(key);
+            if (found == m_index.end()) {
+                return 0;
+            }
+            erase(const_iterator(this, typename index_type::const_iterator(found)));
+            return 1;
+        }
+
+        /**
+         * @brief Swaps the contents of *this and other.
+         *
+         * @param other slab_flat_map with which must be swapped.
+         */
+        void swap(slab_flat_map& other) noexcept
+        {
+            m_index.swap(other.m_index);
+            m_slab.swap(other.m_slab);
+            m_free.swap(other.m_free);
+        }
+
+        /**
+         * @brief Erases all elements in container.
+         *
+         */
+        void clear()
+        {
+            m_index.clear();
+            m_slab.clear();
+            m_free.clear();
+        }
+
+        /**
+         * @brief Attempts to find an element with key equivalent to @key.
+         *
+         * @param key Key value of the element to search for.
+         * @return iterator An iterator pointing to an element with the key equivalent to key, or end() if such an element is not found.
+         */
+        template <typename T>
+        [[nodiscard]] iterator find(const T& key)
+        {
+            return { this, m_index.find(key) };
+        }
+
+        /**
+         * @brief Attempts to find an element with key equivalent to @key.
+         *
+         * @param key Key value of the element to search for.
+         * @return const_iterator A const_iterator pointing to an element with the key equivalent to @key, or end() if such an element is not found.
+         */
+        template <typename T>
+        [[nodiscard]] const_iterator find(const T& key) const
+        {
+            return { this, m_index.find(key) };
+        }
+
+        /**
+         * @brief Checks if there is an element with key equivalent to @key in the container.
+         *
+         * @param key Key value of the element to search for.
+         * @return true if there is such an element, false otherwise.
+         */
+        template <typename T>
+        [[nodiscard]] bool contains(const T& key) const
+        {
+            return m_index.contains(key);
+        }
+
+        /**
+         * @brief Returns the number of elements with key equivalent to @key.
+         *
+         * @param key Key value of the element to count.
+         * @return 1 if the element is found, 0 otherwise.
+         */
+        template <typename T>
+        [[nodiscard]] size_type count(const T& key) const
+        {
+            return m_index.count(key);
+        }
+
+        /**
+         * @brief Finds the first element with key not less than @key, or end() if such an element is not found.
+         *
+         * @param key Key value to compare the elements to.
+         * @return const_iterator An const iterator pointing to the first element with key not less than k, or end() if such an element is not found.
+         */
+        template <typename T>
+        [[nodiscard]] const_iterator lower_bound(const T& key) const
+        {
+            return { this, m_index.lower_bound(key) };
+        }
+
+        /**
+         * @brief Finds the first element with key greater than @key, or end() if such an element is not found.
+         *
+         * @param key Key value to compare the elements to.
+         * @return const_iterator An const iterator pointing to the first element with key greater than @key, or end() if such an element is not found.
+         */
+        template <typename T>
+        [[nodiscard]] const_iterator upper_bound(const T& key) const
+        {
+            return { this, m_index.upper_bound(key) };
+        }
+
+        /**
+         * @brief Returns the comparison object out of which a was constructed.
+         *
+         * @return key_compare The comparison object
+         */
+        key_compare key_comp() const
+        {
+            return key_compare();
+        }
+
+    private:
+        index_type m_index;
+        slab_type m_slab;
+        std::vector<size_type> m_free;
+
+        template <typename ... Args>
+        size_type acquire(Args&& ... args)
+        {
+            if (m_free.empty()) {
+                m_slab.emplace_back(std::in_place, std::forward<Args>(args) ...);
+                return m_slab.size() - 1;
+            }
+            size_type slot = m_free.back();
+            m_slab[slot].emplace(std::forward<Args>(args) ...);
+            m_free.pop_back();
+            return slot;
+        }
+
+        void release(size_type slot)
+        {
+            m_free.push_back(slot);
+            m_slab[slot].reset();
+        }
+    };
+
+    template <typename K, typename V, typename C, typename A>
+    void swap(slab_flat_map<K, V, C, A>& lhs, slab_flat_map<K, V, C, A>& rhs) noexcept
+    {
+        lhs.swap(rhs);
+    }
@@ -0,0 +1,657 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "flat_map.h"
+
+namespace detail
+{
+    /**
+     * @brief The key of a string_flat_map element: the location of its bytes in the arena and its first 8 bytes packed
+     *        big-endian, so that most comparisons are decided by one integer comparison without touching the arena.
+     */
+    struct interned_key
+    {
+        std::uint32_t offset;
+        std::uint32_t length;
+        std::uint64_t prefix;
+    };
+
+    inline std::uint64_t pack_prefix(std::string_view key) noexcept
+    {
+        std::uint64_t prefix = 0;
+        for (std::size_t i = 0; i < 8; ++i) {
+            prefix <<= 8;
+            if (i < key.size()) {
+                prefix |= static_cast<unsigned char>(key[i]);
+            }
+        }
+        return prefix;
+    }
+}
+
+    /**
+     * @brief A map from strings to V which stores the bytes of all keys in one contiguous arena. The sorted array holds
+     *        (offset, length, prefix) records, so the keys cost no allocation each and comparisons rarely leave the array.
+     *        Keys are exposed as std::string_view; views and iterators are invalidated by any insertion.
+     *        Erasure leaves the bytes of the key in the arena until compact() or the next bulk insertion, which rebuild
+     *        the arena in key order. The arena can hold up to 4GB of key bytes.
+     *
+     * @tparam V is the value_type of the map.
+     * @tparam std::allocator<V> the allocator to allocate the values.
+     */
+    template <typename V, typename Allocator = std::allocator<V>>
+    struct string_flat_map
+    {
+        using key_type = std::string_view;
+        using mapped_type = V;
+        using entry_type = std::pair<detail::interned_key, V>;
+        using allocator_type = Allocator;
+        using container_type = std::vector<entry_type
+            , typename std::allocator_traits<Allocator>::template rebind_alloc<entry_type>>;
+        using arena_type = std::vector<char, typename std::allocator_traits<Allocator>::template rebind_alloc<char>>;
+        using difference_type = typename container_type::difference_type;
+        using size_type = typename container_type::size_type;
+
+    private:
+        template <bool Const>
+        struct basic_iterator
+        {
+            using owner_type = std::conditional_t<Const, const string_flat_map, string_flat_map>;
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = std::pair<std::string_view, std::conditional_t<Const, const V&, V&>>;
+            using difference_type = typename string_flat_map::difference_type;
+            using reference = value_type;
+
+            struct pointer
+            {
+                value_type value;
+
+                const value_type* operator-> () const
+                {
+                    return &value;
+                }
+            };
+
+            basic_iterator() = default;
+
+            basic_iterator(owner_type* owner, size_type index)
+                : m_owner(owner)
+                , m_index(index)
+            {
+            }
+
+            template <bool C = Const, typename = std::enable_if_t<C>>
+            basic_iterator(const basic_iterator<false>& other)
+                : m_owner(other.m_owner)
+                , m_index(other.m_index)
+            {
+            }
+
+            [[nodiscard]] reference operator* () const
+            {
+                auto& entry = m_owner->m_entries[m_index];
+                return { m_owner->view(entry.first), entry.second };
+            }
+
+            [[nodiscard]] pointer operator-> () const
+            {
+                return { **this };
+            }
+
+            [[nodiscard]] reference operator[] (difference_type n) const
+            {
+                return *(*this + n);
+            }
+
+            basic_iterator& operator++ ()
+            {
+                ++m_index;
+                return *this;
+            }
+
+            basic_iterator operator++ (int)
+            {
+                basic_iterator result = *this;
+                ++m_index;
+                return result;
+            }
+
+            basic_iterator& operator-- ()
+            {
+                --m_index;
+                return *this;
+            }
+
+            basic_iterator operator-- (int)
+            {
+                basic_iterator result = *this;
+                --m_index;
+                return result;
+            }
+
+            basic_iterator& operator+= (difference_type n)
+            {
+                m_index += n;
+                return *this;
+            }
+
+            basic_iterator& operator-= (difference_type n)
+            {
+                m_index -= n;
+                return *this;
+            }
+
+            [[nodiscard]] basic_iterator operator+ (difference_type n) const
+            {
+                return { m_owner, m_index + n };
+            }
+
+            [[nodiscard]] basic_iterator operator- (difference_type n) const
+            {
+                return { m_owner, m_index - n };
+            }
+
+            [[nodiscard]] difference_type operator- (const basic_iterator& other) const
+            {
+                return static_cast<difference_type>(m_index) - static_cast<difference_type>(other.m_index);
+            }
+
+            bool operator== (const basic_iterator& other) const
+            {
+                return m_index == other.m_index;
+            }
+
+            bool operator!= (const basic_iterator& other) const
+            {
+                return m_index != other.m_index;
+            }
+
+            bool operator< (const basic_iterator& other) const
+            {
+                return m_index < other.m_index;
+            }
+
+        private:
+            friend struct string_flat_map;
+            friend struct basic_iterator<true>;
+
+            owner_type* m_owner = nullptr;
+            size_type m_index = 0;
+        };
+
+    public:
+        using iterator = basic_iterator<false>;
+        using const_iterator = basic_iterator<true>;
+
+        string_flat_map() = default;
+        ~string_flat_map() = default;
+        string_flat_map(string_flat_map&&) = default;
+        string_flat_map(const string_flat_map&) = default;
+        string_flat_map& operator=(string_flat_map&&) = default;
+        string_flat_map& operator=(const string_flat_map&) = default;
+
+        /**
+         * @brief Constructs an empty string_flat_map and inserts elements from the range [begin ,end ).
+         *
+         * @param begin range of (string, value) pairs to insert.
+         * @param end range of (string, value) pairs to insert.
+         */
+        template <typename It>
+        string_flat_map(It begin, It end)
+        {
+            insert(begin, end);
+        }
+
+        /**
+         * @brief Constructs an empty string_flat_map and inserts elements from the range [il.begin() ,il.end()).
+         *
+         * @param init An initializer_list.
+         */
+        string_flat_map(std::initializer_list<std::pair<std::string_view, V>> init)
+            : string_flat_map(std::begin(init), std::end(init))
+        {
+        }
+
+        /**
+         * @brief Returns an iterator to the first element contained in the container.
+         *
+         * @return An iterator to the first element.
+         */
+        [[nodiscard]] iterator begin() noexcept
+        {
+            return { this, 0 };
+        }
+
+        /**
+         * @brief Returns an iterator to the end of the container.
+         *
+         * @return An iterator to the end of the container.
+         */
+        [[nodiscard]] iterator end() noexcept
+        {
+            return { this, m_entries.size() };
+        }
+
+        /**
+         * @brief Returns a const_iterator to the first element contained in the container.
+         *
+         * @return const_iterator to the first element.
+         */
+        [[nodiscard]] const_iterator begin() const noexcept
+        {
+            return { this, 0 };
+        }
+
+        /**
+         * @brief Returns a const_iterator to the end of the container.
+         *
+         * @return const_iterator to the end of the container.
+         */
+        [[nodiscard]] const_iterator end() const noexcept
+        {
+            return { this, m_entries.size() };
+        }
+
+        /**
+         * @brief Checks the empyiness of the container
+         *
+         * @return true if the container contains no elemets, false otherwise.
+         */
+        [[nodiscard]] bool empty() const noexcept
+        {
+            return m_entries.empty();
+        }
+
+        /**
+         * @brief  Returns the number of the elements contained in the container.
+         *
+         * @return The number of the elements of container.
+         */
+        [[nodiscard]] size_type size() const noexcept
+        {
+            return m_entries.size();
+        }
+
+        /**
+         * @brief Returns the number of bytes of the key arena, including the bytes of erased keys.
+         *
+         * @return size_type The size of the arena.
+         */
+        [[nodiscard]] size_type arena_size() const noexcept
+        {
+            return m_arena.size();
+        }
+
+        /**
+         * @brief Requests allocation of memory for @size elements whose keys have @key_bytes bytes in total.
+         *
+         * @param size Requested number of elements.
+         * @param key_bytes Requested number of key bytes.
+         */
+        void reserve(size_type size, size_type key_bytes = 0)
+        {
+            m_entries.reserve(size);
+            m_arena.reserve(key_bytes);
+        }
+
+        /**
+         * @brief If there is no key equal to @key in the map, inserts (@key, V()) into the map.
+         *
+         * @param key The key of the element to find.
+         * @return mapped_type& A reference to the value corresponding to @key in *this.
+         */
+        mapped_type& operator[] (std::string_view key)
+        {
+            return emplace(key).first->second;
+        }
+
+        /**
+         * @brief Returns a reference to the value whose key is equal to @key.
+         *        Throws an exception object of type out_of_range if no such element is present.
+         *
+         * @param key The key of the element to find.
+         * @return mapped_type& A reference to the value whose key is equal to @key.
+         */
+        mapped_type& at(std::string_view key)
+        {
+            auto found = find(key);
+            if (found == end()) {
+                detail::throw_out_of_range("key passed to 'at' doesn't exist in this map");
+            }
+            return found->second;
+        }
+
+        /**
+         * @brief Returns a reference to the value whose key is equal to @key.
+         *        Throws an exception object of type out_of_range if no such element is present.
+         *
+         * @param key The key of the element to find.
+         * @return const mapped_type& A const reference to the value whose key is equal to @key.
+         */
+        const mapped_type& at(std::string_view key) const
+        {
+            auto found = find(key);
+            if (found == end()) {
+                detail::throw_out_of_range("key passed to 'at' doesn't exist in this map");
+            }
+            return found->second;
+        }
+
+        /**
+         * @brief Inserts a value constructed from @args with the key @key if and only if there is no element with key equal to @key.
+         *        The bytes of @key are appended to the arena.
+         *
+         * @param key The key of the element to insert.
+         * @param args Arguments to construct the value from.
+         * @return std::pair<iterator, bool> The bool component of the returned pair is true if and only if the insertion took place, and
+                   the iterator component of the pair points to the element with key equal to @key.
+         */
+        template <typename ... Args>
+        std::pair<iterator, bool> emplace(std::string_view key, Args&& ... args)
+        {
+            detail::interned_key probe = make_probe(key);
+            size_type index = lower_index(probe, key);
+            if ((index != m_entries.size()) && (view(m_entries[index].first) == key)) {
+                return { iterator(this, index), false };
+            }
+            detail::interned_key interned = intern(key);
+            try
+            {
+                m_entries.emplace(std::begin(m_entries) + index, std::piecewise_construct
+                    , std::forward_as_tuple(interned), std::forward_as_tuple(std::forward<Args>(args) ...));
+            }
+            catch (...)
+            {
+                m_arena.resize(interned.offset);
+                throw;
+            }
+            return { iterator(this, index), true };
+        }
+
+        /**
+         * @brief Inserts (@value.first, @value.second) if and only if there is no element with key equal to @value.first.
+         *
+         * @param value A pair of a string and a value.
+         * @return std::pair<iterator, bool> The bool component of the returned pair is true if and only if the insertion takes place,
+         *         and the iterator component of the pair points to the element with key equal to the key of @value.
+         */
+        template <typename Key>
+        std::pair<iterator, bool> insert(const std::pair<Key, V>& value)
+        {
+            return emplace(std::string_view(value.first), value.second);
+        }
+
+        /**
+         * @brief Inserts each element from the range [first,last) if and only if there is no element with key equal to the key of that element.
+         *        The new elements are sorted and merged in one pass, and the arena is rebuilt in key order without the bytes of erased keys.
+         *
+         * @param begin range of (string, value) pairs to insert.
+         * @param end range of (string, value) pairs to insert.
+         */
+        template <typename It>
+        void insert(It begin, It end)
+        {
+            size_type size_before = m_entries.size();
+            size_type arena_before = m_arena.size();
+            try
+            {
+                for (; begin != end; ++begin) {
+                    m_entries.emplace_back(intern(std::string_view(begin->first)), begin->second);
+                }
+            }
+            catch (...)
+            {
+                m_entries.erase(std::begin(m_entries) + size_before, std::end(m_entries));
+                m_arena.resize(arena_before);
+                throw;
+            }
+            auto less = [this](const entry_type& lhs, const entry_type& rhs) { return key_less(lhs.first, rhs.first); };
+            auto mid = std::begin(m_entries) + size_before;
+            std::stable_sort(mid, std::end(m_entries), less);
+            std::inplace_merge(std::begin(m_entries), mid, std::end(m_entries), less);
+            m_entries.erase(std::unique(std::begin(m_entries), std::end(m_entries)
+                , [&less](const entry_type& lhs, const entry_type& rhs) { return !less(lhs, rhs); }), std::end(m_entries));
+            compact();
+        }
+
+        /**
+         * @brief Inserts each element from the range [il.begin(), il.end()) if and only if there is no element with key equal to the key of that element.
+         *
+         * @param il An initializer_list.
+         */
+        void insert(std::initializer_list<std::pair<std::string_view, V>> il)
+        {
+            insert(std::begin(il), std::end(il));
+        }
+
+        /**
+         * @brief Erases the element pointed to by it. Its key bytes stay in the arena until the next compaction.
+         *
+         * @param it Iterator pointing to the element to be erased.
+         * @return iterator An iterator pointing to the element immediately following the erased one. If no such element exists, returns end().
+         */
+        iterator erase(const_iterator it)
+        {
+            m_entries.erase(std::begin(m_entries) + it.m_index);
+            return { this, it.m_index };
+        }
+
+        /**
+         * @brief Erases element in the container with key equal to @key.
+         *
+         * @param key Key value of the element to remove.
+         * @return  0 if @key not found in container, 1 otherwise.
+         */
+        size_type erase(std::string_view key)
+        {
+            auto found = find(key);
+            if (found == end()) {
+                return 0;
+            }
+            erase(found);
+            return 1;
+        }
+
+        /**
+         * @brief Rebuilds the arena in key order, dropping the bytes of erased keys.
+         *
+         */
+        void compact()
+        {
+            arena_type arena;
+            arena.reserve(m_arena.size());
+            for (auto& entry : m_entries) {
+                std::uint32_t offset = static_cast<std::uint32_t>(arena.size());
+                arena.insert(std::end(arena), m_arena.data() + entry.first.offset
+                    , m_arena.data() + entry.first.offset + entry.first.length);
+                entry.first.offset = offset;
+            }
+            m_arena.swap(arena);
+        }
+
+        /**
+         * @brief Swaps the contents of *this and other.
+         *
+         * @param other string_flat_map with which must be swapped.
+         */
+        void swap(string_flat_map& other) noexcept
+        {
+            m_entries.swap(other.m_entries);
+            m_arena.swap(other.m_arena);
+        }
+
+        /**
+         * @brief Erases all elements in container.
+         *
+         */
+        void clear()
+        {
+            m_entries.clear();
+            m_arena.clear();
+        }
+
+        /**
+         * @brief Attempts to find an element with key equal to @key.
+         *
+         * @param key Key value of the element to search for.
+         * @return iterator An iterator pointing to an element with the key equal to key, or end() if such an element is not found.
+         */
+        [[nodiscard]] iterator find(std::string_view key)
+        {
+            return { this, find_index(key) };
+        }
+
+        /**
+         * @brief Attempts to find an element with key equal to @key.
+         *
+         * @param key Key value of the element to search for.
+         * @return const_iterator A const_iterator pointing to an element with the key equal to @key, or end() if such an element is not found.
+         */
+        [[nodiscard]] const_iterator find(std::string_view key) const
+        {
+            return { this, find_index(key) };
+        }
+
+        /**
+         * @brief Checks if there is an element with key equal to @key in the container.
+         *
+         * @param key Key value of the element to search for.
+         * @return true if there is such an element, false otherwise.
+         */
+        [[nodiscard]] bool contains(std::string_view key) const
+        {
+            return find_index(key) != m_entries.size();
+        }
+
+        /**
+         * @brief Returns the number of elements with key equal to @key.
+         *
+         * @param key Key value of the element to count.
+         * @return 1 if the element is found, 0 otherwise.
+         */
+        [[nodiscard]] size_type count(std::string_view key) const
+        {
+            return contains(key) ? 1 : 0;
+        }
+
+        /**
+         * @brief Finds the first element with key not less than @key, or end() if such an element is not found.
+         *
+         * @param key Key value to compare the elements to.
+         * @return const_iterator An const iterator pointing to the first element with key not less than k, or end() if such an element is not found.
+         */
+        [[nodiscard]] const_iterator lower_bound(std::string_view key) const
+        {
+            return { this, lower_index(make_probe(key), key) };
+        }
+
+        /**
+         * @brief Finds the first element with key greater than @key, or end() if such an element is not found.
+         *
+         * @param key Key value to compare the elements to.
+         * @return const_iterator An const iterator pointing to the first element with key greater than @key, or end() if such an element is not found.
+         */
+        [[nodiscard]] const_iterator upper_bound(std::string_view key) const
+        {
+            size_type index = lower_index(make_probe(key), key);
+            if ((index != m_entries.size()) && (view(m_entries[index].first) == key)) {
+                ++index;
+            }
+            return { this, index };
+        }
+
+        /**
+         * @brief Compares two string_flat_maps.
+         *
+         * @param other A string_flat_map with which need to compare.
+         * @return true if they are equal,false otherwise.
+         */
+        bool operator== (const string_flat_map& other) const
+        {
+            return (size() == other.size()) && std::equal(begin(), end(), other.begin());
+        }
+
+        /**
+         * @brief Compares two string_flat_maps.
+         *
+         * @param other A string_flat_map with which need to compare.
+         * @return true if they are unequal,false otherwise.
+         */
+        bool operator!= (const string_flat_map& other) const
+        {
+            return !(*this == other);
+        }
+
+    private:
+        container_type m_entries;
+        arena_type m_arena;
+
+        /**
+         * @brief Offset used by lookup probes, whose bytes are not in the arena.
+         */
+        static constexpr std::uint32_t probe_offset = std::numeric_limits<std::uint32_t>::max();
+
+        std::string_view view(const detail::interned_key& key) const noexcept
+        {
+            return { m_arena.data() + key.offset, key.length };
+        }
+
+        static detail::interned_key make_probe(std::string_view key) noexcept
+        {
+            return { probe_offset, static_cast<std::uint32_t>(key.size()), detail::pack_prefix(key) };
+        }
+
+        detail::interned_key intern(std::string_view key)
+        {
+            if (m_arena.size() + key.size() > std::numeric_limits<std::uint32_t>::max()) {
+                throw std::length_error("string_flat_map key arena exceeds 4GB");
+            }
+            detail::interned_key result{ static_cast<std::uint32_t>(m_arena.size())
+                , static_cast<std::uint32_t>(key.size()), detail::pack_prefix(key) };
+            m_arena.insert(std::end(m_arena), std::begin(key), std::end(key));
+            return result;
+        }
+
+        bool key_less(const detail::interned_key& lhs, const detail::interned_key& rhs) const noexcept
+        {
+            if (lhs.prefix != rhs.prefix) {
+                return lhs.prefix < rhs.prefix;
+            }
+            return view(lhs) < view(rhs);
+        }
+
+        size_type lower_index(const detail::interned_key& probe, std::string_view key) const
+        {
+            return std::lower_bound(std::begin(m_entries), std::end(m_entries), probe
+                , [this, key](const entry_type& lhs, const detail::interned_key& rhs) {
+                    if (lhs.first.prefix != rhs.prefix) {
+                        return lhs.first.prefix < rhs.prefix;
+                    }
+                    return view(lhs.first) < key;
+                }) - std::begin(m_entries);
+        }
+
+        size_type find_index(std::string_view key) const
+        {
+            size_type index = lower_index(make_probe(key), key);
+            if ((index == m_entries.size()) || (view(m_entries[index].first) != key)) {
+                return m_entries.size();
+            }
+            return index;
+        }
+    };
+
+    template <typename V, typename A>
+    void swap(string_flat_map<V, A>& lhs, string_flat_map<V, A>& rhs) noexcept
+    {
+        lhs.swap(rhs);
+    }